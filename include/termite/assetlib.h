@@ -33,7 +33,9 @@ namespace tee
             None = 0x00,
             Reload = 0x01,
             ForceBlockLoad = 0x02,
-            AbsolutePath = 0x04
+            AbsolutePath = 0x04,
+            HighPriority = 0x08,    // Async: Asset is needed right away (visible), it's read before others
+            Prefetch = 0x10         // Async: Asset is read after others
         };
 
         typedef uint8_t Bits;
@@ -62,6 +64,22 @@ namespace tee
         virtual bool loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) = 0;
         virtual void unloadObj(uintptr_t obj, bx::AllocatorI* alloc) = 0;
         virtual void onReload(AssetHandle handle, bx::AllocatorI* alloc) = 0;
+
+        /// Two-phase loading (async loads only): Return true if the asset can be decoded in a job
+        /// Then 'decodeObj' is called on a worker thread and 'finalizeObj' on the main thread when it's done
+        virtual bool canDecode(const AssetParams& params, bx::AllocatorI* alloc) { return false; }
+
+        /// Thread-safe part of the load: parse 'mem' into an intermediate blob ('decoded')
+        /// Must not call gfx driver, load other assets or use temp allocators, use getHeapAlloc() for memory
+        virtual bool decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded,
+                               bx::AllocatorI* alloc) { return false; }
+
+        /// Main-thread part of the load: create the object from 'decoded', 'decoded' is always owned (and freed) here
+        virtual bool finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj,
+                                 bx::AllocatorI* alloc) { return false; }
+
+        /// Frees 'decoded' blob of a load that is cancelled before 'finalizeObj'
+        virtual void releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc) {}
     };
 
     namespace asset {
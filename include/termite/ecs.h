@@ -4,12 +4,20 @@
 #include "bx/bx.h"
 #include "bx/allocator.h"
 
+// Number of bits for entity index (16..24), rest of the id is used for generation (max 14 bits)
+// Default keeps 14 generation bits, more index bits leave less generations before a stale Entity matches again
+// Must be the same for the engine and all plugins
+#ifndef termite_ENTITY_INDEX_BITS
+#   define termite_ENTITY_INDEX_BITS 16
+#endif
+
 namespace tee
 {
-    static const uint32_t kEntityIndexBits = 16;
+    static const uint32_t kEntityIndexBits = termite_ENTITY_INDEX_BITS;
     static const uint32_t kEntityIndexMask = (1 << kEntityIndexBits) - 1;
-    static const uint32_t kEntityGenerationBits = 14;
+    static const uint32_t kEntityGenerationBits = (32 - kEntityIndexBits) < 14 ? (32 - kEntityIndexBits) : 14;
     static const uint32_t kEntityGenerationMask = (1 << kEntityGenerationBits) - 1;
+    BX_STATIC_ASSERT(kEntityIndexBits >= 16 && kEntityIndexBits <= 24);
     struct ImGuiApi;
 
     struct EntityManager;
@@ -30,8 +38,8 @@ namespace tee
         inline Entity(uint32_t index, uint32_t generation)  { 
             id = (index & kEntityIndexMask) | ((generation & kEntityGenerationMask) << kEntityIndexBits); 
         }
-        inline uint32_t getIndex() { return (id & kEntityIndexMask);  }
-        inline uint32_t getGeneration() {   return (id >> kEntityIndexBits) & kEntityGenerationMask;  }
+        inline uint32_t getIndex() const { return (id & kEntityIndexMask);  }
+        inline uint32_t getGeneration() const {   return (id >> kEntityIndexBits) & kEntityGenerationMask;  }
         inline bool operator==(const Entity& ent) const { return this->id == ent.id; }
         inline bool operator!=(const Entity& ent) const { return this->id != ent.id; }
         inline bool isValid() const   {  return this->id != 0;  }
@@ -61,13 +69,30 @@ namespace tee
 
         void(*debug)(const ComponentHandle* handles, uint16_t count, ImGuiApi* imgui, void* userData);
 
+        // Fields below are newer than EcsApi version 0, plugins requesting version 0 get their defaults
+        // Called by ecs::updateType for packed components (ComponentFlag::Packed)
+        // 'data' is 'count' contiguous items of 'dataSize' bytes, and 'ents' are their owners, only active components are passed
+        typedef void(*UpdateStagePackedFunc)(const Entity* ents, void* data, uint16_t count, float dt);
+        UpdateStagePackedFunc updateStagePacked[ComponentUpdateStage::Count];
+
+        // For ComponentFlag::ParallelUpdate types: User defined bits for the data that update callbacks read and write
+        // Types that don't write anything the others read or write, are updated at the same time
+        // Both masks must be set to overlap with other types, default writeMask (all bits) conflicts with everything
+        uint32_t readMask;
+        uint32_t writeMask;
+        uint16_t updateChunkSize;   // Components per job, 0 = default
+
         ComponentCallbacks() :
             createInstance(nullptr),
             destroyInstance(nullptr),
             setActive(nullptr),
-            debug(nullptr)
+            debug(nullptr),
+            readMask(0),
+            writeMask(UINT32_MAX),
+            updateChunkSize(0)
         {
             bx::memSet(updateStage, 0x00, sizeof(UpdateStageFunc)*ComponentUpdateStage::Count);
+            bx::memSet(updateStagePacked, 0x00, sizeof(UpdateStagePackedFunc)*ComponentUpdateStage::Count);
         }
     };
 
@@ -77,7 +102,14 @@ namespace tee
         {
             None = 0x0,
             ImmediateDestroy = 0x01,   // Destroys component immediately after owner entity is destroyed
-            ImmediateDeactivate = 0x02   // Deactivates component immediately after owner entity is destroyed
+            ImmediateDeactivate = 0x02,  // Deactivates component immediately after owner entity is destroyed
+            // Keeps component data in a dense array with active components first, so updates stream through memory
+            // Data is moved with memcpy when other components of the type are created/destroyed/(de)activated,
+            // So it must be relocatable and pointers from getData are only valid until then
+            Packed = 0x04,
+            // Update callbacks are thread-safe and can be called on chunks of components from job threads
+            // Callbacks must not create/destroy components or change active states, see ComponentCallbacks::readMask
+            ParallelUpdate = 0x08
         };
 
         typedef uint8_t Bits;
@@ -103,8 +135,10 @@ namespace tee
                                                       uint32_t dataSize, uint16_t poolSize, uint16_t growSize,
                                                       bx::AllocatorI* alloc = nullptr);
 
-        /// Garbage collect dead entities 4 ents per call randomly
-        TEE_API void garbageCollect(EntityManager* emgr);
+        /// Destroys components of dead entities, in the order they are destroyed
+        /// Stops after 'budgetMicros' microseconds or 'maxEntities' entities, pass 0 for no limit
+        /// Returns number of dead entities that are still pending
+        TEE_API int garbageCollect(EntityManager* emgr, int budgetMicros = 0, int maxEntities = 0);
 
         /// Garbage collect dead entities aggressively by searching all dead components and destroy them at once
         TEE_API void garbageCollectAggressive(EntityManager* emgr);
@@ -114,6 +148,14 @@ namespace tee
         TEE_API void destroyComponent(EntityManager* emgr, Entity ent, ComponentHandle handle);
 
         TEE_API void updateGroup(ComponentUpdateStage::Enum stage, ComponentGroupHandle groupHandle, float dt);
+
+        /// Updates all active components of a type, packed types get 'updateStagePacked' with their raw data,
+        /// Other types get 'updateStage' with handles
+        TEE_API void updateType(ComponentUpdateStage::Enum stage, ComponentTypeHandle typeHandle, float dt);
+
+        /// Returns dense data of a packed type (nullptr for other types), active components come first
+        TEE_API void* getPackedData(ComponentTypeHandle typeHandle, const Entity** ents, uint16_t* count, 
+                                    uint16_t* numActive = nullptr);
         TEE_API void cleanupGroupUpdates();
 
         /// Calls 'debug' callbacks on all components
@@ -83,6 +83,9 @@ namespace tee
 
     typedef void(*GfxReleaseMemCallback)(void* ptr, void* userData);
 
+    // Opaque encoder, maps to bgfx::Encoder
+    struct GfxEncoder;
+
     class BX_NO_VTABLE GfxDriverEventsI
     {
     public:
@@ -98,6 +101,69 @@ namespace tee
         virtual void onCaptureFrame(const void* data, uint32_t size) = 0;
     };
 
+    // Draw calls that are recorded into an encoder, same as the draw calls in GfxDriver
+    // An encoder must only be used by one thread (job) at a time, all calls must be between beginEncoder/endEncoder
+    struct GfxEncoderApi
+    {
+        void(*setMarker)(GfxEncoder* enc, const char* marker);
+        void(*setState)(GfxEncoder* enc, GfxState::Bits state, uint32_t rgba/* = 0*/);
+        void(*setStencil)(GfxEncoder* enc, GfxStencilState::Bits frontStencil, GfxStencilState::Bits backStencil/* = GfxStencilState::None*/);
+        uint16_t(*setScissor)(GfxEncoder* enc, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+        void(*setScissorCache)(GfxEncoder* enc, uint16_t cache);
+        void(*setCondition)(GfxEncoder* enc, OcclusionQueryHandle handle, bool visible);
+        void(*touch)(GfxEncoder* enc, uint8_t id);
+        void(*discard)(GfxEncoder* enc);
+
+        // Transform
+        uint32_t(*allocTransform)(GfxEncoder* enc, GpuTransform* transform, uint16_t num/* = 1*/);
+        uint32_t(*setTransform)(GfxEncoder* enc, const void* mtx, uint16_t num/* = 1*/);
+        void(*setTransformCached)(GfxEncoder* enc, uint32_t cache, uint16_t num/* = 1*/);
+
+        // Uniforms
+        void(*setUniform)(GfxEncoder* enc, UniformHandle handle, const void* value, uint16_t num/* = 1*/);
+
+        // Buffers
+        void(*setIndexBuffer)(GfxEncoder* enc, IndexBufferHandle handle, uint32_t firstIndex, uint32_t numIndices);
+        void(*setDynamicIndexBuffer)(GfxEncoder* enc, DynamicIndexBufferHandle handle, uint32_t firstIndex, uint32_t numIndices);
+        void(*setTransientIndexBufferI)(GfxEncoder* enc, const TransientIndexBuffer* tib, uint32_t firstIndex, uint32_t numIndices);
+        void(*setTransientIndexBuffer)(GfxEncoder* enc, const TransientIndexBuffer* tib);
+        void(*setVertexBuffer)(GfxEncoder* enc, uint8_t stream, VertexBufferHandle handle);
+        void(*setVertexBufferI)(GfxEncoder* enc, uint8_t stream, VertexBufferHandle handle, uint32_t vertexIndex, uint32_t numVertices);
+        void(*setDynamicVertexBuffer)(GfxEncoder* enc, uint8_t stream, DynamicVertexBufferHandle handle, uint32_t startVertex, uint32_t numVertices);
+        void(*setTransientVertexBuffer)(GfxEncoder* enc, uint8_t stream, const TransientVertexBuffer* tvb);
+        void(*setTransientVertexBufferI)(GfxEncoder* enc, uint8_t stream, const TransientVertexBuffer* tvb, uint32_t startVertex, uint32_t numVertices);
+        void(*setInstanceDataBuffer)(GfxEncoder* enc, const InstanceDataBuffer* idb, uint32_t start, uint32_t num);
+        void(*setInstanceDataBufferVb)(GfxEncoder* enc, VertexBufferHandle handle, uint32_t startVertex, uint32_t num);
+        void(*setInstanceDataBufferDynamicVb)(GfxEncoder* enc, DynamicVertexBufferHandle handle, uint32_t startVertex, uint32_t num);
+
+        // Textures
+        void(*setTexture)(GfxEncoder* enc, uint8_t stage, UniformHandle sampler, TextureHandle handle, TextureFlag::Bits flags/* = TextureFlag::FromTexture*/);
+
+        // Submit
+        void(*submit)(GfxEncoder* enc, uint8_t viewId, ProgramHandle program, int32_t depth/* = 0*/, bool preserveState/* = false*/);
+        void(*submitWithOccQuery)(GfxEncoder* enc, uint8_t viewId, ProgramHandle program, OcclusionQueryHandle occQuery,
+                                  int32_t depth/* = 0*/, bool preserveState/* = false*/);
+        void(*submitIndirect)(GfxEncoder* enc, uint8_t viewId, ProgramHandle program, IndirectBufferHandle indirectHandle,
+                              uint16_t start, uint16_t num, int32_t depth/* = 0*/, bool preserveState/* = false*/);
+
+        // Compute
+        void(*setComputeBufferIb)(GfxEncoder* enc, uint8_t stage, IndexBufferHandle handle, GpuAccessFlag::Enum access);
+        void(*setComputeBufferVb)(GfxEncoder* enc, uint8_t stage, VertexBufferHandle handle, GpuAccessFlag::Enum access);
+        void(*setComputeBufferDynamicIb)(GfxEncoder* enc, uint8_t stage, DynamicIndexBufferHandle handle, GpuAccessFlag::Enum access);
+        void(*setComputeBufferDynamicVb)(GfxEncoder* enc, uint8_t stage, DynamicVertexBufferHandle handle, GpuAccessFlag::Enum access);
+        void(*setComputeBufferIndirect)(GfxEncoder* enc, uint8_t stage, IndirectBufferHandle handle, GpuAccessFlag::Enum access);
+        void(*setComputeImage)(GfxEncoder* enc, uint8_t stage, TextureHandle handle, uint8_t mip,
+                               GpuAccessFlag::Enum access, TextureFormat::Enum fmt);
+        void(*computeDispatch)(GfxEncoder* enc, uint8_t viewId, ProgramHandle handle, uint32_t numX, uint32_t numY, uint32_t numZ,
+                               GfxSubmitFlag::Bits flags/* = GfxSubmitFlag::Left*/);
+        void(*computeDispatchIndirect)(GfxEncoder* enc, uint8_t viewId, ProgramHandle handle, IndirectBufferHandle indirectHandle,
+                                       uint16_t start, uint16_t num, GfxSubmitFlag::Bits flags/* = GfxSubmitFlag::Left*/);
+
+        // Blit
+        void(*blit)(GfxEncoder* enc, uint8_t viewId, TextureHandle dest, uint16_t destX, uint16_t destY, TextureHandle src,
+                    uint16_t srcX/* = 0*/, uint16_t srcY/* = 0*/, uint16_t width/* = UINT16_MAX*/, uint16_t height/* = UINT16_MAX*/);
+    };
+
     struct GfxDriver
     {
     public:
@@ -302,6 +368,18 @@ namespace tee
         void(*dbgTextClear)(uint8_t attr, bool smallText/* = false*/);
         void(*dbgTextPrintf)(uint16_t x, uint16_t y, uint8_t attr, const char* format, ...);
         void(*dbgTextImage)(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const void* data, uint16_t pitch);
+
+        // Newer entries are appended, so drivers built with older headers keep working
+        // Encoders: Submit draw calls from jobs in parallel, each job begins it's own encoder and ends it when it's done
+        // Returns nullptr if all encoders are in use. Calling beginEncoder on the main thread returns the main encoder
+        // All encoders must be ended before 'frame' is called
+        GfxEncoder* (*beginEncoder)();
+        void(*endEncoder)(GfxEncoder* enc);
+        GfxEncoderApi encoder;
+
+        // Same as allocTransientBuffers, but allows more than 64k indices (index values are still 16bit)
+        bool(*allocTransientBuffers32)(TransientVertexBuffer* tvb, const VertexDecl& decl, uint32_t numVerts,
+                                       TransientIndexBuffer* tib, uint32_t numIndices);
     };
 }   // namespace tee
 
@@ -85,6 +85,11 @@ namespace tee
         TEE_API void setRenderMode(SpriteRenderMode::Enum mode);
         TEE_API SpriteRenderMode::Enum getRenderMode();
 
+        // Draws quad sprites with GPU instancing when the default program is used (disabled by default)
+        // Has no effect if the device doesn't support instancing
+        TEE_API void setInstancing(bool enable);
+        TEE_API bool isInstancingEnabled();
+
         TEE_API Sprite* create(bx::AllocatorI* alloc, const vec2_t halfSize);
         TEE_API void destroy(Sprite* sprite);
 
@@ -215,6 +220,20 @@ namespace tee
                                ProgramHandle progOverride = ProgramHandle(),
                                sprite::StateCallback stateCallback = nullptr,
                                void* stateUserData = nullptr);
+
+        // Dynamic caches are split into tiles of 'tileSize' (world units, <= 0 for a single tile)
+        // Each tile is culled separately in drawCache and sprites can be moved later with updateCache
+        TEE_API SpriteCache* createDynamicCache(bx::AllocatorI* alloc, Sprite** sprites, uint16_t numSprites,
+                                                const mat3_t* mats, float tileSize, const ucolor_t* colors = nullptr);
+        // Updates a single sprite ('index' is the index passed to createDynamicCache) with it's current frame
+        // Returns false if the current frame's texture or geometry size is different from the one in the cache
+        TEE_API bool updateCache(SpriteCache* spriteCache, int index, const mat3_t& mat,
+                                 const ucolor_t* color = nullptr);
+        // Draws only the tiles that intersect 'viewRect', get it with tmath::cam2dGetViewRect for Camera2D
+        TEE_API void drawCache(uint8_t viewId, SpriteCache* spriteCache, const rect_t& viewRect,
+                               ProgramHandle progOverride = ProgramHandle(),
+                               sprite::StateCallback stateCallback = nullptr,
+                               void* stateUserData = nullptr);
         TEE_API void destroyCache(SpriteCache* spriteCache);
         TEE_API rect_t getCacheBounds(SpriteCache* spriteCache);
 
@@ -0,0 +1,123 @@
+#pragma once
+
+namespace tee {
+    namespace detail {
+        template <typename BodyFn>
+        struct ParallelContext
+        {
+            const BodyFn* body;
+            int begin;
+            int end;
+            int grainSize;
+            int numChunks;
+            volatile int32_t nextChunk;
+        };
+
+        // Jobs and the calling thread keep claiming chunks until there is none left
+        // So if the dispatcher runs out of fibers and drops some of the jobs, no work is lost
+        template <typename BodyFn>
+        void runParallelChunks(ParallelContext<BodyFn>* ctx)
+        {
+            int chunk;
+            while ((chunk = bx::atomicFetchAndAdd<int32_t>(&ctx->nextChunk, 1)) < ctx->numChunks) {
+                int first = ctx->begin + chunk*ctx->grainSize;
+                int last = bx::min<int>(first + ctx->grainSize, ctx->end);
+                (*ctx->body)(first, last, chunk);
+            }
+        }
+
+        template <typename BodyFn>
+        void parallelJobCallback(int jobIndex, void* userParam)
+        {
+            runParallelChunks<BodyFn>((ParallelContext<BodyFn>*)userParam);
+        }
+
+        // Splits the range and runs 'body(first, last, chunkIndex)' on all chunks, returns number of chunks
+        template <typename BodyFn>
+        int runParallel(int begin, int end, int grainSize, const BodyFn& body, JobPriority::Enum priority)
+        {
+            int count = end > begin ? end - begin : 0;
+            if (count == 0)
+                return 0;
+
+            if (grainSize <= 0) {
+                // Roughly 4 chunks per thread, so uneven chunks can be balanced between threads
+                int numTargetChunks = (int(getNumWorkerThreads()) + 1) * 4;
+                grainSize = (count + numTargetChunks - 1) / numTargetChunks;
+            }
+            grainSize = bx::max<int>(grainSize, (count + kParallelMaxChunks - 1) / kParallelMaxChunks);
+            grainSize = bx::max<int>(grainSize, 1);
+
+            ParallelContext<BodyFn> ctx;
+            ctx.body = &body;
+            ctx.begin = begin;
+            ctx.end = end;
+            ctx.grainSize = grainSize;
+            ctx.numChunks = (count + grainSize - 1) / grainSize;
+            ctx.nextChunk = 0;
+
+            // Calling thread processes one of the chunks itself
+            JobHandle handle;
+            int numJobs = bx::min<int>(ctx.numChunks - 1, getNumWorkerThreads());
+            if (numJobs > 0) {
+                JobDesc jobs[kParallelMaxChunks];
+                for (int i = 0; i < numJobs; i++)
+                    jobs[i] = JobDesc(parallelJobCallback<BodyFn>, &ctx, priority);
+                handle = dispatchSmallJobs(jobs, uint16_t(numJobs));
+            }
+
+            runParallelChunks<BodyFn>(&ctx);
+
+            if (handle.isValid())
+                waitAndDeleteJob(handle);
+            return ctx.numChunks;
+        }
+
+        template <typename Fn>
+        struct ParallelForBody
+        {
+            const Fn* fn;
+
+            void operator()(int first, int last, int chunk) const
+            {
+                (*fn)(first, last);
+            }
+        };
+
+        template <typename T, typename Fn>
+        struct ParallelReduceBody
+        {
+            const Fn* fn;
+            T* partials;
+
+            void operator()(int first, int last, int chunk) const
+            {
+                partials[chunk] = (*fn)(first, last);
+            }
+        };
+    }   // namespace detail
+
+    template <typename Fn>
+    void parallelFor(int begin, int end, int grainSize, const Fn& fn, JobPriority::Enum priority) TEE_THREAD_SAFE
+    {
+        detail::ParallelForBody<Fn> body;
+        body.fn = &fn;
+        detail::runParallel(begin, end, grainSize, body, priority);
+    }
+
+    template <typename T, typename Fn, typename ReduceFn>
+    T parallelReduce(int begin, int end, int grainSize, const T& identity, const Fn& fn, const ReduceFn& reduceFn,
+                     JobPriority::Enum priority) TEE_THREAD_SAFE
+    {
+        T partials[kParallelMaxChunks];
+        detail::ParallelReduceBody<T, Fn> body;
+        body.fn = &fn;
+        body.partials = partials;
+        int numChunks = detail::runParallel(begin, end, grainSize, body, priority);
+
+        T result = identity;
+        for (int i = 0; i < numChunks; i++)
+            result = reduceFn(result, partials[i]);
+        return result;
+    }
+}   // namespace tee
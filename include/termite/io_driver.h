@@ -34,6 +34,22 @@ namespace tee
         typedef uint8_t Bits;
     };
 
+    struct IoStreamParams
+    {
+        uint32_t chunkSize;             /// Size of each block returned by readStream
+        uint8_t numReadAhead;           /// (Async) Number of chunks that are read before they are requested
+        uint16_t maxPendingWrites;      /// (Async) Number of blocks that are not written yet, before writeStream refuses more
+        IoDriverEventsI* callbacks;     /// (Async) Receives the stream events, nullptr = driver callbacks
+
+        IoStreamParams() :
+            chunkSize(64*1024),
+            numReadAhead(2),
+            maxPendingWrites(64),
+            callbacks(nullptr)
+        {
+        }
+    };
+
     struct IoPathType
     {
         enum Enum
@@ -47,8 +63,14 @@ namespace tee
     // Async: All driver operations are done in async mode, and every return value (read, write, openStream, etc...)
     //        will return invalid values. These values should be checked through the callbacks
     //        'runAsyncLoop' should also be called in every engine loop iteration
+    //        Streams are the exception: 'openStream' returns the stream handle that is used for later calls
+    //        'readStream' requests the next chunk, which is passed to 'onReadStream' (nullptr at the end of the stream)
+    //        Chunks are read ahead in background, at most 'numReadAhead' chunks are kept that are not requested yet
+    //        'writeStream' queues the block and returns it's size, or 0 if the stream has 'maxPendingWrites' blocks
+    //        that are not written yet (write queue is full), in that case the caller should try again later
     // Sync: All driver operations are done in blocking mode, callbacks doesn't work, instead the caller should check
     //       For return values of functions
+    // Memory blocks returned by reads may reference read-only memory (disk driver's asset pack), treat them as immutable
     struct IoOperationMode
     {
         enum Enum
@@ -72,7 +94,9 @@ namespace tee
     {
         enum Enum
         {
-            RawRead = 0x1
+            RawRead = 0x1,
+            HighPriority = 0x2,     /// Async: Read before normal requests (ex. assets that are needed right away)
+            LowPriority = 0x4       /// Async: Read after normal requests (ex. prefetch)
         };
 
         typedef uint8_t Bits;
@@ -92,7 +116,10 @@ namespace tee
         MemoryBlock* (*read)(const char* uri, IoPathType::Enum pathType/* = IoPathType::Assets*/, IoReadFlags::Bits flags/* = 0*/);
         size_t(*write)(const char* uri, const MemoryBlock* mem, IoPathType::Enum pathType/* = IoPathType::Assets*/);
 
-        IoStream* (*openStream)(const char* uri, IoStreamFlag flags);
+        // Streams are opened for either READ or WRITE, 'params' = nullptr uses the defaults
+        // Read chunks are owned by the caller and must be released with releaseMemoryBlock
+        IoStream* (*openStream)(const char* uri, IoStreamFlag::Bits flags, IoPathType::Enum pathType, 
+                                const IoStreamParams* params/* = nullptr*/);
         size_t(*writeStream)(IoStream* stream, const MemoryBlock* mem);
         MemoryBlock* (*readStream)(IoStream* stream);
         void(*closeStream)(IoStream* stream);
@@ -101,6 +128,16 @@ namespace tee
 
         IoOperationMode::Enum(*getOpMode)();
         const char* (*getUri)();
+
+        // Newer entries are appended, so drivers built with older headers keep working
+        // Async (optional): Cancels a read of 'uri' that is not finished yet, no callbacks are called for it
+        bool(*cancelRead)(const char* uri, IoPathType::Enum pathType);
+
+        // Async (optional): Maximum number of requests that are processed at the same time, 0 = driver default
+        void(*setMaxRequests)(int maxRequests);
+
+        // Number of blocks that are passed to writeStream but not written yet, always 0 for blocking drivers
+        int(*getStreamPendingWrites)(IoStream* stream);
     };
 
     // Used for plugins that support both async and blocking modes
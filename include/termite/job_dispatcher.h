@@ -1,6 +1,8 @@
 #pragma once
 
+#include "types.h"
 #include "bx/allocator.h"
+#include "bx/cpu.h"
 
 namespace tee
 {
@@ -40,11 +42,64 @@ namespace tee
     };
 
     typedef volatile int32_t JobCounter;
-    typedef JobCounter* JobHandle;
+
+    // Index and generation of the job counter, generation changes when the counter is deleted
+    // So using a handle after deleting it is detected (and warned) instead of touching a recycled counter
+    struct JobHandleT {};
+    typedef PhantomType<uint32_t, JobHandleT, 0> JobHandle;
+
+    // Idle (sleep) durations histogram, bucket 'i' counts sleeps shorter than 16us*4^i, last bucket counts the rest
+    static const int kJobIdleHistogramSize = 8;
+
+    // Stats are collected by each thread without any synchronization, so they are approximate
+    struct JobThreadStats
+    {
+        uint32_t threadId;
+        int16_t cpu;                // Logical cpu that the thread is locked to, -1 if it's not locked
+        uint64_t numJobs;           // Jobs executed by this thread
+        uint64_t numSteals;         // Jobs stolen from other threads' queues
+        uint64_t numFailedSteals;   // Lost the race to the owner or another thief
+        int64_t idleTime;           // Time spent sleeping for jobs (HP counter ticks)
+        uint32_t numBlocked;        // Fibers that are currently suspended by waitAndDeleteJob
+        uint32_t maxWaitStacks;     // High-water mark of used wait stacks
+        uint32_t queueDepth[JobPriority::Count];    // Jobs in local queues at the time of query
+        uint32_t idleHistogram[kJobIdleHistogramSize];
+    };
+
+    struct JobDispatcherStats
+    {
+        int64_t elapsedTime;        // Time since last resetJobDispatcherStats call (HP counter ticks)
+        int64_t timerFreq;
+
+        uint16_t numSmallFibers;    // Small fibers in use
+        uint16_t peakSmallFibers;
+        uint16_t poolSmallFibers;   // Current size of the pool, grows on demand up to maxSmallFibers
+        uint16_t maxSmallFibers;    // Reserved size
+        uint16_t committedSmallStacks;  // Stacks that have physical memory committed
+        uint16_t numBigFibers;      // Big fibers in use
+        uint16_t peakBigFibers;
+        uint16_t poolBigFibers;
+        uint16_t maxBigFibers;
+        uint16_t committedBigStacks;
+        uint16_t maxWaitStacks;     // Wait stacks available for each thread
+
+        uint8_t numThreads;         // Including the main thread
+        const JobThreadStats* threads;  // First one is always the main thread
+    };
     
     TEE_API JobHandle dispatchSmallJobs(const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE;
     TEE_API JobHandle dispatchBigJobs(const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE;
 
+    /// Dispatches jobs after 'dep' is finished, without blocking a fiber in between
+    /// 'dep' is consumed: it's deleted automatically when it's done, so don't wait on or delete it afterwards
+    /// Multiple continuations can be added to the same 'dep'. Invalid 'dep' dispatches the jobs right away
+    /// Returns the handle of the new jobs, which can be waited on or used as a dependency itself
+    TEE_API JobHandle dispatchSmallJobsAfter(JobHandle dep, const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE;
+    TEE_API JobHandle dispatchBigJobsAfter(JobHandle dep, const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE;
+
+    /// Returns a handle that is done when all 'deps' are done, 'deps' are consumed like dispatchXXXAfter
+    TEE_API JobHandle whenAll(const JobHandle* deps, uint16_t numDeps) TEE_THREAD_SAFE;
+
     /// Waits on job until all sub-tasks are finished, Deletes after wait automatically
     TEE_API void waitAndDeleteJob(JobHandle handle) TEE_THREAD_SAFE;
 
@@ -52,6 +107,36 @@ namespace tee
     TEE_API bool isJobDone(JobHandle handle) TEE_THREAD_SAFE;
     TEE_API void deleteJob(JobHandle handle) TEE_THREAD_SAFE;
 	TEE_API uint8_t getNumWorkerThreads();    
+
+    /// Takes a snapshot of the dispatcher stats, busy time of each thread is 'elapsedTime - idleTime'
+    TEE_API const JobDispatcherStats& getJobDispatcherStats();
+    TEE_API void resetJobDispatcherStats();
+
+    /// Emits a Remotery sample for every job that is executed (only works if RMT_ENABLED=1)
+    TEE_API void setJobProfiling(bool enable);
+
+    /// Returns stack memory of unused fibers to the OS, stacks are committed again when the fibers are reused
+    /// Call it after a burst of jobs (loading, etc.) if memory matters. Jobs must not be running in the meantime
+    TEE_API void releaseIdleFiberStacks();
+
+    /// Maximum number of chunks that parallelFor/parallelReduce split the range into
+    static const int kParallelMaxChunks = 64;
+
+    /// Splits [begin, end) into chunks and runs 'fn(chunkBegin, chunkEnd)' on them in parallel
+    /// grainSize: minimum number of items per chunk, pass 0 to pick one automatically from the number of worker threads
+    /// Blocks until all chunks are processed. Can be called within a running job, no heap allocations are made
+    template <typename Fn>
+    void parallelFor(int begin, int end, int grainSize, const Fn& fn, 
+                     JobPriority::Enum priority = JobPriority::Normal) TEE_THREAD_SAFE;
+
+    /// Same as parallelFor, but each chunk returns a partial result: 'T fn(chunkBegin, chunkEnd)'
+    /// Partial results are combined with 'T reduceFn(const T& a, const T& b)' in chunk order, so the result is deterministic
+    /// T must be default constructible and copyable
+    template <typename T, typename Fn, typename ReduceFn>
+    T parallelReduce(int begin, int end, int grainSize, const T& identity, const Fn& fn, const ReduceFn& reduceFn,
+                     JobPriority::Enum priority = JobPriority::Normal) TEE_THREAD_SAFE;
 } // namespace tee
 
+#include "inline/job_dispatcher.inl"
+
 
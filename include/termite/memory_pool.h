@@ -7,6 +7,8 @@ namespace tee
     bool initMemoryPool(bx::AllocatorI* alloc, size_t pageSize = 0, int maxPagesPerPool = 0);
     void shutdownMemoryPool();
 
+    /// Pages are taken from a per-thread cache, so allocating doesn't lock in the common case
+    /// Tag must be non-zero
     TEE_API bx::AllocatorI* allocMemPage(uint64_t tag) TEE_THREAD_SAFE;
     TEE_API void freeMemTag(uint64_t tag) TEE_THREAD_SAFE;
 
@@ -41,6 +43,11 @@ namespace tee
             m_linAlloc = nullptr;
         }
 
+        uint64_t getTag() const
+        {
+            return m_tag;
+        }
+
     private:
         uint64_t m_tag;
         bx::AllocatorI* m_linAlloc;
@@ -94,6 +94,8 @@ namespace tee
 #include "job_dispatcher.h"
 
 namespace tee {
+    // Version 1: JobHandle is a generation checked counter index (it was JobCounter* in version 0)
+    //            Version 0 is not served anymore, so old plugins fail to load instead of passing pointers as handles
     struct CoreApi
     {
         MemoryBlock* (*createMemoryBlock)(uint32_t size, bx::AllocatorI* alloc);
@@ -130,6 +132,12 @@ namespace tee {
         void (*waitAndDeleteJob)(JobHandle handle) TEE_THREAD_SAFE;
         bool (*isJobDone)(JobHandle handle) TEE_THREAD_SAFE;
         void (*deleteJob)(JobHandle handle) TEE_THREAD_SAFE;
+
+        JobHandle (*dispatchSmallJobsAfter)(JobHandle dep, const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE;
+        JobHandle (*dispatchBigJobsAfter)(JobHandle dep, const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE;
+        JobHandle (*whenAll)(const JobHandle* deps, uint16_t numDeps) TEE_THREAD_SAFE;
+
+        MemoryBlock* (*refMemoryBlockPtrOwned)(const void* data, uint32_t size, bx::AllocatorI* ownerAlloc);
     };
 }
 #endif
@@ -461,6 +469,8 @@ namespace tee
 
 namespace tee
 {
+	// Version 1: registerComponent takes the current ComponentCallbacks (packed and parallel update fields)
+	// Version 0 plugins are built with the older ComponentCallbacks, the newer fields get their defaults
 	struct EcsApi
 	{
 		EntityManager* (*createEntityManager)(bx::AllocatorI* alloc, int bufferSize/* = 0*/);
@@ -486,6 +496,10 @@ namespace tee
         void (*updateGroup)(ComponentUpdateStage::Enum stage, ComponentGroupHandle groupHandle, float dt);
         ComponentGroupHandle (*createGroup)(bx::AllocatorI* alloc, uint16_t poolSize);
         void (*destroyGroup)(ComponentGroupHandle handle);
+
+        // Newer entries are appended, so plugins built with older headers keep working
+        void (*updateType)(ComponentUpdateStage::Enum stage, ComponentTypeHandle typeHandle, float dt);
+        int (*garbageCollectBudget)(EntityManager* emgr, int budgetMicros/* = 0*/, int maxEntities/* = 0*/);
 	};
 } // namespace tee
 #endif
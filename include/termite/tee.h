@@ -83,8 +83,12 @@ namespace tee
         uint16_t maxBigFibers;
         uint16_t bigFiberSize;      // in Kb
         uint8_t numWorkerThreads;
+        uint8_t numReservedCores;   // Cores that are not used by worker threads (main, render, ...)
         InitEngineFlags::Bits engineFlags;
 
+        // IO
+        uint16_t ioMaxRequests;     // Async IO requests that are processed at the same time (0 = driver default)
+
         // Memory
         uint32_t pageSize;          // in Kb
         int maxPagesPerPool;
@@ -120,8 +124,11 @@ namespace tee
             maxSmallFibers = maxBigFibers = 0;
             smallFiberSize = bigFiberSize = 0;
             numWorkerThreads = UINT8_MAX;
+            numReservedCores = 1;
             engineFlags = InitEngineFlags::EnableJobDispatcher;
 
+            ioMaxRequests = 0;
+
             pageSize = 0;
             maxPagesPerPool = 0;
             cmdHistorySize = 32;
@@ -135,6 +142,13 @@ namespace tee
         uint32_t size;
     };
 
+    struct TempAllocStats
+    {
+        uint32_t threadId;
+        size_t frameSize;       // Temp memory used by the thread in the last finished frame
+        size_t peakSize;        // High-water mark of frameSize
+    };
+
     struct HardwareInfo
     {
         char brand[16];
@@ -202,6 +216,7 @@ namespace tee
     TEE_API void pause();
     TEE_API void resume();
     TEE_API bool isPaused();
+    /// Resets temp allocators of all threads, no job should be using temp memory at the time
     TEE_API void resetTempAlloc();
     TEE_API void resetBackbuffer(uint16_t width, uint16_t height);
 
@@ -214,6 +229,9 @@ namespace tee
 
     TEE_API MemoryBlock* createMemoryBlock(uint32_t size, bx::AllocatorI* alloc = nullptr);
     TEE_API MemoryBlock* refMemoryBlockPtr(const void* data, uint32_t size);
+    /// Same as refMemoryBlockPtr, but 'ownerAlloc' is called to free 'data' when the last reference is released
+    /// The owner can use it to keep the memory alive while the block exists
+    TEE_API MemoryBlock* refMemoryBlockPtrOwned(const void* data, uint32_t size, bx::AllocatorI* ownerAlloc);
     TEE_API MemoryBlock* refMemoryBlock(MemoryBlock* mem);
     TEE_API MemoryBlock* copyMemoryBlock(const void* data, uint32_t size, bx::AllocatorI* alloc = nullptr);
     TEE_API void releaseMemoryBlock(MemoryBlock* mem);
@@ -247,7 +265,11 @@ namespace tee
     TEE_API PhysDriver2D* getPhys2dDriver() TEE_THREAD_SAFE;
     TEE_API uint32_t getEngineVersion() TEE_THREAD_SAFE;
     TEE_API bx::AllocatorI* getHeapAlloc() TEE_THREAD_SAFE;
+    /// Returns the calling thread's frame allocator, no locks are taken unless it runs out of pages
+    /// Memory is valid until the end of the next frame, then it's reclaimed without any free calls
+    /// Jobs may keep the pointer across waits, allocations are always made from the current thread's pages
     TEE_API bx::AllocatorI* getTempAlloc() TEE_THREAD_SAFE;
+    TEE_API int getTempAllocStats(TempAllocStats* stats, int maxStats) TEE_THREAD_SAFE;
     TEE_API const Config& getConfig() TEE_THREAD_SAFE;
     TEE_API Config* getMutableConfig() TEE_THREAD_SAFE;
     TEE_API void setCacheDir(const char* dir);
@@ -665,6 +665,246 @@ static void blitMip(uint8_t viewId, TextureHandle dest, uint8_t destMip, uint16_
     bgfx::blit(viewId, d, destMip, destX, destY, destZ, s, srcMip, srcX, srcY, srcZ, width, height, depth);
 }
 
+// Encoders
+static GfxEncoder* beginEncoder()
+{
+    return (GfxEncoder*)bgfx::begin();
+}
+
+static void endEncoder(GfxEncoder* enc)
+{
+    bgfx::end((bgfx::Encoder*)enc);
+}
+
+static void encSetMarker(GfxEncoder* enc, const char* marker)
+{
+    ((bgfx::Encoder*)enc)->setMarker(marker);
+}
+
+static void encSetState(GfxEncoder* enc, GfxState::Bits state, uint32_t rgba)
+{
+    ((bgfx::Encoder*)enc)->setState(state, rgba);
+}
+
+static void encSetStencil(GfxEncoder* enc, GfxStencilState::Bits frontStencil, GfxStencilState::Bits backStencil)
+{
+    ((bgfx::Encoder*)enc)->setStencil(frontStencil, backStencil);
+}
+
+static uint16_t encSetScissor(GfxEncoder* enc, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    return ((bgfx::Encoder*)enc)->setScissor(x, y, width, height);
+}
+
+static void encSetScissorCache(GfxEncoder* enc, uint16_t cache)
+{
+    ((bgfx::Encoder*)enc)->setScissor(cache);
+}
+
+static void encSetCondition(GfxEncoder* enc, OcclusionQueryHandle handle, bool visible)
+{
+    BGFX_DECLARE_HANDLE(OcclusionQueryHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setCondition(h, visible);
+}
+
+static void encTouch(GfxEncoder* enc, uint8_t id)
+{
+    ((bgfx::Encoder*)enc)->touch(id);
+}
+
+static void encDiscard(GfxEncoder* enc)
+{
+    ((bgfx::Encoder*)enc)->discard();
+}
+
+static uint32_t encAllocTransform(GfxEncoder* enc, GpuTransform* transform, uint16_t num)
+{
+    bgfx::Transform t;
+    uint32_t r = ((bgfx::Encoder*)enc)->allocTransform(&t, num);
+    transform->data = t.data;
+    transform->num = t.num;
+    return r;
+}
+
+static uint32_t encSetTransform(GfxEncoder* enc, const void* mtx, uint16_t num)
+{
+    return ((bgfx::Encoder*)enc)->setTransform(mtx, num);
+}
+
+static void encSetTransformCached(GfxEncoder* enc, uint32_t cache, uint16_t num)
+{
+    ((bgfx::Encoder*)enc)->setTransform(cache, num);
+}
+
+static void encSetUniform(GfxEncoder* enc, UniformHandle handle, const void* value, uint16_t num)
+{
+    BGFX_DECLARE_HANDLE(UniformHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setUniform(h, value, num);
+}
+
+static void encSetIndexBuffer(GfxEncoder* enc, IndexBufferHandle handle, uint32_t firstIndex, uint32_t numIndices)
+{
+    BGFX_DECLARE_HANDLE(IndexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setIndexBuffer(h, firstIndex, numIndices);
+}
+
+static void encSetDynamicIndexBuffer(GfxEncoder* enc, DynamicIndexBufferHandle handle, uint32_t firstIndex, uint32_t numIndices)
+{
+    BGFX_DECLARE_HANDLE(DynamicIndexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setIndexBuffer(h, firstIndex, numIndices);
+}
+
+static void encSetTransientIndexBufferI(GfxEncoder* enc, const TransientIndexBuffer* tib, uint32_t firstIndex, uint32_t numIndices)
+{
+    ((bgfx::Encoder*)enc)->setIndexBuffer((const bgfx::TransientIndexBuffer*)tib, firstIndex, numIndices);
+}
+
+static void encSetTransientIndexBuffer(GfxEncoder* enc, const TransientIndexBuffer* tib)
+{
+    ((bgfx::Encoder*)enc)->setIndexBuffer((const bgfx::TransientIndexBuffer*)tib);
+}
+
+static void encSetVertexBuffer(GfxEncoder* enc, uint8_t stream, VertexBufferHandle handle)
+{
+    BGFX_DECLARE_HANDLE(VertexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setVertexBuffer(stream, h);
+}
+
+static void encSetVertexBufferI(GfxEncoder* enc, uint8_t stream, VertexBufferHandle handle, uint32_t vertexIndex, 
+                                uint32_t numVertices)
+{
+    BGFX_DECLARE_HANDLE(VertexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setVertexBuffer(stream, h, vertexIndex, numVertices);
+}
+
+static void encSetDynamicVertexBuffer(GfxEncoder* enc, uint8_t stream, DynamicVertexBufferHandle handle, 
+                                      uint32_t startVertex, uint32_t numVertices)
+{
+    BGFX_DECLARE_HANDLE(DynamicVertexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setVertexBuffer(stream, h, startVertex, numVertices);
+}
+
+static void encSetTransientVertexBuffer(GfxEncoder* enc, uint8_t stream, const TransientVertexBuffer* tvb)
+{
+    ((bgfx::Encoder*)enc)->setVertexBuffer(stream, (const bgfx::TransientVertexBuffer*)tvb);
+}
+
+static void encSetTransientVertexBufferI(GfxEncoder* enc, uint8_t stream, const TransientVertexBuffer* tvb, 
+                                         uint32_t startVertex, uint32_t numVertices)
+{
+    ((bgfx::Encoder*)enc)->setVertexBuffer(stream, (const bgfx::TransientVertexBuffer*)tvb, startVertex, numVertices);
+}
+
+static void encSetInstanceDataBuffer(GfxEncoder* enc, const InstanceDataBuffer* idb, uint32_t start, uint32_t num)
+{
+    ((bgfx::Encoder*)enc)->setInstanceDataBuffer((const bgfx::InstanceDataBuffer*)idb, start, num);
+}
+
+static void encSetInstanceDataBufferVb(GfxEncoder* enc, VertexBufferHandle handle, uint32_t startVertex, uint32_t num)
+{
+    BGFX_DECLARE_HANDLE(VertexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setInstanceDataBuffer(h, startVertex, num);
+}
+
+static void encSetInstanceDataBufferDynamicVb(GfxEncoder* enc, DynamicVertexBufferHandle handle, uint32_t startVertex, 
+                                              uint32_t num)
+{
+    BGFX_DECLARE_HANDLE(DynamicVertexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setInstanceDataBuffer(h, startVertex, num);
+}
+
+static void encSetTexture(GfxEncoder* enc, uint8_t stage, UniformHandle sampler, TextureHandle handle, TextureFlag::Bits flags)
+{
+    BGFX_DECLARE_HANDLE(UniformHandle, s, sampler);
+    BGFX_DECLARE_HANDLE(TextureHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setTexture(stage, s, h, flags);
+}
+
+static void encSubmit(GfxEncoder* enc, uint8_t viewId, ProgramHandle program, int32_t depth, bool preserveState)
+{
+    BGFX_DECLARE_HANDLE(ProgramHandle, p, program);
+    ((bgfx::Encoder*)enc)->submit(viewId, p, depth, preserveState);
+}
+
+static void encSubmitWithOccQuery(GfxEncoder* enc, uint8_t viewId, ProgramHandle program, OcclusionQueryHandle occQuery, 
+                                  int32_t depth, bool preserveState)
+{
+    BGFX_DECLARE_HANDLE(ProgramHandle, p, program);
+    BGFX_DECLARE_HANDLE(OcclusionQueryHandle, o, occQuery);
+    ((bgfx::Encoder*)enc)->submit(viewId, p, o, depth, preserveState);
+}
+
+static void encSubmitIndirect(GfxEncoder* enc, uint8_t viewId, ProgramHandle program, IndirectBufferHandle indirectHandle, 
+                              uint16_t start, uint16_t num, int32_t depth, bool preserveState)
+{
+    BGFX_DECLARE_HANDLE(ProgramHandle, p, program);
+    BGFX_DECLARE_HANDLE(IndirectBufferHandle, i, indirectHandle);
+    ((bgfx::Encoder*)enc)->submit(viewId, p, i, start, num, depth, preserveState);
+}
+
+static void encSetComputeBufferIb(GfxEncoder* enc, uint8_t stage, IndexBufferHandle handle, GpuAccessFlag::Enum access)
+{
+    BGFX_DECLARE_HANDLE(IndexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setBuffer(stage, h, (bgfx::Access::Enum)access);
+}
+
+static void encSetComputeBufferVb(GfxEncoder* enc, uint8_t stage, VertexBufferHandle handle, GpuAccessFlag::Enum access)
+{
+    BGFX_DECLARE_HANDLE(VertexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setBuffer(stage, h, (bgfx::Access::Enum)access);
+}
+
+static void encSetComputeBufferDynamicIb(GfxEncoder* enc, uint8_t stage, DynamicIndexBufferHandle handle, 
+                                         GpuAccessFlag::Enum access)
+{
+    BGFX_DECLARE_HANDLE(DynamicIndexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setBuffer(stage, h, (bgfx::Access::Enum)access);
+}
+
+static void encSetComputeBufferDynamicVb(GfxEncoder* enc, uint8_t stage, DynamicVertexBufferHandle handle, 
+                                         GpuAccessFlag::Enum access)
+{
+    BGFX_DECLARE_HANDLE(DynamicVertexBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setBuffer(stage, h, (bgfx::Access::Enum)access);
+}
+
+static void encSetComputeBufferIndirect(GfxEncoder* enc, uint8_t stage, IndirectBufferHandle handle, GpuAccessFlag::Enum access)
+{
+    BGFX_DECLARE_HANDLE(IndirectBufferHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setBuffer(stage, h, (bgfx::Access::Enum)access);
+}
+
+static void encSetComputeImage(GfxEncoder* enc, uint8_t stage, TextureHandle handle, uint8_t mip,
+                               GpuAccessFlag::Enum access, TextureFormat::Enum fmt)
+{
+    BGFX_DECLARE_HANDLE(TextureHandle, h, handle);
+    ((bgfx::Encoder*)enc)->setImage(stage, h, mip, (bgfx::Access::Enum)access, (bgfx::TextureFormat::Enum)fmt);
+}
+
+static void encComputeDispatch(GfxEncoder* enc, uint8_t viewId, ProgramHandle handle, uint32_t numX, uint32_t numY, 
+                               uint32_t numZ, GfxSubmitFlag::Bits flags)
+{
+    BGFX_DECLARE_HANDLE(ProgramHandle, h, handle);
+    ((bgfx::Encoder*)enc)->dispatch(viewId, h, numX, numY, numZ, flags);
+}
+
+static void encComputeDispatchIndirect(GfxEncoder* enc, uint8_t viewId, ProgramHandle handle, 
+                                       IndirectBufferHandle indirectHandle, uint16_t start, uint16_t num, 
+                                       GfxSubmitFlag::Bits flags)
+{
+    BGFX_DECLARE_HANDLE(ProgramHandle, h, handle);
+    BGFX_DECLARE_HANDLE(IndirectBufferHandle, i, indirectHandle);
+    ((bgfx::Encoder*)enc)->dispatch(viewId, h, i, start, num, flags);
+}
+
+static void encBlit(GfxEncoder* enc, uint8_t viewId, TextureHandle dest, uint16_t destX, uint16_t destY, TextureHandle src,
+                    uint16_t srcX, uint16_t srcY, uint16_t width, uint16_t height)
+{
+    BGFX_DECLARE_HANDLE(TextureHandle, d, dest);
+    BGFX_DECLARE_HANDLE(TextureHandle, s, src);
+    ((bgfx::Encoder*)enc)->blit(viewId, d, destX, destY, s, srcX, srcY, width, height);
+}
+
 static const GfxMemory* allocMem(uint32_t size)
 {
     return (const GfxMemory*)bgfx::alloc(size);
@@ -792,8 +1032,8 @@ static void allocTransientVertexBuffer(TransientVertexBuffer* tvb, uint32_t num,
     gBgfx.stats.maxTvbSize = bx::uint32_max(gBgfx.stats.allocTvbSize, gBgfx.stats.maxTvbSize);
 }
 
-static bool allocTransientBuffers(TransientVertexBuffer* tvb, const VertexDecl& decl, uint32_t numVerts,
-                                  TransientIndexBuffer* tib, uint16_t numIndices)
+static bool allocTransientBuffers32(TransientVertexBuffer* tvb, const VertexDecl& decl, uint32_t numVerts,
+                                    TransientIndexBuffer* tib, uint32_t numIndices)
 {
     bool r = bgfx::allocTransientBuffers((bgfx::TransientVertexBuffer*)tvb, (const bgfx::VertexDecl&)decl, numVerts,
                                          (bgfx::TransientIndexBuffer*)tib, numIndices);
@@ -804,6 +1044,12 @@ static bool allocTransientBuffers(TransientVertexBuffer* tvb, const VertexDecl&
     return r;
 }
 
+static bool allocTransientBuffers(TransientVertexBuffer* tvb, const VertexDecl& decl, uint32_t numVerts,
+                                  TransientIndexBuffer* tib, uint16_t numIndices)
+{
+    return allocTransientBuffers32(tvb, decl, numVerts, tib, numIndices);
+}
+
 static IndexBufferHandle createIndexBuffer(const GfxMemory* mem, GfxBufferFlag::Bits flags)
 {
     IndexBufferHandle handle;
@@ -1180,6 +1426,46 @@ void* initBgfxDriver(bx::AllocatorI* alloc, GetApiFunc getApi)
     api.dbgTextClear = dbgTextClear;
     api.dbgTextPrintf = dbgTextPrintf;
     api.dbgTextImage = dbgTextImage;
+    api.beginEncoder = beginEncoder;
+    api.endEncoder = endEncoder;
+    api.encoder.setMarker = encSetMarker;
+    api.encoder.setState = encSetState;
+    api.encoder.setStencil = encSetStencil;
+    api.encoder.setScissor = encSetScissor;
+    api.encoder.setScissorCache = encSetScissorCache;
+    api.encoder.setCondition = encSetCondition;
+    api.encoder.touch = encTouch;
+    api.encoder.discard = encDiscard;
+    api.encoder.allocTransform = encAllocTransform;
+    api.encoder.setTransform = encSetTransform;
+    api.encoder.setTransformCached = encSetTransformCached;
+    api.encoder.setUniform = encSetUniform;
+    api.encoder.setIndexBuffer = encSetIndexBuffer;
+    api.encoder.setDynamicIndexBuffer = encSetDynamicIndexBuffer;
+    api.encoder.setTransientIndexBufferI = encSetTransientIndexBufferI;
+    api.encoder.setTransientIndexBuffer = encSetTransientIndexBuffer;
+    api.encoder.setVertexBuffer = encSetVertexBuffer;
+    api.encoder.setVertexBufferI = encSetVertexBufferI;
+    api.encoder.setDynamicVertexBuffer = encSetDynamicVertexBuffer;
+    api.encoder.setTransientVertexBuffer = encSetTransientVertexBuffer;
+    api.encoder.setTransientVertexBufferI = encSetTransientVertexBufferI;
+    api.encoder.setInstanceDataBuffer = encSetInstanceDataBuffer;
+    api.encoder.setInstanceDataBufferVb = encSetInstanceDataBufferVb;
+    api.encoder.setInstanceDataBufferDynamicVb = encSetInstanceDataBufferDynamicVb;
+    api.encoder.setTexture = encSetTexture;
+    api.encoder.submit = encSubmit;
+    api.encoder.submitWithOccQuery = encSubmitWithOccQuery;
+    api.encoder.submitIndirect = encSubmitIndirect;
+    api.encoder.setComputeBufferIb = encSetComputeBufferIb;
+    api.encoder.setComputeBufferVb = encSetComputeBufferVb;
+    api.encoder.setComputeBufferDynamicIb = encSetComputeBufferDynamicIb;
+    api.encoder.setComputeBufferDynamicVb = encSetComputeBufferDynamicVb;
+    api.encoder.setComputeBufferIndirect = encSetComputeBufferIndirect;
+    api.encoder.setComputeImage = encSetComputeImage;
+    api.encoder.computeDispatch = encComputeDispatch;
+    api.encoder.computeDispatchIndirect = encComputeDispatchIndirect;
+    api.encoder.blit = encBlit;
+    api.allocTransientBuffers32 = allocTransientBuffers32;
 
     // Some assertions for enum matching between ours and bgfx
     static_assert(RendererType::Count == bgfx::RendererType::Count, "RendererType mismatch");
@@ -1243,7 +1529,7 @@ void* initBgfxDriver(bx::AllocatorI* alloc, GetApiFunc getApi)
     static_assert(GfxState::PrimitivePoints == BGFX_STATE_PT_POINTS, "State mismatch");
     static_assert(GfxState::MSAA == BGFX_STATE_MSAA, "State mismatch");
 
-    gTee = (CoreApi*)getApi(ApiId::Core, 0);
+    gTee = (CoreApi*)getApi(ApiId::Core, 1);
 
     return &api;
 }
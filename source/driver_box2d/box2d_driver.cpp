@@ -1237,7 +1237,7 @@ void* initBox2dDriver(bx::AllocatorI* alloc, GetApiFunc getApi)
     static PhysDriver2D api;
     bx::memSet(&api, 0x00, sizeof(api));
 
-    gTee = (CoreApi*)getApi(ApiId::Core, 0);
+    gTee = (CoreApi*)getApi(ApiId::Core, 1);
     gGfx = (GfxApi*)getApi(ApiId::Gfx, 0);
     gMath = (MathApi*)getApi(ApiId::Math, 0);
 
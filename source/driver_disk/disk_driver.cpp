@@ -8,7 +8,10 @@
 #include "bxx/pool.h"
 #include "bxx/linked_list.h"
 #include "bxx/queue.h"
+#include "bxx/array.h"
+#include "bxx/hash_table.h"
 #include "bx/mutex.h"
+#include "bx/os.h"
 
 #define TEE_CORE_API
 #include "termite/plugin_api.h"
@@ -19,7 +22,27 @@
 
 #include "lz4/lz4.h"
 
-#define MAX_DISK_JOBS 4
+#include "../include_common/tpak_format.h"
+
+#if USE_IO_URING
+#   include "uring_io.h"
+#endif
+
+#if BX_PLATFORM_WINDOWS
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#elif !BX_PLATFORM_ANDROID
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <stdio.h>
+#endif
+
+#define MAX_DISK_JOBS 4     // Default number of requests that are processed at the same time (async)
+#define MAX_STREAM_READ_AHEAD 8
+#define MAX_STREAM_WRITES 16
+#define PACK_FILENAME "assets.tpak"
+#define URING_QUEUE_SIZE 128
+#define URING_MAX_READS 64  // Number of reads that are in flight in io_uring at the same time (separate from MAX_DISK_JOBS)
 
 using namespace tee;
 
@@ -47,16 +70,71 @@ struct EfswResult
 };
 #endif
 
+struct AssetPack;
+
+// Memory blocks that reference the pack are created with this allocator
+// Freeing their data releases the pack reference they hold, instead of freeing anything
+class AssetPackRefAlloc : public bx::AllocatorI
+{
+public:
+    AssetPackRefAlloc() :
+        pack(nullptr)
+    {
+    }
+
+    void* realloc(void* _ptr, size_t _size, size_t _align, const char* _file, uint32_t _line) override;
+
+    AssetPack* pack;
+};
+
+// Memory mapped asset pack (PACK_FILENAME in root directory), Assets are read from here before the loose files
+// Mapping is read-only and reference counted: the driver, open streams and returned memory blocks each hold a reference
+struct AssetPack
+{
+    bx::AllocatorI* alloc;
+    volatile int32_t refcount;
+    AssetPackRefAlloc refAlloc;
+
+    uint8_t* data;
+    uint64_t size;
+    const tpHeader* header;
+    const tpEntry* entries;
+    const char* strTable;
+
+#if BX_PLATFORM_WINDOWS
+    HANDLE hfile;
+    HANDLE hmap;
+#endif
+
+    AssetPack()
+    {
+        alloc = nullptr;
+        refcount = 1;
+        refAlloc.pack = this;
+        data = nullptr;
+        size = 0;
+        header = nullptr;
+        entries = nullptr;
+        strTable = nullptr;
+#if BX_PLATFORM_WINDOWS
+        hfile = INVALID_HANDLE_VALUE;
+        hmap = nullptr;
+#endif
+    }
+};
+
 struct BlockingAssetDriver
 {
     bx::AllocatorI* alloc;
     bx::Path rootDir;
     IoFlags::Bits flags;
+    AssetPack* pack;    // nullptr if there is no asset pack
 
     BlockingAssetDriver()
     {
         alloc = nullptr;
         flags = 0;
+        pack = nullptr;
     }
 };
 
@@ -79,6 +157,17 @@ struct DiskJobResult
     };
 };
 
+struct DiskJobPriority
+{
+    enum Enum
+    {
+        High = 0,
+        Normal,
+        Low,
+        Count
+    };
+};
+
 struct DiskJob
 {
     // Request
@@ -86,6 +175,7 @@ struct DiskJob
     bx::Path uri;
     IoPathType::Enum pathType;
     IoReadFlags::Bits flags;
+    DiskJobPriority::Enum priority;
 
     // Result
     DiskJobResult::Enum result;
@@ -94,27 +184,68 @@ struct DiskJob
 
     JobHandle handle;          // JobHandle
 
-    bx::List<DiskJob*>::Node lnode; 
+    // Async reads
+    size_t uriHash;
+    DiskJob* nextRead;          // Next read in readTable with the same hash
+    int numRequests;            // Duplicate requests are merged into one job, each of them gets a callback
+    bool cancelled;             // Running job that is cancelled, result is discarded
+    bool running;               // Dispatched to a job or io_uring
+
+#if USE_IO_URING
+    // io_uring reads
+    bool uring;
+    bx::Path filepath;          // Resolved path, must stay valid until the open request is completed
+    int fd;
+    uint32_t bytesRead;
+#endif
 
-    DiskJob() : lnode(this)
+    bx::List<DiskJob*>::Node lnode;     // pendingJobs
+    bx::Queue<DiskJob*>::Node qnode;    // doneQueue
+
+    DiskJob() : lnode(this), qnode(this)
     {
+        mode = DiskJobMode::Read;
+        pathType = IoPathType::Assets;
+        priority = DiskJobPriority::Normal;
+        result = DiskJobResult::OpenFailed;
         mem = nullptr;
         flags = 0;
-        handle = nullptr;
+        handle = JobHandle();
         bytesWritten = 0;
+        uriHash = 0;
+        nextRead = nullptr;
+        numRequests = 1;
+        cancelled = false;
+        running = false;
+#if USE_IO_URING
+        uring = false;
+        fd = -1;
+        bytesRead = 0;
+#endif
     }
 };
 
+struct DiskStream;
+
 struct AsyncAssetDriver
 {
     bx::AllocatorI* alloc;
     bx::Pool<DiskJob> jobPool;
-    bx::List<DiskJob*> jobList;
-    bx::List<DiskJob*> pendingJobList;
+    bx::List<DiskJob*> pendingJobs[DiskJobPriority::Count];    // FIFO per priority
+    bx::HashTable<DiskJob*> readTable;     // hash(uri) -> pending and running reads, see 'nextRead'
+    bx::Mutex doneMutex;
+    bx::Queue<DiskJob*> doneQueue;         // Finished jobs are pushed here by the job threads
+    bx::List<DiskStream*> streamList;
     IoDriverEventsI* callbacks;
     int numDiskJobs;
+    int maxDiskJobs;
     int maxDiskJobsProcessed;
 
+#if USE_IO_URING
+    UringIo* ring;          // nullptr if io_uring is not supported, all requests go to jobs
+    int numUringReads;
+#endif
+
 #if USE_EFSW
     FileWatchListener watchListener;
     efsw::FileWatcher* fileWatcher;
@@ -123,11 +254,16 @@ struct AsyncAssetDriver
     bx::Queue<EfswResult*> efswQueue;
 #endif
 
-    AsyncAssetDriver()
+    AsyncAssetDriver() : readTable(bx::HashTableType::Mutable)
     {
         callbacks = nullptr;
         numDiskJobs = 0; 
+        maxDiskJobs = MAX_DISK_JOBS;
         maxDiskJobsProcessed = 0;
+#if USE_IO_URING
+        ring = nullptr;
+        numUringReads = 0;
+#endif
 #if USE_EFSW
         fileWatcher = nullptr;
         rootWatch = 0;
@@ -183,6 +319,445 @@ static bx::Path resolvePath(const char* uri, const bx::Path& rootDir, IoPathType
     return filepath;
 }
 
+static void unmapPack(AssetPack* pack)
+{
+    if (pack->data) {
+#if BX_PLATFORM_WINDOWS
+        UnmapViewOfFile(pack->data);
+#elif !BX_PLATFORM_ANDROID
+        munmap(pack->data, (size_t)pack->size);
+#endif
+    }
+
+#if BX_PLATFORM_WINDOWS
+    if (pack->hmap)
+        CloseHandle(pack->hmap);
+    if (pack->hfile != INVALID_HANDLE_VALUE)
+        CloseHandle(pack->hfile);
+#endif
+
+    pack->data = nullptr;
+    pack->size = 0;
+    pack->header = nullptr;
+    pack->entries = nullptr;
+    pack->strTable = nullptr;
+#if BX_PLATFORM_WINDOWS
+    pack->hfile = INVALID_HANDLE_VALUE;
+    pack->hmap = nullptr;
+#endif
+}
+
+// Maps the whole pack file read-only, memory blocks that we return from it are immutable
+static bool mapPack(AssetPack* pack, const char* filepath)
+{
+#if BX_PLATFORM_WINDOWS
+    pack->hfile = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (pack->hfile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(pack->hfile, &fsize) || fsize.QuadPart < (LONGLONG)sizeof(tpHeader)) {
+        unmapPack(pack);
+        return false;
+    }
+    pack->size = (uint64_t)fsize.QuadPart;
+
+    pack->hmap = CreateFileMappingA(pack->hfile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!pack->hmap) {
+        unmapPack(pack);
+        return false;
+    }
+    pack->data = (uint8_t*)MapViewOfFile(pack->hmap, FILE_MAP_READ, 0, 0, 0);
+    if (!pack->data) {
+        unmapPack(pack);
+        return false;
+    }
+#elif !BX_PLATFORM_ANDROID
+    // fcntl.h is not included because it's 'tee' function collides with our namespace
+    FILE* f = fopen(filepath, "rb");
+    if (!f)
+        return false;
+
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || st.st_size < (off_t)sizeof(tpHeader)) {
+        fclose(f);
+        return false;
+    }
+    pack->size = (uint64_t)st.st_size;
+
+    // The mapping keeps a reference to the file, so we can close it right away
+    void* data = mmap(nullptr, (size_t)pack->size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    fclose(f);
+    if (data == MAP_FAILED)
+        return false;
+    pack->data = (uint8_t*)data;
+#else
+    return false;
+#endif
+
+    // Validate header and the table of contents
+    const tpHeader* header = (const tpHeader*)pack->data;
+    if (header->sign != TPAK_SIGN || header->version != TPAK_VERSION ||
+        header->tocOffset + uint64_t(header->numEntries)*sizeof(tpEntry) > pack->size ||
+        header->strTableOffset + header->strTableSize > pack->size ||
+        (header->strTableSize > 0 && pack->data[header->strTableOffset + header->strTableSize - 1] != 0))
+    {
+        unmapPack(pack);
+        return false;
+    }
+
+    pack->header = header;
+    pack->entries = (const tpEntry*)(pack->data + header->tocOffset);
+    pack->strTable = (const char*)(pack->data + header->strTableOffset);
+    return true;
+}
+
+static AssetPack* createPack(bx::AllocatorI* alloc, const char* filepath)
+{
+    AssetPack* pack = BX_NEW(alloc, AssetPack);
+    if (!pack)
+        return nullptr;
+    pack->alloc = alloc;
+    if (!mapPack(pack, filepath)) {
+        BX_DELETE(alloc, pack);
+        return nullptr;
+    }
+    return pack;
+}
+
+static AssetPack* retainPack(AssetPack* pack)
+{
+    bx::atomicFetchAndAdd(&pack->refcount, 1);
+    return pack;
+}
+
+// The mapping is unmapped after the last reference is released, even if the driver is already shut down
+static void releasePack(AssetPack* pack)
+{
+    if (bx::atomicDec(&pack->refcount) == 0) {
+        unmapPack(pack);
+        BX_DELETE(pack->alloc, pack);
+    }
+}
+
+void* AssetPackRefAlloc::realloc(void* _ptr, size_t _size, size_t _align, const char* _file, uint32_t _line)
+{
+    BX_ASSERT(_ptr && _size == 0, "Only frees are expected from pack memory blocks");
+    releasePack(pack);
+    return nullptr;
+}
+
+// Returned block references the mapping directly, the pack is kept alive until the block is released
+static MemoryBlock* refPackMemory(AssetPack* pack, const uint8_t* data, uint32_t size)
+{
+    retainPack(pack);
+    MemoryBlock* mem = gTee->refMemoryBlockPtrOwned(data, size, &pack->refAlloc);
+    if (!mem)
+        releasePack(pack);
+    return mem;
+}
+
+static const tpEntry* findPackEntry(const AssetPack* pack, const char* uri)
+{
+    if (!pack)
+        return nullptr;
+
+    int len = (int)strlen(uri);
+    uint32_t hash = tpHashUri(uri, len);
+
+    // Binary search the first entry with the hash, then check the uris of all entries with the same hash
+    int first = 0;
+    int count = (int)pack->header->numEntries;
+    while (count > 0) {
+        int step = count >> 1;
+        if (pack->entries[first + step].uriHash < hash) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    for (int i = first, c = (int)pack->header->numEntries; i < c && pack->entries[i].uriHash == hash; i++) {
+        const tpEntry& entry = pack->entries[i];
+        if (entry.uriOffset < pack->header->strTableSize && 
+            bx::strCmp(pack->strTable + entry.uriOffset, uri) == 0)
+        {
+            if (entry.offset + entry.size <= pack->size)
+                return &entry;
+            break;
+        }
+    }
+    return nullptr;
+}
+
+// Uncompressed entries are returned as references to the read-only mapped memory (no copy)
+static MemoryBlock* readPackEntry(AssetPack* pack, const tpEntry& entry)
+{
+    const uint8_t* data = pack->data + entry.offset;
+    if (entry.flags & tpEntryFlags::LZ4) {
+        MemoryBlock* mem = gTee->createMemoryBlock(entry.uncompSize, gBlockingIo.alloc);
+        if (!mem)
+            return nullptr;
+        int r = LZ4_decompress_safe((const char*)data, (char*)mem->data, (int)entry.size, (int)entry.uncompSize);
+        if (r != (int)entry.uncompSize) {
+            gTee->releaseMemoryBlock(mem);
+            return nullptr;
+        }
+        return mem;
+    } else {
+        return refPackMemory(pack, data, entry.size);
+    }
+}
+
+// Streams: Both blocking and async drivers read/write chunks with the same functions
+// In async mode, all stream I/O is done by one job at a time, the job owns the 'source' and 'job' fields while running
+struct DiskStream
+{
+    bx::Path uri;
+    IoPathType::Enum pathType;
+    IoStreamFlag::Bits flags;
+    uint32_t chunkSize;
+    int numReadAhead;
+    IoDriverEventsI* callbacks;
+
+    // Source
+    bx::FileReader reader;
+    bx::FileWriter writer;
+    AssetPack* pack;            // Referenced while the stream reads from a pack entry
+    const tpEntry* packEntry;
+    MemoryBlock* unpacked;      // Whole entry for LZ4 compressed pack entries
+    uint32_t packPos;
+#if BX_PLATFORM_ANDROID
+    AAsset* asset;
+#endif
+    bool opened;
+    bool eof;
+
+    // Async state (main thread)
+    JobHandle job;
+    bool openReported;
+    bool failed;
+    bool closing;
+    int numRequests;
+    int numChunks;
+    MemoryBlock* chunks[MAX_STREAM_READ_AHEAD];     // Chunks that are read but not requested yet, in order
+    bx::Array<MemoryBlock*> writeQueue;
+    int maxPendingWrites;       // Queued + in-progress writes
+
+    // Async job input/output
+    DiskJobResult::Enum jobResult;
+    int jobNumReads;
+    int jobNumChunks;
+    int jobNumWrites;
+    MemoryBlock* jobChunks[MAX_STREAM_READ_AHEAD];
+    MemoryBlock* jobWrites[MAX_STREAM_WRITES];
+    int32_t jobWritten[MAX_STREAM_WRITES];
+
+    bx::List<DiskStream*>::Node lnode;
+
+    DiskStream() : lnode(this)
+    {
+        pathType = IoPathType::Assets;
+        flags = 0;
+        chunkSize = 0;
+        numReadAhead = 0;
+        callbacks = nullptr;
+        pack = nullptr;
+        packEntry = nullptr;
+        unpacked = nullptr;
+        packPos = 0;
+#if BX_PLATFORM_ANDROID
+        asset = nullptr;
+#endif
+        opened = false;
+        eof = false;
+        job = JobHandle();
+        openReported = false;
+        failed = false;
+        closing = false;
+        numRequests = 0;
+        numChunks = 0;
+        maxPendingWrites = 0;
+        jobResult = DiskJobResult::ReadOk;
+        jobNumReads = 0;
+        jobNumChunks = 0;
+        jobNumWrites = 0;
+    }
+};
+
+static DiskStream* createDiskStream(bx::AllocatorI* alloc, const char* uri, IoStreamFlag::Bits flags, 
+                                    IoPathType::Enum pathType, const IoStreamParams* params)
+{
+    // Streams are either read or write
+    bool read = (flags & IoStreamFlag::READ) != 0;
+    bool write = (flags & IoStreamFlag::WRITE) != 0;
+    if (read == write) {
+        BX_ASSERT(0, "Stream should be opened for either READ or WRITE");
+        return nullptr;
+    }
+
+    IoStreamParams defaultParams;
+    if (!params)
+        params = &defaultParams;
+
+    DiskStream* s = BX_NEW(alloc, DiskStream);
+    if (!s)
+        return nullptr;
+    s->uri = uri;
+    s->pathType = pathType;
+    s->flags = flags;
+    s->chunkSize = params->chunkSize > 0 ? params->chunkSize : defaultParams.chunkSize;
+    s->numReadAhead = bx::min<int>(params->numReadAhead, MAX_STREAM_READ_AHEAD);
+    s->maxPendingWrites = params->maxPendingWrites > 0 ? params->maxPendingWrites : defaultParams.maxPendingWrites;
+    s->callbacks = params->callbacks;
+    return s;
+}
+
+static void destroyDiskStream(bx::AllocatorI* alloc, DiskStream* s)
+{
+    for (int i = 0; i < s->numChunks; i++)
+        gTee->releaseMemoryBlock(s->chunks[i]);
+    for (int i = 0; i < s->writeQueue.getCount(); i++)
+        gTee->releaseMemoryBlock(s->writeQueue[i]);
+    s->writeQueue.destroy();
+    BX_DELETE(alloc, s);
+}
+
+static bool openStreamSource(DiskStream* s)
+{
+    BX_ASSERT(!s->opened);
+    if (s->pathType == IoPathType::Assets && (s->flags & IoStreamFlag::READ)) {
+        const tpEntry* entry = findPackEntry(gBlockingIo.pack, s->uri.cstr());
+        if (entry) {
+            // LZ4 blocks can't be decoded partially, so we have to unpack the whole entry
+            if ((entry->flags & tpEntryFlags::LZ4) && entry->size > 0) {
+                s->unpacked = readPackEntry(gBlockingIo.pack, *entry);
+                if (!s->unpacked)
+                    return false;
+            }
+            s->pack = retainPack(gBlockingIo.pack);
+            s->packEntry = entry;
+            s->opened = true;
+            return true;
+        }
+
+#if BX_PLATFORM_ANDROID
+        s->asset = AAssetManager_open(g_assetMgr, s->uri.cstr(), AASSET_MODE_STREAMING);
+        s->opened = s->asset != nullptr;
+        return s->opened;
+#endif
+    }
+
+#if BX_PLATFORM_ANDROID || BX_PLATFORM_IOS
+    if (s->pathType == IoPathType::Assets)
+        return false;
+#endif
+
+    bx::Path filepath = resolvePath(s->uri.cstr(), gBlockingIo.rootDir, s->pathType);
+    if (filepath.isEmpty())
+        return false;
+
+    bx::Error err;
+    if (s->flags & IoStreamFlag::READ)
+        s->opened = s->reader.open(filepath.cstr(), &err);
+    else
+        s->opened = s->writer.open(filepath.cstr(), false, &err);
+    return s->opened;
+}
+
+static void closeStreamSource(DiskStream* s)
+{
+    if (!s->opened)
+        return;
+
+    if (s->packEntry) {
+        if (s->unpacked)
+            gTee->releaseMemoryBlock(s->unpacked);
+        s->unpacked = nullptr;
+        s->packEntry = nullptr;
+        releasePack(s->pack);
+        s->pack = nullptr;
+#if BX_PLATFORM_ANDROID
+    } else if (s->asset) {
+        AAsset_close(s->asset);
+        s->asset = nullptr;
+#endif
+    } else if (s->flags & IoStreamFlag::READ) {
+        s->reader.close();
+    } else {
+        s->writer.close();
+    }
+    s->opened = false;
+}
+
+// Returns nullptr at the end of the stream or if read fails ('failed' is set)
+// Chunks from uncompressed pack entries reference the mapped memory (no copy)
+static MemoryBlock* readStreamChunk(DiskStream* s, bool* failed)
+{
+    *failed = false;
+    if (s->eof)
+        return nullptr;
+
+    if (s->packEntry) {
+        uint32_t size = s->unpacked ? s->unpacked->size : s->packEntry->size;
+        uint32_t chunkSize = bx::min(s->chunkSize, size - s->packPos);
+        if (chunkSize == 0) {
+            s->eof = true;
+            return nullptr;
+        }
+
+        MemoryBlock* mem;
+        if (s->unpacked)
+            mem = gTee->copyMemoryBlock(s->unpacked->data + s->packPos, chunkSize, gBlockingIo.alloc);
+        else
+            mem = refPackMemory(s->pack, s->pack->data + s->packEntry->offset + s->packPos, chunkSize);
+        if (!mem) {
+            *failed = true;
+            return nullptr;
+        }
+        s->packPos += chunkSize;
+        s->eof = s->packPos == size;
+        return mem;
+    }
+
+    MemoryBlock* mem = gTee->createMemoryBlock(s->chunkSize, gBlockingIo.alloc);
+    if (!mem) {
+        *failed = true;
+        return nullptr;
+    }
+
+    int32_t r;
+#if BX_PLATFORM_ANDROID
+    if (s->asset) {
+        r = AAsset_read(s->asset, mem->data, s->chunkSize);
+        *failed = r < 0;
+    } else
+#endif
+    {
+        bx::Error err;
+        r = s->reader.read(mem->data, int32_t(s->chunkSize), &err);
+        *failed = err.get().code == BX_ERROR_READERWRITER_READ.code;
+    }
+
+    if (r < int32_t(s->chunkSize))
+        s->eof = true;
+    if (r <= 0 || *failed) {
+        gTee->releaseMemoryBlock(mem);
+        return nullptr;
+    }
+    mem->size = uint32_t(r);
+    return mem;
+}
+
+static int32_t writeStreamChunk(DiskStream* s, const MemoryBlock* mem)
+{
+    bx::Error err;
+    int32_t r = s->writer.write(mem->data, int32_t(mem->size), &err);
+    return err.isOk() ? r : -1;
+}
+
 // BlockingIO
 static bool blockInit(bx::AllocatorI* alloc, const char* uri, const void* params, IoDriverEventsI* callbacks, IoFlags::Bits flags)
 {
@@ -199,11 +774,27 @@ static bool blockInit(bx::AllocatorI* alloc, const char* uri, const void* params
     }
 #endif
 
+    // Asset pack is optional, loose files are used if it doesn't exist
+    bx::Path packFilepath(gBlockingIo.rootDir.cstr());
+    packFilepath.join(PACK_FILENAME);
+    bx::FileInfo packInfo;
+    if (bx::stat(packFilepath.cstr(), packInfo) && packInfo.m_type == bx::FileInfo::Regular) {
+        gBlockingIo.pack = createPack(alloc, packFilepath.cstr());
+        if (!gBlockingIo.pack)
+            gTee->logPrintf(__FILE__, __LINE__, LogType::Warning, "DiskDriver: Invalid asset pack '%s', using loose files", 
+                            packFilepath.cstr());
+    }
+
     return true;
 }
 
+// Memory blocks and streams that still reference the pack keep it mapped until they are released
 static void blockShutdown()
 {
+    if (gBlockingIo.pack) {
+        releasePack(gBlockingIo.pack);
+        gBlockingIo.pack = nullptr;
+    }
 }
 
 static void blockSetCallbacks(IoDriverEventsI* callbacks)
@@ -278,6 +869,25 @@ static void blockingReadJob(int jobIdx, void* userParam)
     }
 #endif
 
+    // Look in the asset pack first
+    if (job->pathType == IoPathType::Assets) {
+        const tpEntry* entry = findPackEntry(gBlockingIo.pack, job->uri.cstr());
+        if (entry) {
+            MemoryBlock* mem = entry->size > 0 ? readPackEntry(gBlockingIo.pack, *entry) : nullptr;
+            if (mem && (gBlockingIo.flags & IoFlags::ExtractLZ4) && !(job->flags & IoReadFlags::RawRead)) {
+                mem = uncompressBlob(mem, gBlockingIo.alloc, job->uri.cstr());
+            }
+
+            if (mem) {
+                job->result = DiskJobResult::ReadOk;
+                job->mem = mem;
+            } else {
+                job->result = DiskJobResult::ReadFailed;
+            }
+            return;
+        }
+    }
+
     // Normal reading from DiskFs
     bx::Path filepath = resolvePath(job->uri.cstr(), gBlockingIo.rootDir, job->pathType);
     bx::FileReader file;
@@ -409,14 +1019,204 @@ static const char* blockGetUri()
     return gBlockingIo.rootDir.cstr();
 }
 
+static IoStream* blockOpenStream(const char* uri, IoStreamFlag::Bits flags, IoPathType::Enum pathType, 
+                                 const IoStreamParams* params)
+{
+    DiskStream* s = createDiskStream(gBlockingIo.alloc, uri, flags, pathType, params);
+    if (!s)
+        return nullptr;
+
+    if (!openStreamSource(s)) {
+        TEE_ERROR_API(gTee, "DiskDriver: Unable to open stream '%s'", uri);
+        destroyDiskStream(gBlockingIo.alloc, s);
+        return nullptr;
+    }
+    return (IoStream*)s;
+}
+
+static MemoryBlock* blockReadStream(IoStream* stream)
+{
+    DiskStream* s = (DiskStream*)stream;
+    BX_ASSERT(s->flags & IoStreamFlag::READ);
+
+    bool failed;
+    MemoryBlock* mem = readStreamChunk(s, &failed);
+    if (failed) {
+        TEE_ERROR_API(gTee, "DiskDriver: Unable to read stream '%s'", s->uri.cstr());
+        s->eof = true;
+    }
+    return mem;
+}
+
+static size_t blockWriteStream(IoStream* stream, const MemoryBlock* mem)
+{
+    DiskStream* s = (DiskStream*)stream;
+    BX_ASSERT(s->flags & IoStreamFlag::WRITE);
+
+    int32_t r = writeStreamChunk(s, mem);
+    if (r <= 0) {
+        TEE_ERROR_API(gTee, "DiskDriver: Unable to write stream '%s'", s->uri.cstr());
+        return 0;
+    }
+    return size_t(r);
+}
+
+static int blockGetStreamPendingWrites(IoStream* stream)
+{
+    return 0;
+}
+
+static void blockCloseStream(IoStream* stream)
+{
+    DiskStream* s = (DiskStream*)stream;
+    closeStreamSource(s);
+    destroyDiskStream(gBlockingIo.alloc, s);
+}
+
 // AsyncIO
+static void pushDoneJob(DiskJob* dj)
+{
+    bx::MutexScope mtx(gAsyncIo.doneMutex);
+    gAsyncIo.doneQueue.push(&dj->qnode);
+}
+
+static bool popDoneJob(DiskJob** pdj)
+{
+    bx::MutexScope mtx(gAsyncIo.doneMutex);
+    return gAsyncIo.doneQueue.pop(pdj);
+}
+
+#if USE_IO_URING
+// io_uring requests: DiskJob pointer with the operation in the lower bits, close requests have zero userData
+struct UringOp
+{
+    enum Enum
+    {
+        Open = 0x1,
+        Read = 0x2,
+        Mask = 0x3
+    };
+};
+
+// Loose files are read with io_uring, pack entries and LZ4 extraction are left to jobs
+static bool canReadWithUring(const DiskJob* dj)
+{
+    if (!gAsyncIo.ring || dj->mode != DiskJobMode::Read)
+        return false;
+    if (dj->pathType == IoPathType::Assets && findPackEntry(gBlockingIo.pack, dj->uri.cstr()))
+        return false;
+    if ((gBlockingIo.flags & IoFlags::ExtractLZ4) && !(dj->flags & IoReadFlags::RawRead)) {
+        const char* ext = strrchr(dj->uri.cstr(), '.');
+        if (ext && bx::strCmpI(ext + 1, "lz4") == 0)
+            return false;
+    }
+    return true;
+}
+
+static bool submitUringRead(DiskJob* dj)
+{
+    dj->filepath = resolvePath(dj->uri.cstr(), gBlockingIo.rootDir, dj->pathType);
+    if (!uringPrepOpen(gAsyncIo.ring, dj->filepath.cstr(), uint64_t(uintptr_t(dj)) | UringOp::Open))
+        return false;
+    dj->uring = true;
+    ++gAsyncIo.numUringReads;
+    return true;
+}
+
+static void finishUringRead(DiskJob* dj, DiskJobResult::Enum result, bool discard)
+{
+    if (dj->fd >= 0) {
+        if (discard || !uringPrepClose(gAsyncIo.ring, dj->fd, 0))
+            uringCloseFile(dj->fd);
+        dj->fd = -1;
+    }
+    if (result != DiskJobResult::ReadOk && dj->mem) {
+        gTee->releaseMemoryBlock(dj->mem);
+        dj->mem = nullptr;
+    }
+    dj->result = result;
+    pushDoneJob(dj);
+}
+
+// Continues reads with the finished requests, completed reads are pushed to doneQueue like jobs
+// 'discard': Don't start new reads (shutdown)
+static void processUringCompletions(bool wait, bool discard)
+{
+    // Send the requests that the kernel refused before (EAGAIN/EBUSY)
+    // Don't block if some are still not submitted, their completions would never come
+    uringSubmit(gAsyncIo.ring);
+    if (wait && uringGetNumUnsubmitted(gAsyncIo.ring) > 0) {
+        wait = false;
+        bx::yield();
+    }
+
+    UringCompletion completions[32];
+    int count = uringGetCompletions(gAsyncIo.ring, completions, BX_COUNTOF(completions), wait);
+    for (int i = 0; i < count; i++) {
+        const UringCompletion& c = completions[i];
+        DiskJob* dj = (DiskJob*)uintptr_t(c.userData & ~uint64_t(UringOp::Mask));
+        if (!dj)
+            continue;
+
+        if ((c.userData & UringOp::Mask) == UringOp::Open) {
+            if (c.result < 0) {
+                finishUringRead(dj, DiskJobResult::OpenFailed, discard);
+                continue;
+            }
+
+            dj->fd = c.result;
+            int64_t size = uringGetFileSize(dj->fd);
+            if (dj->cancelled || discard || size <= 0 || size > INT32_MAX) {
+                finishUringRead(dj, DiskJobResult::ReadFailed, discard);
+                continue;
+            }
+
+            dj->mem = gTee->createMemoryBlock((uint32_t)size, gBlockingIo.alloc);
+            if (!dj->mem || !uringPrepRead(gAsyncIo.ring, dj->fd, dj->mem->data, dj->mem->size, 0,
+                                           uint64_t(uintptr_t(dj)) | UringOp::Read))
+            {
+                finishUringRead(dj, DiskJobResult::ReadFailed, discard);
+            }
+        } else {
+            if (c.result < 0) {
+                finishUringRead(dj, DiskJobResult::ReadFailed, discard);
+                continue;
+            }
+
+            // Short reads continue from where they stopped, until EOF
+            dj->bytesRead += c.result;
+            if (c.result > 0 && dj->bytesRead < dj->mem->size && !dj->cancelled && !discard &&
+                uringPrepRead(gAsyncIo.ring, dj->fd, dj->mem->data + dj->bytesRead, dj->mem->size - dj->bytesRead, 
+                              dj->bytesRead, uint64_t(uintptr_t(dj)) | UringOp::Read))
+            {
+                continue;
+            }
+
+            // EOF before the whole file is read means that the file is shrunk after open
+            finishUringRead(dj, dj->bytesRead == dj->mem->size ? DiskJobResult::ReadOk : DiskJobResult::ReadFailed, 
+                            discard);
+        }
+    }
+
+    uringSubmit(gAsyncIo.ring);
+}
+#endif
+
 static bool asyncInit(bx::AllocatorI* alloc, const char* uri, const void* params, IoDriverEventsI* callbacks, IoFlags::Bits flags)
 {
     // Initialize pools and their queues
     gAsyncIo.alloc = alloc;
-    if (!gAsyncIo.jobPool.create(64, alloc))
+    if (!gAsyncIo.jobPool.create(64, alloc) || !gAsyncIo.readTable.create(64, alloc))
         return false;
 
+#if USE_IO_URING
+    gAsyncIo.ring = uringCreate(alloc, URING_QUEUE_SIZE);
+    if (!gAsyncIo.ring) {
+        gTee->logPrintf(__FILE__, __LINE__, LogType::Warning, 
+                        "DiskDriver: io_uring is not supported by the kernel, reading files with jobs");
+    }
+#endif
+
 #if USE_EFSW
     gAsyncIo.fileWatcher = BX_NEW(alloc, efsw::FileWatcher);
     if (!gAsyncIo.fileWatcher)
@@ -433,6 +1233,70 @@ static bool asyncInit(bx::AllocatorI* alloc, const char* uri, const void* params
 
 static void asyncShutdown()
 {
+    // Close remaining streams without notifying
+    bx::List<DiskStream*>::Node* node = gAsyncIo.streamList.getFirst();
+    while (node) {
+        bx::List<DiskStream*>::Node* next = node->next;
+        DiskStream* s = node->data;
+        if (s->job.isValid()) {
+            gTee->waitAndDeleteJob(s->job);
+            for (int i = 0; i < s->jobNumChunks; i++)
+                gTee->releaseMemoryBlock(s->jobChunks[i]);
+            for (int i = 0; i < s->jobNumWrites; i++)
+                gTee->releaseMemoryBlock(s->jobWrites[i]);
+        }
+        gAsyncIo.streamList.remove(node);
+        closeStreamSource(s);
+        destroyDiskStream(gAsyncIo.alloc, s);
+        node = next;
+    }
+
+    // Discard remaining requests
+    for (int i = 0; i < DiskJobPriority::Count; i++) {
+        bx::List<DiskJob*>::Node* jnode;
+        while ((jnode = gAsyncIo.pendingJobs[i].getFirst()) != nullptr) {
+            gAsyncIo.pendingJobs[i].remove(jnode);
+            gAsyncIo.jobPool.deleteInstance(jnode->data);
+        }
+    }
+#if USE_IO_URING
+    while (gAsyncIo.numDiskJobs > 0 || gAsyncIo.numUringReads > 0) {
+#else
+    while (gAsyncIo.numDiskJobs > 0) {
+#endif
+        DiskJob* dj;
+        if (popDoneJob(&dj)) {
+#if USE_IO_URING
+            if (dj->uring) {
+                --gAsyncIo.numUringReads;
+            } else {
+                gTee->deleteJob(dj->handle);
+                --gAsyncIo.numDiskJobs;
+            }
+#else
+            gTee->deleteJob(dj->handle);
+            --gAsyncIo.numDiskJobs;
+#endif
+            if (dj->mode == DiskJobMode::Read && dj->mem)
+                gTee->releaseMemoryBlock(dj->mem);
+            gAsyncIo.jobPool.deleteInstance(dj);
+#if USE_IO_URING
+        } else if (gAsyncIo.numUringReads > 0) {
+            processUringCompletions(true, true);
+#endif
+        } else {
+            bx::yield();
+        }
+    }
+
+#if USE_IO_URING
+    if (gAsyncIo.ring) {
+        uringDestroy(gAsyncIo.ring);
+        gAsyncIo.ring = nullptr;
+    }
+#endif
+
+    gAsyncIo.readTable.destroy();
     gAsyncIo.jobPool.destroy();
 
 #if USE_EFSW
@@ -462,112 +1326,479 @@ static IoDriverEventsI* asyncGetCallbacks()
     return gAsyncIo.callbacks;
 }
 
+static void asyncReadJob(int jobIdx, void* userParam)
+{
+    blockingReadJob(jobIdx, userParam);
+    pushDoneJob((DiskJob*)userParam);
+}
+
+static void asyncWriteJob(int jobIdx, void* userParam)
+{
+    blockingWriteJob(jobIdx, userParam);
+    pushDoneJob((DiskJob*)userParam);
+}
+
+// Returns false if the request can't be started now, so the requests after it have to wait too
+static bool dispatchPendingJob(DiskJob* dj)
+{
+#if USE_IO_URING
+    if (canReadWithUring(dj))
+        return gAsyncIo.numUringReads < URING_MAX_READS && submitUringRead(dj);
+#endif
+
+    if (gAsyncIo.numDiskJobs >= gAsyncIo.maxDiskJobs)
+        return false;
+
+    JobDesc job(dj->mode == DiskJobMode::Read ? asyncReadJob : asyncWriteJob, dj);
+    JobHandle handle = gTee->dispatchSmallJobs(&job, 1);
+    if (!handle.isValid())
+        return false;     // Dispatcher is full, try again in next update
+
+    dj->handle = handle;
+    ++gAsyncIo.numDiskJobs;
+    gAsyncIo.maxDiskJobsProcessed = bx::max(gAsyncIo.numDiskJobs, gAsyncIo.maxDiskJobsProcessed);
+    return true;
+}
+
+// Dispatches pending jobs in order of priority, until there are 'maxDiskJobs' running
+// With io_uring, file reads are batched and submitted together, limited by URING_MAX_READS instead
+static void dispatchPendingJobs(DiskJobPriority::Enum firstPriority, DiskJobPriority::Enum lastPriority)
+{
+    for (int i = firstPriority; i <= lastPriority; i++) {
+        bx::List<DiskJob*>& pendingList = gAsyncIo.pendingJobs[i];
+        bx::List<DiskJob*>::Node* node;
+        while ((node = pendingList.getFirst()) != nullptr && dispatchPendingJob(node->data)) {
+            pendingList.remove(node);
+            node->data->running = true;
+        }
+        if (node)
+            break;
+    }
+
+#if USE_IO_URING
+    if (gAsyncIo.ring)
+        uringSubmit(gAsyncIo.ring);
+#endif
+}
+
+static DiskJob* findRead(size_t hash, const char* uri, IoPathType::Enum pathType, IoReadFlags::Bits flags)
+{
+    int index = gAsyncIo.readTable.find(hash);
+    if (index == -1)
+        return nullptr;
+
+    for (DiskJob* dj = gAsyncIo.readTable[index]; dj; dj = dj->nextRead) {
+        if (dj->pathType == pathType && (dj->flags & IoReadFlags::RawRead) == (flags & IoReadFlags::RawRead) &&
+            dj->uri.isEqual(uri))
+        {
+            return dj;
+        }
+    }
+    return nullptr;
+}
+
+static void addRead(DiskJob* dj)
+{
+    int index = gAsyncIo.readTable.find(dj->uriHash);
+    if (index != -1) {
+        dj->nextRead = gAsyncIo.readTable[index];
+        gAsyncIo.readTable[index] = dj;
+    } else {
+        dj->nextRead = nullptr;
+        gAsyncIo.readTable.add(dj->uriHash, dj);
+    }
+}
+
+static void removeRead(DiskJob* dj)
+{
+    int index = gAsyncIo.readTable.find(dj->uriHash);
+    if (index == -1)
+        return;
+
+    DiskJob* first = gAsyncIo.readTable[index];
+    if (first == dj) {
+        if (dj->nextRead)
+            gAsyncIo.readTable[index] = dj->nextRead;
+        else
+            gAsyncIo.readTable.remove(index);
+    } else {
+        for (DiskJob* prev = first; prev; prev = prev->nextRead) {
+            if (prev->nextRead == dj) {
+                prev->nextRead = dj->nextRead;
+                break;
+            }
+        }
+    }
+    dj->nextRead = nullptr;
+}
+
 static MemoryBlock* asyncRead(const char* uri, IoPathType::Enum pathType, IoReadFlags::Bits flags)
 {
-    DiskJob* dj = gAsyncIo.jobPool.newInstance<>();
-    dj->mode = DiskJobMode::Read;
-    dj->pathType = pathType;
-    dj->uri = uri;
-    dj->flags = flags;
-
-    if (gAsyncIo.numDiskJobs < MAX_DISK_JOBS) {
-        JobDesc job(blockingReadJob, dj);
-        dj->handle = gTee->dispatchSmallJobs(&job, 1);
-        if (dj->handle) {
-            ++gAsyncIo.numDiskJobs;
-            gAsyncIo.maxDiskJobsProcessed = bx::max(gAsyncIo.numDiskJobs, gAsyncIo.maxDiskJobsProcessed);
-            gAsyncIo.jobList.add(&dj->lnode);
-        } else {
-            // Add to pending to process later
-            gAsyncIo.pendingJobList.add(&dj->lnode);
+    DiskJobPriority::Enum priority = DiskJobPriority::Normal;
+    if (flags & IoReadFlags::HighPriority)
+        priority = DiskJobPriority::High;
+    else if (flags & IoReadFlags::LowPriority)
+        priority = DiskJobPriority::Low;
+
+    // Merge with the same read if it's not finished yet
+    size_t hash = tinystl::hash_string(uri, strlen(uri));
+    DiskJob* dj = findRead(hash, uri, pathType, flags);
+    if (dj) {
+        ++dj->numRequests;
+        if (!dj->running && priority < dj->priority) {
+            gAsyncIo.pendingJobs[dj->priority].remove(&dj->lnode);
+            gAsyncIo.pendingJobs[priority].addToEnd(&dj->lnode);
+            dj->priority = priority;
         }
     } else {
-        gAsyncIo.pendingJobList.add(&dj->lnode);
+        dj = gAsyncIo.jobPool.newInstance<>();
+        if (!dj) {
+            TEE_ERROR_API(gTee, "DiskDriver: Out of memory for reading '%s'", uri);
+            return nullptr;
+        }
+        dj->mode = DiskJobMode::Read;
+        dj->pathType = pathType;
+        dj->uri = uri;
+        dj->flags = flags;
+        dj->priority = priority;
+        dj->uriHash = hash;
+        addRead(dj);
+        gAsyncIo.pendingJobs[priority].addToEnd(&dj->lnode);
     }
+
+    dispatchPendingJobs(DiskJobPriority::High, DiskJobPriority::Low);
     return nullptr;
 }
 
 static size_t asyncWrite(const char* uri, const MemoryBlock* mem, IoPathType::Enum pathType)
 {
     DiskJob* dj = gAsyncIo.jobPool.newInstance<>();
+    if (!dj) {
+        TEE_ERROR_API(gTee, "DiskDriver: Out of memory for writing '%s'", uri);
+        return 0;
+    }
     dj->mode = DiskJobMode::Write;
     dj->pathType = pathType;
     dj->uri = uri;
     dj->mem = const_cast<MemoryBlock*>(mem);
+    gAsyncIo.pendingJobs[DiskJobPriority::Normal].addToEnd(&dj->lnode);
+
+    dispatchPendingJobs(DiskJobPriority::High, DiskJobPriority::Low);
+    return 0;
+}
 
-    if (gAsyncIo.numDiskJobs < MAX_DISK_JOBS) {
-        JobDesc job(blockingWriteJob, dj);
-        dj->handle = gTee->dispatchSmallJobs(&job, 1);
-        if (dj->handle) {
-            ++gAsyncIo.numDiskJobs;
-            gAsyncIo.maxDiskJobsProcessed = bx::max(gAsyncIo.numDiskJobs, gAsyncIo.maxDiskJobsProcessed);
-            gAsyncIo.jobList.add(&dj->lnode);
+// Cancels one request of the uri (reads of the same file are merged), the read is stopped when there is no request left
+// Reads that are not started are removed, running ones finish without callbacks
+static bool asyncCancelRead(const char* uri, IoPathType::Enum pathType)
+{
+    size_t hash = tinystl::hash_string(uri, strlen(uri));
+    DiskJob* dj = findRead(hash, uri, pathType, 0);
+    if (!dj)
+        dj = findRead(hash, uri, pathType, IoReadFlags::RawRead);
+    if (!dj)
+        return false;
+
+    if (--dj->numRequests == 0) {
+        removeRead(dj);
+        if (dj->running) {
+            dj->cancelled = true;
         } else {
-            // Add to pending to process later
-            gAsyncIo.pendingJobList.add(&dj->lnode);
+            gAsyncIo.pendingJobs[dj->priority].remove(&dj->lnode);
+            gAsyncIo.jobPool.deleteInstance(dj);
         }
-    } else {
-        gAsyncIo.pendingJobList.add(&dj->lnode);
     }
-    return 0;
+    return true;
 }
 
-// runs in main thread
-static void asyncRunAsyncLoop()
+static void asyncSetMaxRequests(int maxRequests)
+{
+    gAsyncIo.maxDiskJobs = maxRequests > 0 ? maxRequests : MAX_DISK_JOBS;
+    dispatchPendingJobs(DiskJobPriority::High, DiskJobPriority::Low);
+}
+
+static IoStream* asyncOpenStream(const char* uri, IoStreamFlag::Bits flags, IoPathType::Enum pathType,
+                                 const IoStreamParams* params)
+{
+    DiskStream* s = createDiskStream(gAsyncIo.alloc, uri, flags, pathType, params);
+    if (!s)
+        return nullptr;
+    if (!s->callbacks)
+        s->callbacks = gAsyncIo.callbacks;
+    if (!s->callbacks) {
+        TEE_ERROR_API(gTee, "DiskDriver: Async stream '%s' needs callbacks", uri);
+        destroyDiskStream(gAsyncIo.alloc, s);
+        return nullptr;
+    }
+
+    if ((flags & IoStreamFlag::WRITE) && !s->writeQueue.create(s->maxPendingWrites, MAX_STREAM_WRITES, gAsyncIo.alloc)) {
+        destroyDiskStream(gAsyncIo.alloc, s);
+        return nullptr;
+    }
+
+    // File is opened by the first stream job
+    gAsyncIo.streamList.add(&s->lnode);
+    return (IoStream*)s;
+}
+
+static MemoryBlock* asyncReadStream(IoStream* stream)
+{
+    DiskStream* s = (DiskStream*)stream;
+    BX_ASSERT(s->flags & IoStreamFlag::READ);
+    ++s->numRequests;
+    return nullptr;
+}
+
+static int asyncGetStreamPendingWrites(IoStream* stream)
+{
+    DiskStream* s = (DiskStream*)stream;
+    return s->writeQueue.getCount() + s->jobNumWrites;
+}
+
+static size_t asyncWriteStream(IoStream* stream, const MemoryBlock* mem)
 {
-    if (!gAsyncIo.callbacks)
+    DiskStream* s = (DiskStream*)stream;
+    BX_ASSERT(s->flags & IoStreamFlag::WRITE);
+
+    // Refuse new blocks until the disk catches up, so the queue doesn't grow without bound
+    if (asyncGetStreamPendingWrites(stream) >= s->maxPendingWrites)
+        return 0;
+
+    MemoryBlock** pmem = s->writeQueue.push();
+    if (!pmem) {
+        TEE_ERROR_API(gTee, "DiskDriver: Out of memory for stream writes '%s'", s->uri.cstr());
+        return 0;
+    }
+    *pmem = gTee->refMemoryBlock(const_cast<MemoryBlock*>(mem));
+    return mem->size;
+}
+
+static void asyncCloseStream(IoStream* stream)
+{
+    // Stream is destroyed in runAsyncLoop, when it's current job is finished
+    ((DiskStream*)stream)->closing = true;
+}
+
+static void streamJob(int jobIdx, void* userParam)
+{
+    DiskStream* s = (DiskStream*)userParam;
+    s->jobResult = DiskJobResult::ReadOk;
+    s->jobNumChunks = 0;
+
+    if (!s->opened && !openStreamSource(s)) {
+        s->jobResult = DiskJobResult::OpenFailed;
         return;
+    }
+
+    for (int i = 0; i < s->jobNumWrites; i++)
+        s->jobWritten[i] = writeStreamChunk(s, s->jobWrites[i]);
+
+    for (int i = 0; i < s->jobNumReads && !s->eof; i++) {
+        bool failed;
+        MemoryBlock* mem = readStreamChunk(s, &failed);
+        if (mem)
+            s->jobChunks[s->jobNumChunks++] = mem;
+        if (failed) {
+            s->jobResult = DiskJobResult::ReadFailed;
+            break;
+        }
+    }
+}
+
+static void finishStreamJob(DiskStream* s)
+{
+    // No events after the stream is closed by the user
+    IoStream* stream = (IoStream*)s;
+    IoDriverEventsI* callbacks = !s->closing ? s->callbacks : nullptr;
+
+    if (s->jobResult == DiskJobResult::OpenFailed) {
+        s->failed = true;
+        if (callbacks)
+            callbacks->onOpenError(s->uri.cstr());
+    } else if (!s->openReported) {
+        s->openReported = true;
+        if (callbacks)
+            callbacks->onOpenStream(stream);
+    }
+
+    for (int i = 0; i < s->jobNumWrites; i++) {
+        if (callbacks && s->jobResult != DiskJobResult::OpenFailed) {
+            if (s->jobWritten[i] > 0)
+                callbacks->onWriteStream(stream, size_t(s->jobWritten[i]));
+            else
+                callbacks->onWriteError(s->uri.cstr());
+        }
+        gTee->releaseMemoryBlock(s->jobWrites[i]);
+    }
+    s->jobNumWrites = 0;
+
+    BX_ASSERT(s->numChunks + s->jobNumChunks <= MAX_STREAM_READ_AHEAD);
+    for (int i = 0; i < s->jobNumChunks; i++)
+        s->chunks[s->numChunks++] = s->jobChunks[i];
+    s->jobNumChunks = 0;
+
+    if (s->jobResult == DiskJobResult::ReadFailed) {
+        s->failed = true;
+        if (callbacks)
+            callbacks->onReadError(s->uri.cstr());
+    }
+}
+
+static bool dispatchStreamJob(DiskStream* s)
+{
+    int numWrites = bx::min(s->writeQueue.getCount(), MAX_STREAM_WRITES);
+    int numReads = 0;
+    if ((s->flags & IoStreamFlag::READ) && !s->eof) {
+        // Keep 'numReadAhead' chunks ready, or more if they are already requested
+        int numTarget = bx::min(bx::max(s->numReadAhead, s->numRequests), MAX_STREAM_READ_AHEAD);
+        numReads = bx::max(numTarget - s->numChunks, 0);
+    }
+
+    if (s->opened && numWrites == 0 && numReads == 0)
+        return false;
+
+    s->jobNumReads = numReads;
+    s->jobNumWrites = numWrites;
+    if (numWrites > 0)
+        memcpy(s->jobWrites, s->writeQueue.getBuffer(), sizeof(MemoryBlock*)*numWrites);
 
-    // Process main disk jobs
-    bx::List<DiskJob*>::Node* node = gAsyncIo.jobList.getFirst();
+    JobDesc job(streamJob, s);
+    s->job = gTee->dispatchSmallJobs(&job, 1);
+    if (!s->job.isValid()) {
+        s->jobNumWrites = 0;
+        return false;
+    }
+
+    // Remove dispatched writes from the queue
+    int numRemain = s->writeQueue.getCount() - numWrites;
+    if (numWrites > 0) {
+        MemoryBlock** writes = s->writeQueue.getBuffer();
+        memmove(writes, writes + numWrites, sizeof(MemoryBlock*)*numRemain);
+        for (int i = 0; i < numWrites; i++)
+            s->writeQueue.pop();
+    }
+
+    ++gAsyncIo.numDiskJobs;
+    gAsyncIo.maxDiskJobsProcessed = bx::max(gAsyncIo.numDiskJobs, gAsyncIo.maxDiskJobsProcessed);
+    return true;
+}
+
+static void runStreams()
+{
+    bx::List<DiskStream*>::Node* node = gAsyncIo.streamList.getFirst();
     while (node) {
-        bx::List<DiskJob*>::Node* next = node->next;
-        DiskJob* dj = node->data;
-        if (gTee->isJobDone(dj->handle)) {
-            switch (dj->result) {
-            case DiskJobResult::ReadOk:
-                gAsyncIo.callbacks->onReadComplete(dj->uri.cstr(), dj->mem);
-                break;
-            case DiskJobResult::OpenFailed:
-                gAsyncIo.callbacks->onOpenError(dj->uri.cstr());
-                break;
-            case DiskJobResult::ReadFailed:
-                gAsyncIo.callbacks->onReadError(dj->uri.cstr());
-                break;
-            case DiskJobResult::WriteOk:
-                gAsyncIo.callbacks->onWriteComplete(dj->uri.cstr(), dj->bytesWritten);
-                break;
-            case DiskJobResult::WriteFailed:
-                gAsyncIo.callbacks->onWriteError(dj->uri.cstr());
-                break;
+        bx::List<DiskStream*>::Node* next = node->next;
+        DiskStream* s = node->data;
+
+        if (s->job.isValid()) {
+            if (!gTee->isJobDone(s->job)) {
+                node = next;
+                continue;
             }
 
-            // Remove the job
-            gTee->deleteJob(dj->handle);
-            gAsyncIo.jobList.remove(node);
-            gAsyncIo.jobPool.deleteInstance(dj);
+            gTee->deleteJob(s->job);
+            s->job = JobHandle();
             --gAsyncIo.numDiskJobs;
+            finishStreamJob(s);
+        }
+
+        if (s->closing) {
+            gAsyncIo.streamList.remove(node);
+            closeStreamSource(s);
+            s->callbacks->onCloseStream((IoStream*)s);
+            destroyDiskStream(gAsyncIo.alloc, s);
+            node = next;
+            continue;
+        }
+
+        // Pass read chunks to requests in order, requests get nullptr after the end of the stream
+        while (s->numRequests > 0 && s->numChunks > 0 && !s->closing) {
+            MemoryBlock* mem = s->chunks[0];
+            memmove(s->chunks, s->chunks + 1, sizeof(MemoryBlock*)*(--s->numChunks));
+            --s->numRequests;
+            s->callbacks->onReadStream((IoStream*)s, mem);
         }
 
+        while (s->numRequests > 0 && (s->eof || s->failed) && !s->closing) {
+            --s->numRequests;
+            s->callbacks->onReadStream((IoStream*)s, nullptr);
+        }
+
+        if (!s->failed && !s->closing && gAsyncIo.numDiskJobs < gAsyncIo.maxDiskJobs)
+            dispatchStreamJob(s);
+
         node = next;
     }
+}
 
-    // Process pending jobs
-    node = gAsyncIo.pendingJobList.getFirst();
-    while (node && gAsyncIo.numDiskJobs < MAX_DISK_JOBS) {
-        bx::List<DiskJob*>::Node* next = node->next;
-        DiskJob* dj = node->data;
-        gAsyncIo.pendingJobList.remove(node);
+// runs in main thread
+static void asyncRunAsyncLoop()
+{
+    IoDriverEventsI* callbacks = gAsyncIo.callbacks;
 
-        if (dj->mode == DiskJobMode::Read) {
-            asyncRead(dj->uri.cstr(), dj->pathType, dj->flags);
-        } else if (dj->mode == DiskJobMode::Write) {
-            asyncWrite(dj->uri.cstr(), dj->mem, dj->pathType);
+#if USE_IO_URING
+    if (gAsyncIo.ring && gAsyncIo.numUringReads > 0)
+        processUringCompletions(false, false);
+#endif
+
+    // Process finished jobs
+    DiskJob* dj;
+    while (callbacks && popDoneJob(&dj)) {
+#if USE_IO_URING
+        if (dj->uring) {
+            --gAsyncIo.numUringReads;
+        } else {
+            gTee->deleteJob(dj->handle);
+            --gAsyncIo.numDiskJobs;
         }
+#else
+        gTee->deleteJob(dj->handle);
+        --gAsyncIo.numDiskJobs;
+#endif
 
-        node = next;
+        if (dj->cancelled) {
+            if (dj->mem)
+                gTee->releaseMemoryBlock(dj->mem);
+            gAsyncIo.jobPool.deleteInstance(dj);
+            continue;
+        }
+
+        // Remove from reads before callbacks, so they can request the same file again
+        if (dj->mode == DiskJobMode::Read)
+            removeRead(dj);
+
+        switch (dj->result) {
+        case DiskJobResult::ReadOk:
+            for (int i = 1; i < dj->numRequests; i++)
+                callbacks->onReadComplete(dj->uri.cstr(), gTee->refMemoryBlock(dj->mem));
+            callbacks->onReadComplete(dj->uri.cstr(), dj->mem);
+            break;
+        case DiskJobResult::OpenFailed:
+            for (int i = 0; i < dj->numRequests; i++)
+                callbacks->onOpenError(dj->uri.cstr());
+            break;
+        case DiskJobResult::ReadFailed:
+            for (int i = 0; i < dj->numRequests; i++)
+                callbacks->onReadError(dj->uri.cstr());
+            break;
+        case DiskJobResult::WriteOk:
+            callbacks->onWriteComplete(dj->uri.cstr(), dj->bytesWritten);
+            break;
+        case DiskJobResult::WriteFailed:
+            callbacks->onWriteError(dj->uri.cstr());
+            break;
+        }
+
+        gAsyncIo.jobPool.deleteInstance(dj);
     }
 
+    // High priority requests come before streams, then the rest
+    dispatchPendingJobs(DiskJobPriority::High, DiskJobPriority::High);
+    runStreams();
+    dispatchPendingJobs(DiskJobPriority::Normal, DiskJobPriority::Low);
+
+    if (!callbacks)
+        return;
+
 #if USE_EFSW
     // Process Hot-Loads
     EfswResult* result;
@@ -668,7 +1899,7 @@ PluginDesc* getDiskDriverDesc()
 
 void* initDiskDriver(bx::AllocatorI* alloc, GetApiFunc getApi)
 {
-    gTee = (CoreApi*)getApi(uint16_t(ApiId::Core), 0);
+    gTee = (CoreApi*)getApi(uint16_t(ApiId::Core), 1);
     if (!gTee)
         return nullptr;
     
@@ -688,9 +1919,16 @@ void* initDiskDriver(bx::AllocatorI* alloc, GetApiFunc getApi)
     asyncApi.getCallbacks = asyncGetCallbacks;
     asyncApi.read = asyncRead;
     asyncApi.write = asyncWrite;
+    asyncApi.openStream = asyncOpenStream;
+    asyncApi.readStream = asyncReadStream;
+    asyncApi.writeStream = asyncWriteStream;
+    asyncApi.closeStream = asyncCloseStream;
     asyncApi.runAsyncLoop = asyncRunAsyncLoop;
     asyncApi.getOpMode = asyncGetOpMode;
     asyncApi.getUri = asyncGetUri;
+    asyncApi.cancelRead = asyncCancelRead;
+    asyncApi.setMaxRequests = asyncSetMaxRequests;
+    asyncApi.getStreamPendingWrites = asyncGetStreamPendingWrites;
 
     blockApi.init = blockInit;
     blockApi.shutdown = blockShutdown;
@@ -698,9 +1936,14 @@ void* initDiskDriver(bx::AllocatorI* alloc, GetApiFunc getApi)
     blockApi.getCallbacks = blockGetCallbacks;
     blockApi.read = blockRead;
     blockApi.write = blockWrite;
+    blockApi.openStream = blockOpenStream;
+    blockApi.readStream = blockReadStream;
+    blockApi.writeStream = blockWriteStream;
+    blockApi.closeStream = blockCloseStream;
     blockApi.runAsyncLoop = blockRunAsyncLoop;
     blockApi.getOpMode = blockGetOpMode;
     blockApi.getUri = blockGetUri;
+    blockApi.getStreamPendingWrites = blockGetStreamPendingWrites;
     
 #if BX_PLATFORM_IOS
     if (gAssetsBundleId == -1)
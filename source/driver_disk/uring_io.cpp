@@ -0,0 +1,252 @@
+#include "uring_io.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+struct UringIo
+{
+    bx::AllocatorI* alloc;
+    int fd;
+
+    // Submission queue
+    uint32_t* sqHead;
+    uint32_t* sqTail;
+    uint32_t sqMask;
+    uint32_t sqEntries;
+    uint32_t* sqArray;
+    io_uring_sqe* sqes;
+    uint32_t sqLocalTail;       // Prepared entries that are not submitted yet are between *sqTail and sqLocalTail
+
+    // Completion queue
+    uint32_t* cqHead;
+    uint32_t* cqTail;
+    uint32_t cqMask;
+    io_uring_cqe* cqes;
+
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+};
+
+static int sysSetup(uint32_t entries, io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sysEnter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static int sysRegister(int fd, uint32_t opcode, void* arg, uint32_t numArgs)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, numArgs);
+}
+
+static bool checkOpsSupported(int fd)
+{
+    const size_t probeSize = sizeof(io_uring_probe) + 256*sizeof(io_uring_probe_op);
+    uint8_t probeBuff[probeSize];
+    memset(probeBuff, 0x00, probeSize);
+    io_uring_probe* probe = (io_uring_probe*)probeBuff;
+    if (sysRegister(fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+        return false;
+
+    const uint8_t ops[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+    for (int i = 0; i < (int)BX_COUNTOF(ops); i++) {
+        if (ops[i] > probe->last_op || !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED))
+            return false;
+    }
+    return true;
+}
+
+UringIo* uringCreate(bx::AllocatorI* alloc, uint32_t numEntries)
+{
+    io_uring_params params;
+    memset(&params, 0x00, sizeof(params));
+    int fd = sysSetup(numEntries, &params);
+    if (fd < 0)
+        return nullptr;
+
+    // We need the single mmap feature (5.4) and OPENAT/READ/CLOSE ops (5.6)
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !checkOpsSupported(fd)) {
+        close(fd);
+        return nullptr;
+    }
+
+    UringIo* ring = BX_NEW(alloc, UringIo);
+    if (!ring) {
+        close(fd);
+        return nullptr;
+    }
+    memset(ring, 0x00, sizeof(UringIo));
+    ring->alloc = alloc;
+    ring->fd = fd;
+
+    // SQ and CQ rings share the same mapping
+    ring->sqRingSize = params.sq_off.array + params.sq_entries*sizeof(uint32_t);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+    if (ring->cqRingSize > ring->sqRingSize)
+        ring->sqRingSize = ring->cqRingSize;
+    ring->cqRingSize = 0;
+    ring->sqesSize = params.sq_entries*sizeof(io_uring_sqe);
+
+    ring->sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        ring->sqRing = nullptr;
+        uringDestroy(ring);
+        return nullptr;
+    }
+    ring->cqRing = ring->sqRing;
+
+    ring->sqes = (io_uring_sqe*)mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                     IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = nullptr;
+        uringDestroy(ring);
+        return nullptr;
+    }
+
+    uint8_t* sq = (uint8_t*)ring->sqRing;
+    ring->sqHead = (uint32_t*)(sq + params.sq_off.head);
+    ring->sqTail = (uint32_t*)(sq + params.sq_off.tail);
+    ring->sqMask = *(uint32_t*)(sq + params.sq_off.ring_mask);
+    ring->sqEntries = *(uint32_t*)(sq + params.sq_off.ring_entries);
+    ring->sqArray = (uint32_t*)(sq + params.sq_off.array);
+    ring->sqLocalTail = *ring->sqTail;
+
+    uint8_t* cq = (uint8_t*)ring->cqRing;
+    ring->cqHead = (uint32_t*)(cq + params.cq_off.head);
+    ring->cqTail = (uint32_t*)(cq + params.cq_off.tail);
+    ring->cqMask = *(uint32_t*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    return ring;
+}
+
+void uringDestroy(UringIo* ring)
+{
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqesSize);
+    if (ring->sqRing)
+        munmap(ring->sqRing, ring->sqRingSize);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    BX_DELETE(ring->alloc, ring);
+}
+
+static io_uring_sqe* getSqe(UringIo* ring)
+{
+    uint32_t head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+    if (ring->sqLocalTail - head >= ring->sqEntries)
+        return nullptr;
+
+    uint32_t index = ring->sqLocalTail & ring->sqMask;
+    io_uring_sqe* sqe = &ring->sqes[index];
+    ring->sqArray[index] = index;
+    ++ring->sqLocalTail;
+
+    memset(sqe, 0x00, sizeof(io_uring_sqe));
+    return sqe;
+}
+
+bool uringPrepOpen(UringIo* ring, const char* filepath, uint64_t userData)
+{
+    io_uring_sqe* sqe = getSqe(ring);
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)filepath;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    sqe->user_data = userData;
+    return true;
+}
+
+bool uringPrepRead(UringIo* ring, int fd, void* buff, uint32_t size, uint64_t offset, uint64_t userData)
+{
+    io_uring_sqe* sqe = getSqe(ring);
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buff;
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->user_data = userData;
+    return true;
+}
+
+bool uringPrepClose(UringIo* ring, int fd, uint64_t userData)
+{
+    io_uring_sqe* sqe = getSqe(ring);
+    if (!sqe)
+        return false;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = userData;
+    return true;
+}
+
+uint32_t uringGetNumUnsubmitted(UringIo* ring)
+{
+    // Kernel moves the head when it consumes the entries, so this also counts entries that previous submits left
+    return ring->sqLocalTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+}
+
+int uringSubmit(UringIo* ring)
+{
+    uint32_t toSubmit = uringGetNumUnsubmitted(ring);
+    if (toSubmit == 0)
+        return 0;
+
+    __atomic_store_n(ring->sqTail, ring->sqLocalTail, __ATOMIC_RELEASE);
+    int r;
+    do {
+        r = sysEnter(ring->fd, toSubmit, 0, 0);
+    } while (r < 0 && errno == EINTR);
+    return r < 0 ? -errno : r;
+}
+
+int uringGetCompletions(UringIo* ring, UringCompletion* completions, int maxCompletions, bool wait)
+{
+    uint32_t head = *ring->cqHead;
+    uint32_t tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+    if (head == tail && wait) {
+        while (sysEnter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR) {}
+        tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+    }
+
+    int count = 0;
+    while (head != tail && count < maxCompletions) {
+        const io_uring_cqe& cqe = ring->cqes[head & ring->cqMask];
+        completions[count].userData = cqe.user_data;
+        completions[count].result = cqe.res;
+        ++count;
+        ++head;
+    }
+    __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+int64_t uringGetFileSize(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return -1;
+    return (int64_t)st.st_size;
+}
+
+void uringCloseFile(int fd)
+{
+    close(fd);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Minimal io_uring wrapper for the async disk driver (linux 5.6+), uses raw syscalls so there is no liburing dependency
+// All functions must be called from the same thread
+#include "bx/allocator.h"
+
+struct UringIo;
+
+struct UringCompletion
+{
+    uint64_t userData;
+    int32_t result;     // Same as the return value of the syscall, negative values are -errno
+};
+
+// Returns nullptr if io_uring or any of the operations we need are not supported by the kernel
+UringIo* uringCreate(bx::AllocatorI* alloc, uint32_t numEntries);
+void uringDestroy(UringIo* ring);
+
+// Prepare requests, they are sent to the kernel with 'uringSubmit'
+// Returns false if the submission queue is full
+// 'filepath' and 'buff' must stay valid until the request is completed
+bool uringPrepOpen(UringIo* ring, const char* filepath, uint64_t userData);
+bool uringPrepRead(UringIo* ring, int fd, void* buff, uint32_t size, uint64_t offset, uint64_t userData);
+bool uringPrepClose(UringIo* ring, int fd, uint64_t userData);
+
+// Returns number of entries that the kernel took, or -errno (EAGAIN, EBUSY, ...)
+// Entries that are not taken stay in the queue and are sent again with the next call
+int uringSubmit(UringIo* ring);
+uint32_t uringGetNumUnsubmitted(UringIo* ring);
+
+// Returns number of completions written to 'completions', 'wait' blocks until there is at least one
+int uringGetCompletions(UringIo* ring, UringCompletion* completions, int maxCompletions, bool wait);
+
+// Helpers, so the driver doesn't need to include posix headers
+int64_t uringGetFileSize(int fd);
+void uringCloseFile(int fd);
@@ -461,7 +461,7 @@ PluginDesc* getSdlMixerDriverDesc()
 
 void* initSdlMixerDriver(bx::AllocatorI* alloc, GetApiFunc getApi)
 {
-    gSdlMixer.core = (CoreApi*)getApi(uint16_t(ApiId::Core), 0);
+    gSdlMixer.core = (CoreApi*)getApi(uint16_t(ApiId::Core), 1);
     gSdlMixer.asset = (AssetApi*)getApi(uint16_t(ApiId::Asset), 0);
     if (!gSdlMixer.core || !gSdlMixer.asset)
         return nullptr;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "bx/bx.h"
+#include "bx/hash.h"
+
+#define TPAK_SIGN 0x5450414b    // TPAK
+#define TPAK_VERSION 0x312e30   // 1.0
+
+#define TPAK_DEFAULT_ALIGNMENT 16
+
+// Pack file layout:
+//  - tpHeader
+//  - Entry data, each entry is aligned to it's 'alignment' from the start of the file
+//  - TOC: tpEntry[numEntries], sorted by 'uriHash'
+//  - String table: zero-terminated uris (unix slashes, relative to assets directory)
+#pragma pack(push, 1)
+
+namespace tee
+{
+    struct tpEntryFlags
+    {
+        enum Enum
+        {
+            None = 0x0,
+            LZ4 = 0x01      // Entry data is LZ4 compressed, 'uncompSize' is the original size
+        };
+    };
+
+    struct tpEntry
+    {
+        uint32_t uriHash;       // tpHashUri(uri)
+        uint32_t uriOffset;     // Offset into string table
+        uint64_t offset;        // Offset of the data from the start of the file
+        uint32_t size;          // Size of the data in the file
+        uint32_t uncompSize;    // Original size of the data (same as 'size' for uncompressed entries)
+        uint16_t alignment;
+        uint16_t flags;         // tpEntryFlags
+    };
+
+    struct tpHeader
+    {
+        uint32_t sign;
+        uint32_t version;
+        uint32_t numEntries;
+        uint64_t tocOffset;
+        uint64_t strTableOffset;
+        uint32_t strTableSize;
+    };
+
+    inline uint32_t tpHashUri(const char* uri, int len)
+    {
+        bx::HashMurmur2A hasher;
+        hasher.begin();
+        hasher.add(uri, len);
+        return hasher.end();
+    }
+}
+
+#pragma pack(pop)
@@ -2,6 +2,7 @@
 
 #include "assetlib.h"
 #include "io_driver.h"
+#include "job_dispatcher.h"
 #include "internal.h"
 
 #include "bx/hash.h"
@@ -44,6 +45,22 @@ namespace tee {
         AssetFlags::Bits flags;
     };
 
+    // Async load that is decoded in a job (AssetLibCallbacksI::decodeObj), finalized in asset::update
+    struct AsyncDecodeRequest
+    {
+        AssetHandle handle;
+        AssetLibCallbacksI* callbacks;
+        MemoryBlock* mem;
+        bx::Path uri;
+        uint8_t userParams[TEE_ASSET_MAX_USERPARAM_SIZE];
+        bx::AllocatorI* objAlloc;
+        AssetFlags::Bits flags;
+        uintptr_t decoded;
+        bool decodeResult;
+        bool cancelled;     // Asset is unloaded or reloaded before the job is finished, just discard the result
+        JobHandle job;
+    };
+
     struct AssetExtensionOverride
     {
         const char* ext;
@@ -78,6 +95,7 @@ namespace tee {
         bx::Array<AssetPathOverride> pathOverrides;
         bx::HashTableInt pathOverrideTable; // orig->replacement, index to pathOverrides
         bx::HashTableInt pathOverrideTableRev;  // replacement->orig, intdex to pathOverrides
+        bx::Array<AsyncDecodeRequest*> decodeRequests;  // In the order they are dispatched
         bool ignoreUnloadResourceCalls;
 
     public:
@@ -152,7 +170,8 @@ namespace tee {
             !assetLib->overrides.create(10, 10, alloc) ||
             !assetLib->pathOverrides.create(128, 128, alloc) ||
             !assetLib->pathOverrideTable.create(128, alloc) ||
-            !assetLib->pathOverrideTableRev.create(128, alloc))
+            !assetLib->pathOverrideTableRev.create(128, alloc) ||
+            !assetLib->decodeRequests.create(32, 64, alloc))
         {
             return false;
         }
@@ -174,6 +193,8 @@ namespace tee {
         if (!assetLib)
             return;
 
+        BX_ASSERT(assetLib->decodeRequests.getCount() == 0, "asset::cancelDecodes must be called before shutdown");
+        assetLib->decodeRequests.destroy();
         assetLib->pathOverrideTable.destroy();
         assetLib->pathOverrideTableRev.destroy();
         assetLib->overrides.destroy();
@@ -323,10 +344,22 @@ namespace tee {
         return rs->handle;
     }
 
+    // Pending decodes of the asset are discarded when they are finished, because the asset is deleted or reloaded
+    static void cancelAssetDecodes(AssetHandle handle)
+    {
+        AssetLib* assetLib = gAssetLib;
+        for (int i = 0, c = assetLib->decodeRequests.getCount(); i < c; i++) {
+            AsyncDecodeRequest* req = assetLib->decodeRequests[i];
+            if (req->handle.value == handle.value)
+                req->cancelled = true;
+        }
+    }
+
     static void deleteAsset(AssetHandle handle, const AssetTypeData* tdata)
     {
         AssetLib* assetLib = gAssetLib;
         Asset* rs = assetLib->assets.getHandleData<Asset>(0, handle);
+        cancelAssetDecodes(handle);
 
         // Unregister from hot-loading
         if (assetLib->flags & AssetLibInitFlags::HotLoading) {
@@ -366,6 +399,7 @@ namespace tee {
         AssetHandle handle = overrideHandle;
         if (handle.isValid()) {
             Asset* rs = assetLib->assets.getHandleData<Asset>(0, handle);
+            cancelAssetDecodes(handle);
 
             // Unload previous asset object
             if (rs->handle.isValid() && rs->loadState == AssetState::LoadOk)
@@ -523,8 +557,14 @@ namespace tee {
                 assetLib->asyncLoadsTable.add(tinystl::hash_string(uri, strlen(uri)), reqHandle);
 
                 // Load the file, result will be called in onReadComplete
+                IoReadFlags::Bits readFlags = 0;
+                if (flags & AssetFlags::HighPriority)
+                    readFlags |= IoReadFlags::HighPriority;
+                else if (flags & AssetFlags::Prefetch)
+                    readFlags |= IoReadFlags::LowPriority;
                 assetLib->driver->read(newUri.cstr(), 
-                                       !(flags & AssetFlags::AbsolutePath) ? IoPathType::Assets : IoPathType::Absolute, 0);
+                                       !(flags & AssetFlags::AbsolutePath) ? IoPathType::Assets : IoPathType::Absolute, 
+                                       readFlags);
             } else {
                 // Load the file
                 BX_ASSERT(assetLib->blockingDriver, "Blocking driver must be set int 'init'");
@@ -732,10 +772,17 @@ namespace tee {
             if (rs->refcount == 0) {
                 // Unregister from async loading
                 if (assetLib->opMode == IoOperationMode::Async) {
-                    int aIdx = assetLib->asyncLoadsTable.find(bx::hash<bx::HashMurmur2A>(rs->uri.cstr(), (uint32_t)rs->uri.getLength()));
+                    int aIdx = assetLib->asyncLoadsTable.find(tinystl::hash_string(rs->uri.cstr(), rs->uri.getLength()));
                     if (aIdx != -1) {
                         assetLib->asyncLoads.freeHandle(assetLib->asyncLoadsTable.getValue(aIdx));
                         assetLib->asyncLoadsTable.remove(aIdx);
+
+                        // Asset is not needed anymore, so don't read it
+                        if (assetLib->driver->cancelRead) {
+                            bx::Path newUri = getReplacementUri(rs->uri.cstr());
+                            assetLib->driver->cancelRead(newUri.cstr(), 
+                                                         !(rs->flags & AssetFlags::AbsolutePath) ? IoPathType::Assets : IoPathType::Absolute);
+                        }
                     }
                 }
 
@@ -814,6 +861,137 @@ namespace tee {
         return assetLib->assets.getHandleData<Asset>(0, handle)->userParams;
     }
 
+    static void decodeAssetJob(int jobIndex, void* userParam)
+    {
+        AsyncDecodeRequest* req = (AsyncDecodeRequest*)userParam;
+
+        AssetParams params;
+        params.uri = req->uri.cstr();
+        params.userParams = req->userParams;
+        params.flags = req->flags;
+        req->decodeResult = req->callbacks->decodeObj(req->mem, params, &req->decoded, req->objAlloc);
+    }
+
+    static bool dispatchDecode(const Asset* rs, const AssetParams& params, MemoryBlock* mem)
+    {
+        AssetLib* assetLib = gAssetLib;
+
+        // Job reads the request while it's running, so it's allocated separately and stays at the same address
+        AsyncDecodeRequest* req = BX_NEW(assetLib->alloc, AsyncDecodeRequest);
+        if (!req)
+            return false;
+        req->handle = rs->handle;
+        req->callbacks = rs->callbacks;
+        req->mem = mem;
+        req->uri = params.uri;
+        memcpy(req->userParams, rs->userParams, sizeof(req->userParams));
+        req->objAlloc = rs->objAlloc;
+        req->flags = params.flags;
+        req->decoded = 0;
+        req->decodeResult = false;
+        req->cancelled = false;
+
+        AsyncDecodeRequest** preq = assetLib->decodeRequests.push();
+        if (!preq) {
+            BX_DELETE(assetLib->alloc, req);
+            return false;
+        }
+        *preq = req;
+
+        JobDesc job(decodeAssetJob, req, JobPriority::Low);
+        req->job = dispatchBigJobs(&job, 1);
+        if (!req->job.isValid()) {
+            assetLib->decodeRequests.pop();
+            BX_DELETE(assetLib->alloc, req);
+            return false;
+        }
+
+        return true;
+    }
+
+    static void finalizeDecode(AsyncDecodeRequest* req)
+    {
+        AssetLib* assetLib = gAssetLib;
+
+        if (!req->cancelled) {
+            AssetParams params;
+            params.uri = req->uri.cstr();
+            params.userParams = req->userParams;
+            params.flags = req->flags;
+            uintptr_t obj = 0;
+            bool loadResult = req->decodeResult && 
+                req->callbacks->finalizeObj(req->decoded, params, &obj, req->objAlloc);
+
+            // 'finalizeObj' may load other assets, so get the asset after that
+            Asset* rs = assetLib->assets.getHandleData<Asset>(0, req->handle);
+            if (!loadResult) {
+                BX_WARN("Loading asset '%s' failed", req->uri.cstr());
+                rs->loadState = AssetState::LoadFailed;
+
+                // Set fail obj to asset
+                int typeIdx = assetLib->assetTypesTable.find(rs->typeNameHash);
+                if (typeIdx != -1) {
+                    rs->obj = assetLib->assetTypes.getHandleData<AssetTypeData>(
+                        0, assetLib->assetTypesTable.getValue(typeIdx))->failObj;
+                }
+            } else {
+                rs->obj = obj;
+                rs->loadState = AssetState::LoadOk;
+
+                // Trigger onReload callback
+                if (req->flags & AssetFlags::Reload) {
+                    rs->callbacks->onReload(rs->handle, rs->objAlloc);
+                }
+            }
+        } else if (req->decodeResult) {
+            req->callbacks->releaseDecoded(req->decoded, req->objAlloc);
+        }
+
+        releaseMemoryBlock(req->mem);
+        BX_DELETE(assetLib->alloc, req);
+    }
+
+    void asset::update()
+    {
+        AssetLib* assetLib = gAssetLib;
+        if (!assetLib)
+            return;
+
+        int i = 0;
+        while (i < assetLib->decodeRequests.getCount()) {
+            AsyncDecodeRequest* req = assetLib->decodeRequests[i];
+            if (!isJobDone(req->job)) {
+                i++;
+                continue;
+            }
+            deleteJob(req->job);
+
+            // Remove before finalizing, 'finalizeObj' may load other assets and add new requests
+            AsyncDecodeRequest** reqs = assetLib->decodeRequests.getBuffer();
+            int count = assetLib->decodeRequests.getCount();
+            if (i < count - 1)
+                memmove(&reqs[i], &reqs[i + 1], sizeof(AsyncDecodeRequest*)*(count - i - 1));
+            assetLib->decodeRequests.pop();
+
+            finalizeDecode(req);
+        }
+    }
+
+    void asset::cancelDecodes()
+    {
+        AssetLib* assetLib = gAssetLib;
+        if (!assetLib)
+            return;
+
+        for (int i = 0, c = assetLib->decodeRequests.getCount(); i < c; i++) {
+            AsyncDecodeRequest* req = assetLib->decodeRequests[i];
+            waitAndDeleteJob(req->job);
+            req->cancelled = true;
+            finalizeDecode(req);
+        }
+        assetLib->decodeRequests.clear();
+    }
+
     // Async
     void AssetLib::onOpenError(const char* uri)
     {
@@ -880,6 +1058,7 @@ namespace tee {
             int handle = this->asyncLoadsTable[r];
             AsyncLoadRequest* areq = this->asyncLoads.getHandleData<AsyncLoadRequest>(0, handle);
             this->asyncLoads.freeHandle(handle);
+            this->asyncLoadsTable.remove(r);
 
             BX_ASSERT(areq->handle.isValid());
             AssetHandle aHandle = areq->handle;
@@ -890,10 +1069,19 @@ namespace tee {
             params.uri = uri;
             params.userParams = rs->userParams;
             params.flags = areq->flags;
+
+            // Decode in a job if the loader supports it, object is created later in asset::update
+            if ((getConfig().engineFlags & InitEngineFlags::EnableJobDispatcher) && getNumWorkerThreads() > 0 &&
+                rs->callbacks->canDecode(params, rs->objAlloc))
+            {
+                if (dispatchDecode(rs, params, mem))
+                    return;
+                // Dispatch failed, fallback to loadObj
+            }
+
             uintptr_t obj;
             bool loadResult = rs->callbacks->loadObj(mem, params, &obj, rs->objAlloc);
             releaseMemoryBlock(mem);
-            this->asyncLoadsTable.remove(r);
 
             // Refresh 'rs' pointer, because in 'loadObj' we may load another resource and the 'assets' HandlePool is reallocated, 
             // thus the 'rs' pointer will be mangled
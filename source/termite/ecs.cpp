@@ -1,8 +1,10 @@
 #include "pch.h"
 #include "ecs.h"
 #include "internal.h"
+#include "job_dispatcher.h"
 
 #include "bx/uint32_t.h"
+#include "bx/timer.h"
 #include "bxx/array.h"
 #include "bxx/pool.h"
 #include "bxx/queue.h"
@@ -12,6 +14,7 @@
 #include "remotery/Remotery.h"
 
 #define MIN_FREE_INDICES 1024
+#define DEFAULT_UPDATE_CHUNK_SIZE 256
 
 #define COMPONENT_INSTANCE_HANDLE(_Handle) uint16_t(_Handle.value & kComponentHandleMask)
 #define COMPONENT_TYPE_INDEX(_Handle) uint16_t((_Handle.value >> kComponentHandleBits) & kComponentTypeHandleMask)
@@ -50,18 +53,47 @@ namespace tee
         EntityHashTable destroyTable; // keep a multi-hash for all components that entity has to destroy
         EntityHashTable deactiveTable;
         bx::Pool<EntityHashTable::Node> nodePool;
+        bx::Array<Entity> deadEnts;     // Destroyed entities that may still have components, drained by garbageCollect
+        int deadEntsHead;
         uint16_t numEnts;
 
         EntityManager(bx::AllocatorI* _alloc) :
             alloc(_alloc),
             freeIndexSize(0),
             destroyTable(bx::HashTableType::Mutable),
-            deactiveTable(bx::HashTableType::Mutable)
+            deactiveTable(bx::HashTableType::Mutable),
+            deadEntsHead(0)
         {
             numEnts = 0;
         }
     };
 
+    // Paged sparse array: Entity index -> Component instance handle, pages are allocated on first use
+    static const uint32_t kEntityPageBits = 12;
+    static const uint32_t kEntityPageSize = 1 << kEntityPageBits;
+
+    struct EntityMap
+    {
+        bx::AllocatorI* alloc;
+        uint16_t** pages;
+        int numPages;
+    };
+
+    // Dense storage for ComponentFlag::Packed types, data buffer of the handle pool is not used for them
+    struct PackedStorage
+    {
+        bx::AllocatorI* alloc;
+        uint8_t* data;
+        Entity* ents;
+        uint16_t* handles;      // Dense index -> Instance handle
+        uint16_t* indices;      // Instance handle -> Dense index
+        uint32_t dataSize;
+        uint16_t count;
+        uint16_t numActive;     // Active components are kept at the front
+        uint16_t capacity;
+        uint16_t growSize;
+    };
+
     struct ComponentType
     {
         char name[32];
@@ -69,38 +101,53 @@ namespace tee
         ComponentFlag::Bits flags;
         uint32_t dataSize;
         bx::HandlePool dataPool;
-        bx::HashTable<ComponentHandle, uint32_t> entTable;  // Entity -> ComponentHandle
+        EntityMap entMap;
+        PackedStorage packed;
 
-        ComponentType() :
-            entTable(bx::HashTableType::Mutable)
+        ComponentType()
         {
             strcpy(name, "");
-            bx::memSet(&callbacks, 0x00, sizeof(callbacks));
+            callbacks = ComponentCallbacks();   // Fields that the caller doesn't provide keep these defaults
+            bx::memSet(&entMap, 0x00, sizeof(entMap));
+            bx::memSet(&packed, 0x00, sizeof(packed));
             flags = ComponentFlag::None;
             dataSize = 0;
         }
     };
 
+    // Group that the component belongs to (dataPool buffer 2)
+    struct GroupLink
+    {
+        ComponentGroupHandle group;
+        int slot;   // Index in the group bucket, -1 if it's not in the group
+    };
+
     struct ComponentGroupPair
     {
         ComponentGroupHandle cgroup;
         ComponentHandle component;
+        bool add;
     };
 
     struct ComponentGroup
     {
-        struct Batch
+        // Components of each type are kept together, so every bucket is an update batch
+        // Each component keeps its index in the bucket (GroupLink), so add/remove are append/swap-remove
+        struct Bucket
         {
-            int index;
-            int count;
+            uint16_t typeIndex;
+            bx::Array<ComponentHandle> components;
         };
 
-        bx::Array<ComponentHandle> components;
-        bx::Array<Batch> batches;
-        bool sorted;
+        bx::AllocatorI* alloc;
+        bx::Array<Bucket> buckets;  // Sorted by typeIndex
+        uint16_t growSize;
+        int count;
 
         ComponentGroup() :
-            sorted(false)
+            alloc(nullptr),
+            growSize(0),
+            count(0)
         {
         }
     };
@@ -112,8 +159,7 @@ namespace tee
         bx::HashTableInt nameTable;
         bx::HandlePool componentGroups;
         bool lockComponentGroups;
-        bx::Array<ComponentGroupPair> deferredGroupAddCmds;
-        bx::Array<ComponentGroupPair> deferredGroupRemoveCmds;
+        bx::Array<ComponentGroupPair> deferredGroupCmds;    // Adds/Removes while groups are locked, applied in order
 
         ComponentSystem(bx::AllocatorI* _alloc) :
             alloc(_alloc),
@@ -125,6 +171,165 @@ namespace tee
 
     static ComponentSystem* gECS = nullptr;
 
+    static uint16_t findEntityMap(const EntityMap* map, uint32_t index)
+    {
+        uint32_t page = index >> kEntityPageBits;
+        if (page < uint32_t(map->numPages) && map->pages[page])
+            return map->pages[page][index & (kEntityPageSize - 1)];
+        return UINT16_MAX;
+    }
+
+    static bool setEntityMap(EntityMap* map, uint32_t index, uint16_t instHandle)
+    {
+        int page = int(index >> kEntityPageBits);
+        if (page >= map->numPages) {
+            int numPages = bx::min<int>(bx::max<int>(page + 1, map->numPages*2), 
+                                        ((1 << kEntityIndexBits) + kEntityPageSize - 1) / kEntityPageSize);
+            uint16_t** pages = (uint16_t**)BX_REALLOC(map->alloc, map->pages, sizeof(uint16_t*)*numPages);
+            if (!pages)
+                return false;
+            bx::memSet(pages + map->numPages, 0x00, sizeof(uint16_t*)*(numPages - map->numPages));
+            map->pages = pages;
+            map->numPages = numPages;
+        }
+
+        if (!map->pages[page]) {
+            map->pages[page] = (uint16_t*)BX_ALLOC(map->alloc, sizeof(uint16_t)*kEntityPageSize);
+            if (!map->pages[page])
+                return false;
+            bx::memSet(map->pages[page], 0xff, sizeof(uint16_t)*kEntityPageSize);
+        }
+
+        map->pages[page][index & (kEntityPageSize - 1)] = instHandle;
+        return true;
+    }
+
+    static void destroyEntityMap(EntityMap* map)
+    {
+        if (map->pages) {
+            for (int i = 0; i < map->numPages; i++) {
+                if (map->pages[i])
+                    BX_FREE(map->alloc, map->pages[i]);
+            }
+            BX_FREE(map->alloc, map->pages);
+        }
+        map->pages = nullptr;
+        map->numPages = 0;
+    }
+
+    // Returns instance handle of the entity's component, UINT16_MAX if entity doesn't have it
+    static uint16_t findComponentInstance(ComponentType& ctype, Entity ent)
+    {
+        uint16_t instHandle = findEntityMap(&ctype.entMap, ent.getIndex());
+        if (instHandle != UINT16_MAX && *ctype.dataPool.getHandleData<Entity>(0, instHandle) == ent)
+            return instHandle;
+        return UINT16_MAX;
+    }
+
+    static bool growPacked(PackedStorage* ps, uint16_t minCapacity)
+    {
+        uint16_t capacity = (uint16_t)bx::min<uint32_t>(uint32_t(minCapacity) + ps->growSize, UINT16_MAX);
+        size_t totalSize = (ps->dataSize + sizeof(Entity) + 2*sizeof(uint16_t))*capacity;
+        uint8_t* buff = (uint8_t*)BX_ALLOC(ps->alloc, totalSize);
+        if (!buff)
+            return false;
+
+        uint8_t* data = buff;                   buff += ps->dataSize*capacity;
+        Entity* ents = (Entity*)buff;           buff += sizeof(Entity)*capacity;
+        uint16_t* handles = (uint16_t*)buff;    buff += sizeof(uint16_t)*capacity;
+        uint16_t* indices = (uint16_t*)buff;
+
+        if (ps->data) {
+            bx::memCopy(data, ps->data, ps->dataSize*ps->count);
+            bx::memCopy(ents, ps->ents, sizeof(Entity)*ps->count);
+            bx::memCopy(handles, ps->handles, sizeof(uint16_t)*ps->count);
+            bx::memCopy(indices, ps->indices, sizeof(uint16_t)*ps->capacity);
+            BX_FREE(ps->alloc, ps->data);
+        }
+
+        ps->data = data;
+        ps->ents = ents;
+        ps->handles = handles;
+        ps->indices = indices;
+        ps->capacity = capacity;
+        return true;
+    }
+
+    static void destroyPacked(PackedStorage* ps)
+    {
+        if (ps->data)
+            BX_FREE(ps->alloc, ps->data);
+        bx::memSet(ps, 0x00, sizeof(PackedStorage));
+    }
+
+    static void swapPacked(PackedStorage* ps, uint16_t a, uint16_t b)
+    {
+        if (a == b)
+            return;
+
+        // Swap data in small chunks, data size can be anything
+        uint8_t tmp[64];
+        uint8_t* da = ps->data + a*ps->dataSize;
+        uint8_t* db = ps->data + b*ps->dataSize;
+        for (uint32_t offset = 0; offset < ps->dataSize; offset += sizeof(tmp)) {
+            uint32_t size = bx::min<uint32_t>(sizeof(tmp), ps->dataSize - offset);
+            bx::memCopy(tmp, da + offset, size);
+            bx::memCopy(da + offset, db + offset, size);
+            bx::memCopy(db + offset, tmp, size);
+        }
+
+        std::swap<Entity>(ps->ents[a], ps->ents[b]);
+        std::swap<uint16_t>(ps->handles[a], ps->handles[b]);
+        ps->indices[ps->handles[a]] = a;
+        ps->indices[ps->handles[b]] = b;
+    }
+
+    // New components are always active
+    static void* addPacked(PackedStorage* ps, uint16_t handle, Entity ent)
+    {
+        if (ps->count == ps->capacity || handle >= ps->capacity) {
+            if (!growPacked(ps, bx::max<uint16_t>(ps->count + 1, handle + 1)))
+                return nullptr;
+        }
+
+        uint16_t index = ps->count++;
+        ps->ents[index] = ent;
+        ps->handles[index] = handle;
+        ps->indices[handle] = index;
+        swapPacked(ps, index, ps->numActive++);
+        return ps->data + ps->indices[handle]*ps->dataSize;
+    }
+
+    static void setPackedActive(PackedStorage* ps, uint16_t handle, bool active)
+    {
+        uint16_t index = ps->indices[handle];
+        if (active && index >= ps->numActive)
+            swapPacked(ps, index, ps->numActive++);
+        else if (!active && index < ps->numActive)
+            swapPacked(ps, index, --ps->numActive);
+    }
+
+    static void removePacked(PackedStorage* ps, uint16_t handle)
+    {
+        setPackedActive(ps, handle, false);
+        swapPacked(ps, ps->indices[handle], --ps->count);
+    }
+
+    static inline void* getComponentData(ComponentType& ctype, uint16_t instHandle)
+    {
+        if (ctype.flags & ComponentFlag::Packed)
+            return ctype.packed.data + ctype.packed.indices[instHandle]*ctype.dataSize;
+        else
+            return ctype.dataPool.getHandleData(1, instHandle);
+    }
+
+    static inline void setComponentActive(ComponentType& ctype, uint16_t instHandle, bool active)
+    {
+        *ctype.dataPool.getHandleData<bool>(3, instHandle) = active;
+        if (ctype.flags & ComponentFlag::Packed)
+            setPackedActive(&ctype.packed, instHandle, active);
+    }
+
     EntityManager* ecs::createEntityManager(bx::AllocatorI* alloc, int bufferSize)
     {
         EntityManager* emgr = BX_NEW(alloc, EntityManager)(alloc);
@@ -135,6 +340,7 @@ namespace tee
         if (!emgr->generations.create(bufferSize, bufferSize, alloc) ||
             !emgr->freeIndexPool.create(bufferSize, alloc) ||
             !emgr->nodePool.create(bufferSize, alloc) ||
+            !emgr->deadEnts.create(bufferSize, bufferSize, alloc) ||
             !emgr->destroyTable.create(bufferSize, alloc, &emgr->nodePool) ||
             !emgr->deactiveTable.create(bufferSize, alloc, &emgr->nodePool)) {
             ecs::destroyEntityManager(emgr);
@@ -151,6 +357,7 @@ namespace tee
         emgr->freeIndexPool.destroy();
         emgr->nodePool.destroy();
         emgr->generations.destroy();
+        emgr->deadEnts.destroy();
         emgr->deactiveTable.destroy();
         emgr->destroyTable.destroy();
 
@@ -175,20 +382,82 @@ namespace tee
         return ent;
     }
 
+    static ComponentGroup::Bucket* findGroupBucket(ComponentGroup* group, uint16_t typeIndex)
+    {
+        int first = 0;
+        int last = group->buckets.getCount();
+        while (first < last) {
+            int mid = (first + last) / 2;
+            ComponentGroup::Bucket* bucket = group->buckets.itemPtr(mid);
+            if (bucket->typeIndex == typeIndex)
+                return bucket;
+            else if (bucket->typeIndex < typeIndex)
+                first = mid + 1;
+            else
+                last = mid;
+        }
+        return nullptr;
+    }
+
+    static ComponentGroup::Bucket* addGroupBucket(ComponentGroup* group, uint16_t typeIndex)
+    {
+        int index = group->buckets.getCount();
+        while (index > 0 && group->buckets[index - 1].typeIndex > typeIndex)
+            index--;
+
+        ComponentGroup::Bucket* buff = group->buckets.push();
+        if (!buff)
+            return nullptr;
+        buff = group->buckets.getBuffer();
+        int count = group->buckets.getCount();
+        for (int i = count - 1; i > index; i--)
+            buff[i] = buff[i - 1];
+
+        ComponentGroup::Bucket* bucket = new(&buff[index]) ComponentGroup::Bucket();
+        bucket->typeIndex = typeIndex;
+        if (!bucket->components.create(32, group->growSize, group->alloc)) {
+            for (int i = index; i < count - 1; i++)
+                buff[i] = buff[i + 1];
+            group->buckets.pop();
+            return nullptr;
+        }
+        return bucket;
+    }
+
+    static int* getGroupSlot(ComponentHandle component)
+    {
+        ComponentType& ctype = gECS->components[COMPONENT_TYPE_INDEX(component)];
+        return &ctype.dataPool.getHandleData<GroupLink>(2, COMPONENT_INSTANCE_HANDLE(component))->slot;
+    }
+
     static void addToComponentGroup(ComponentGroupHandle handle, ComponentHandle component)
     {
         if (!gECS->lockComponentGroups) {
             ComponentGroup* group = gECS->componentGroups.getHandleData<ComponentGroup>(0, handle);
-            ComponentHandle* pchandle = group->components.push();
+            uint16_t typeIndex = COMPONENT_TYPE_INDEX(component);
+            ComponentGroup::Bucket* bucket = findGroupBucket(group, typeIndex);
+            if (!bucket) {
+                bucket = addGroupBucket(group, typeIndex);
+                if (!bucket)
+                    return;
+            }
+
+            int* slot = getGroupSlot(component);
+            if (*slot >= 0 && *slot < bucket->components.getCount() && bucket->components[*slot] == component)
+                return;     // Already in the group
+
+            ComponentHandle* pchandle = bucket->components.push();
             if (pchandle) {
                 *pchandle = component;
-                group->sorted = false;
+                *slot = bucket->components.getCount() - 1;
+                group->count++;
             }
         } else {
-            ComponentGroupPair* p = gECS->deferredGroupAddCmds.push();
+            ComponentGroupPair* p = gECS->deferredGroupCmds.push();
             BX_ASSERT(p);
             p->cgroup = handle;
             p->component = component;
+            p->add = true;
         }
     }
 
@@ -199,20 +468,34 @@ namespace tee
 
         if (!gECS->lockComponentGroups) {
             ComponentGroup* group = gECS->componentGroups.getHandleData<ComponentGroup>(0, handle);
-            int count = group->components.getCount();
-            // Find the component and Swap current with the last group
-            int index = group->components.find(component);
+            ComponentGroup::Bucket* bucket = findGroupBucket(group, COMPONENT_TYPE_INDEX(component));
+            if (!bucket)
+                return;
+
+            // Slot can be stale if the component is destroyed and it's handle is reused while the group was locked
+            int* slot = getGroupSlot(component);
+            int count = bucket->components.getCount();
+            int index = *slot;
+            if (index < 0 || index >= count || bucket->components[index] != component)
+                index = bucket->components.find(component);
+
             if (index != -1) {
-                ComponentHandle* buff = group->components.getBuffer();
-                std::swap<ComponentHandle>(buff[index], buff[count-1]);
-                group->sorted = false;
-                group->components.pop();
+                // Swap with the last one in the bucket
+                ComponentHandle* buff = bucket->components.getBuffer();
+                if (index != count - 1) {
+                    buff[index] = buff[count - 1];
+                    *getGroupSlot(buff[index]) = index;
+                }
+                bucket->components.pop();
+                group->count--;
+                *slot = -1;
             }
         } else {
-            ComponentGroupPair* p = gECS->deferredGroupRemoveCmds.push();
+            ComponentGroupPair* p = gECS->deferredGroupCmds.push();
             BX_ASSERT(p);
             p->cgroup = handle;
             p->component = component;
+            p->add = false;
         }
     }
 
@@ -224,19 +507,20 @@ namespace tee
         uint16_t instHandle = COMPONENT_INSTANCE_HANDLE(handle);
 
         // Remove from component group
-        ComponentGroupHandle groupHandle = *ctype.dataPool.getHandleData<ComponentGroupHandle>(2, instHandle);
+        ComponentGroupHandle groupHandle = ctype.dataPool.getHandleData<GroupLink>(2, instHandle)->group;
         if (groupHandle.isValid())
             removeFromComponentGroup(groupHandle, handle);
 
         // Call destroy callback
         if (ctype.callbacks.destroyInstance)
-            ctype.callbacks.destroyInstance(ent, handle, ctype.dataPool.getHandleData(1, instHandle));
+            ctype.callbacks.destroyInstance(ent, handle, getComponentData(ctype, instHandle));
 
+        if (ctype.flags & ComponentFlag::Packed)
+            removePacked(&ctype.packed, instHandle);
+        Entity owner = *ctype.dataPool.getHandleData<Entity>(0, instHandle);
+        if (findEntityMap(&ctype.entMap, owner.getIndex()) == instHandle)
+            setEntityMap(&ctype.entMap, owner.getIndex(), UINT16_MAX);
         ctype.dataPool.freeHandle(instHandle);
-
-        int r = ctype.entTable.find(ent.id);
-        if (r != -1)
-            ctype.entTable.remove(r);
     }
 
     void ecs::destroy(EntityManager* emgr, Entity ent)
@@ -256,9 +540,9 @@ namespace tee
                 bool prevActive = *ctype.dataPool.getHandleData<bool>(3, handle);
                 if (prevActive) {
                     uint16_t cHandle = COMPONENT_INSTANCE_HANDLE(handle);
-                    *(ctype.dataPool.getHandleData<bool>(3, cHandle)) = false;
+                    setComponentActive(ctype, cHandle, false);
                     if (ctype.callbacks.setActive)
-                        ctype.callbacks.setActive(handle, ctype.dataPool.getHandleData(1, cHandle), false, 0);
+                        ctype.callbacks.setActive(handle, getComponentData(ctype, cHandle), false, 0);
                 }
 
                 emgr->deactiveTable.remove(entIdx, node);
@@ -280,8 +564,15 @@ namespace tee
             }
         }
 
+        // Rest of the components are destroyed later in garbageCollect
+        Entity* deadEnt = emgr->deadEnts.push();
+        if (deadEnt)
+            *deadEnt = ent;
+
+        // Generation wraps around within it's bits, zero is skipped so ids never become zero
         uint32_t idx = ent.getIndex();
-        ++emgr->generations[idx];
+        uint16_t gen = uint16_t((emgr->generations[idx] + 1) & kEntityGenerationMask);
+        emgr->generations[idx] = gen ? gen : 1;
 
         EntityManager::FreeIndex* fi = emgr->freeIndexPool.newInstance<int>(idx);
         if (fi) {
@@ -306,11 +597,11 @@ namespace tee
             uint16_t cHandle = COMPONENT_INSTANCE_HANDLE(handles[i]);
             bool prevActive = *ctype.dataPool.getHandleData<bool>(3, cHandle);
             if (prevActive != active) {
-                *ctype.dataPool.getHandleData<bool>(3, cHandle) = active;
+                setComponentActive(ctype, cHandle, active);
                 if (ctype.callbacks.setActive)
-                    ctype.callbacks.setActive(handles[i], ctype.dataPool.getHandleData(1, handles[i]), active, flags);
+                    ctype.callbacks.setActive(handles[i], getComponentData(ctype, cHandle), active, flags);
 
-                ComponentGroupHandle groupHandle = *ctype.dataPool.getHandleData<ComponentGroupHandle>(2, cHandle);
+                ComponentGroupHandle groupHandle = ctype.dataPool.getHandleData<GroupLink>(2, cHandle)->group;
                 if (groupHandle.isValid()) {
                     if (active)
                         addToComponentGroup(groupHandle, handles[i]);
@@ -350,8 +641,7 @@ namespace tee
         if (!gECS->components.create(32, 128, alloc) ||
             !gECS->nameTable.create(128, alloc) ||
             !gECS->componentGroups.create(&cgSz, 1, 32, 32, alloc) ||
-            !gECS->deferredGroupAddCmds.create(100, 200, alloc) ||
-            !gECS->deferredGroupRemoveCmds.create(100, 200, alloc))
+            !gECS->deferredGroupCmds.create(200, 200, alloc))
         {
             return false;
         }
@@ -370,17 +660,18 @@ namespace tee
             for (int k = 0; k < ctype.dataPool.getCount(); k++) {
                 ComponentHandle handle = COMPONENT_MAKE_HANDLE(i, ctype.dataPool.handleAt(k));
                 if (ctype.callbacks.destroyInstance)
-                    ctype.callbacks.destroyInstance(ecs::getEntity(handle), handle, ctype.dataPool.getHandleData(1, handle));
+                    ctype.callbacks.destroyInstance(ecs::getEntity(handle), handle, 
+                                                    getComponentData(ctype, COMPONENT_INSTANCE_HANDLE(handle)));
             }
 
+            destroyPacked(&ctype.packed);
             ctype.dataPool.destroy();
-            ctype.entTable.destroy();
+            destroyEntityMap(&ctype.entMap);
         }
         gECS->componentGroups.destroy();
         gECS->components.destroy();
         gECS->nameTable.destroy();
-        gECS->deferredGroupAddCmds.destroy();
-        gECS->deferredGroupRemoveCmds.destroy();
+        gECS->deferredGroupCmds.destroy();
 
         BX_DELETE(gECS->alloc, gECS);
     }
@@ -392,8 +683,9 @@ namespace tee
         ComponentGroupHandle handle = ComponentGroupHandle(gECS->componentGroups.newHandle());
         if (handle.isValid()) {
             ComponentGroup* group = new(gECS->componentGroups.getHandleData(0, handle)) ComponentGroup();
-            if (!group->components.create(poolSize, poolSize, alloc) ||
-                !group->batches.create(32, 64, alloc)) {
+            group->alloc = alloc;
+            group->growSize = poolSize;
+            if (!group->buckets.create(16, 16, alloc)) {
                 ecs::destroyGroup(handle);
                 return ComponentGroupHandle();
             }
@@ -408,36 +700,35 @@ namespace tee
 
         // Unlink all component references
         // It is recommended that you Call this function before destroying components/entities 
-        for (int i = 0; i < group->components.getCount(); i++) {
-            ComponentHandle chandle = group->components[i];
-            ComponentType& ctype = gECS->components[COMPONENT_TYPE_INDEX(chandle)];
-            *ctype.dataPool.getHandleData<ComponentGroupHandle>(2, COMPONENT_INSTANCE_HANDLE(chandle)) = ComponentGroupHandle();
+        for (int i = 0; i < group->buckets.getCount(); i++) {
+            ComponentGroup::Bucket& bucket = group->buckets[i];
+            for (int k = 0; k < bucket.components.getCount(); k++) {
+                ComponentHandle chandle = bucket.components[k];
+                ComponentType& ctype = gECS->components[COMPONENT_TYPE_INDEX(chandle)];
+                GroupLink* link = ctype.dataPool.getHandleData<GroupLink>(2, COMPONENT_INSTANCE_HANDLE(chandle));
+                link->group = ComponentGroupHandle();
+                link->slot = -1;
+            }
+            bucket.components.destroy();
         }
 
-        // Delete all deferred component group pairs with this handle
-        for (int i = 0; i < gECS->deferredGroupAddCmds.getCount(); i++) {
-            if (gECS->deferredGroupAddCmds[i].cgroup != handle)
-                continue;
-            std::swap<ComponentGroupPair>(gECS->deferredGroupAddCmds[i],
-                                          gECS->deferredGroupAddCmds[gECS->deferredGroupAddCmds.getCount()-1]);
-            gECS->deferredGroupAddCmds.pop();
-        }
-        for (int i = 0; i < gECS->deferredGroupRemoveCmds.getCount(); i++) {
-            if (gECS->deferredGroupRemoveCmds[i].cgroup != handle)
-                continue;
-            std::swap<ComponentGroupPair>(gECS->deferredGroupRemoveCmds[i],
-                                          gECS->deferredGroupRemoveCmds[gECS->deferredGroupRemoveCmds.getCount()-1]);
-            gECS->deferredGroupRemoveCmds.pop();
+        // Delete all deferred component group commands with this handle, keeping the order of the rest
+        int numCmds = 0;
+        for (int i = 0, c = gECS->deferredGroupCmds.getCount(); i < c; i++) {
+            if (gECS->deferredGroupCmds[i].cgroup != handle)
+                gECS->deferredGroupCmds[numCmds++] = gECS->deferredGroupCmds[i];
         }
+        while (gECS->deferredGroupCmds.getCount() > numCmds)
+            gECS->deferredGroupCmds.pop();
 
-        group->batches.destroy();
-        group->components.destroy();
+        group->buckets.destroy();
         gECS->componentGroups.freeHandle(handle);
     }
 
-    ComponentTypeHandle ecs::registerComponent(const char* name, const ComponentCallbacks* callbacks,
-                                               ComponentFlag::Bits flags, uint32_t dataSize, uint16_t poolSize,
-                                               uint16_t growSize, bx::AllocatorI* alloc)
+    // 'callbacksSize' is the size of ComponentCallbacks the caller was built with, fields after that keep their defaults
+    static ComponentTypeHandle registerComponentType(const char* name, const ComponentCallbacks* callbacks,
+                                                     size_t callbacksSize, ComponentFlag::Bits flags, uint32_t dataSize,
+                                                     uint16_t poolSize, uint16_t growSize, bx::AllocatorI* alloc)
     {
         BX_ASSERT(gECS);
         BX_ASSERT(gECS->components.getCount() < UINT16_MAX);
@@ -450,13 +741,23 @@ namespace tee
 
         bx::strCopy(ctype->name, sizeof(ctype->name), name);
         if (callbacks)
-            memcpy(&ctype->callbacks, callbacks, sizeof(ComponentCallbacks));
+            memcpy(&ctype->callbacks, callbacks, bx::min<size_t>(callbacksSize, sizeof(ComponentCallbacks)));
         ctype->flags = flags;
         ctype->dataSize = dataSize;
-        const uint32_t itemSizes[4] = {sizeof(Entity), dataSize, sizeof(ComponentGroupHandle), sizeof(bool)};
-        if (!ctype->dataPool.create(itemSizes, BX_COUNTOF(itemSizes), poolSize, growSize, alloc ? alloc : gECS->alloc) ||
-            !ctype->entTable.create(poolSize, alloc ? alloc : gECS->alloc)) {
+
+        // Packed types keep their data in PackedStorage, so data buffer of the pool is empty
+        bool packed = (flags & ComponentFlag::Packed) != 0;
+        const uint32_t itemSizes[4] = {sizeof(Entity), packed ? 0 : dataSize, sizeof(GroupLink), sizeof(bool)};
+        if (!ctype->dataPool.create(itemSizes, BX_COUNTOF(itemSizes), poolSize, growSize, alloc ? alloc : gECS->alloc))
             return ComponentTypeHandle();
+        ctype->entMap.alloc = alloc ? alloc : gECS->alloc;
+
+        if (packed) {
+            ctype->packed.alloc = alloc ? alloc : gECS->alloc;
+            ctype->packed.dataSize = dataSize;
+            ctype->packed.growSize = bx::max<uint16_t>(growSize, 1);
+            if (!growPacked(&ctype->packed, poolSize))
+                return ComponentTypeHandle();
         }
 
         // Add to ComponentType database
@@ -466,27 +767,65 @@ namespace tee
         return  ComponentTypeHandle(uint16_t(index));
     }
 
-    void ecs::garbageCollect(EntityManager* emgr)
+    ComponentTypeHandle ecs::registerComponent(const char* name, const ComponentCallbacks* callbacks,
+                                               ComponentFlag::Bits flags, uint32_t dataSize, uint16_t poolSize,
+                                               uint16_t growSize, bx::AllocatorI* alloc)
     {
-        // For each component perform garbage collection
-        for (int i = 0, c = gECS->components.getCount(); i < c; i++) {
-            ComponentType& ctype = gECS->components[i];
+        return registerComponentType(name, callbacks, sizeof(ComponentCallbacks), flags, dataSize, poolSize, growSize, alloc);
+    }
 
-            if ((ctype.flags & ComponentFlag::ImmediateDestroy) == 0) {
-                int aliveInRow = 0;
-                while (ctype.dataPool.getCount() && aliveInRow < 4) {
-                    uint16_t r = ctype.dataPool.handleAt(getRandomIntUniform(0, (int)ctype.dataPool.getCount() - 1));
-                    Entity ent = *ctype.dataPool.getHandleData<Entity>(0, r);
-                    if (ecs::isAlive(emgr, ent)) {
-                        aliveInRow++;
-                        continue;
-                    }
+    ComponentTypeHandle ecs::registerComponentV0(const char* name, const ComponentCallbacks* callbacks,
+                                                 ComponentFlag::Bits flags, uint32_t dataSize, uint16_t poolSize,
+                                                 uint16_t growSize, bx::AllocatorI* alloc)
+    {
+        // Version 0 ComponentCallbacks ends at 'debug'
+        return registerComponentType(name, callbacks, offsetof(ComponentCallbacks, updateStagePacked), flags, dataSize,
+                                     poolSize, growSize, alloc);
+    }
 
-                    aliveInRow = 0;
-                    ecs::destroyComponent(emgr, ent, COMPONENT_MAKE_HANDLE(i, r));
-                }
+    int ecs::garbageCollect(EntityManager* emgr, int budgetMicros, int maxEntities)
+    {
+        int64_t startTime = bx::getHPCounter();
+        int64_t budgetTicks = int64_t(budgetMicros)*bx::getHPFrequency()/1000000;
+        int numCollected = 0;
+        bx::Array<Entity>& deadEnts = emgr->deadEnts;
+
+        while (emgr->deadEntsHead < deadEnts.getCount()) {
+            if ((maxEntities > 0 && numCollected >= maxEntities) ||
+                (budgetTicks > 0 && bx::getHPCounter() - startTime >= budgetTicks))
+            {
+                break;
+            }
+
+            Entity ent = deadEnts[emgr->deadEntsHead++];
+            numCollected++;
+
+            // Generation has wrapped around and the id belongs to a live entity again
+            if (ecs::isAlive(emgr, ent))
+                continue;
+
+            const int maxHandles = 64;
+            ComponentHandle handles[maxHandles];
+            int numHandles;
+            while ((numHandles = ecs::getEntityComponents(ent, handles, maxHandles)) > 0) {
+                for (int i = 0; i < numHandles; i++)
+                    ecs::destroyComponent(emgr, ent, handles[i]);
             }
         }
+
+        // Queue is drained, or half of it is consumed, compact it
+        int numPending = deadEnts.getCount() - emgr->deadEntsHead;
+        if (numPending == 0) {
+            deadEnts.clear();
+            emgr->deadEntsHead = 0;
+        } else if (emgr->deadEntsHead > numPending) {
+            memmove(deadEnts.getBuffer(), deadEnts.itemPtr(emgr->deadEntsHead), sizeof(Entity)*numPending);
+            while (deadEnts.getCount() > numPending)
+                deadEnts.pop();
+            emgr->deadEntsHead = 0;
+        }
+
+        return numPending;
     }
 
     void ecs::garbageCollectAggressive(EntityManager* emgr)
@@ -526,6 +865,10 @@ namespace tee
 
 
         destroyArr.destroy();
+
+        // Everything is collected, so queued dead entities are no longer needed
+        emgr->deadEnts.clear();
+        emgr->deadEntsHead = 0;
     }
 
     ComponentHandle ecs::createComponent(EntityManager* emgr, Entity ent, ComponentTypeHandle handle,
@@ -533,17 +876,40 @@ namespace tee
     {
         ComponentType& ctype = gECS->components[handle.value];
 
-        if (ctype.entTable.find(ent.id) != -1) {
-            BX_ASSERT(false);  // Component instance Already exists for the entity
-            return ComponentHandle();
+        uint16_t prevIdx = findEntityMap(&ctype.entMap, ent.getIndex());
+        if (prevIdx != UINT16_MAX) {
+            Entity prevEnt = *ctype.dataPool.getHandleData<Entity>(0, prevIdx);
+            if (prevEnt == ent) {
+                BX_ASSERT(false);  // Component instance Already exists for the entity
+                return ComponentHandle();
+            }
+
+            // Index is reused, so previous owner is dead and it's component is not collected yet
+            ecs::destroyComponent(emgr, prevEnt, COMPONENT_MAKE_HANDLE(handle.value, prevIdx));
         }
 
         uint16_t cIdx = ctype.dataPool.newHandle();
         if (cIdx == UINT16_MAX)
             return ComponentHandle();
+        if (!setEntityMap(&ctype.entMap, ent.getIndex(), cIdx)) {
+            ctype.dataPool.freeHandle(cIdx);
+            return ComponentHandle();
+        }
         *ctype.dataPool.getHandleData<Entity>(0, cIdx) = ent;
-        void* data = ctype.dataPool.getHandleData(1, cIdx);
-        *ctype.dataPool.getHandleData<ComponentGroupHandle>(2, cIdx) = group;
+        void* data;
+        if (ctype.flags & ComponentFlag::Packed) {
+            data = addPacked(&ctype.packed, cIdx, ent);
+            if (!data) {
+                setEntityMap(&ctype.entMap, ent.getIndex(), UINT16_MAX);
+                ctype.dataPool.freeHandle(cIdx);
+                return ComponentHandle();
+            }
+        } else {
+            data = ctype.dataPool.getHandleData(1, cIdx);
+        }
+        GroupLink* link = ctype.dataPool.getHandleData<GroupLink>(2, cIdx);
+        link->group = group;
+        link->slot = -1;
         *ctype.dataPool.getHandleData<bool>(3, cIdx) = true;
 
         ComponentHandle chandle = COMPONENT_MAKE_HANDLE(handle.value, cIdx);
@@ -551,7 +917,6 @@ namespace tee
         if (group.isValid())
             addToComponentGroup(group, chandle);
 
-        ctype.entTable.add(ent.id, chandle);
 
         if (ctype.flags & ComponentFlag::ImmediateDestroy) {
             emgr->destroyTable.add(ent.id, chandle);
@@ -605,42 +970,106 @@ namespace tee
 
     }
 
-    static void sortAndBatchComponents(ComponentGroup* group)
+    struct UpdateChunk
     {
-        // Sort components if it's invalidated
-        if (!group->sorted) {
-            group->batches.clear();
-            int count = group->components.getCount();
-            if (count > 0) {
-                std::sort(group->components.itemPtr(0), group->components.itemPtr(0) + count,
-                          [](const ComponentHandle& a, const ComponentHandle& b) { return a.value < b.value; });
-
-                // Batch by component-type
-                ComponentTypeHandle prevHandle;
-                ComponentGroup::Batch* curBatch = nullptr;
-
-                for (int i = 0; i < count; i++) {
-                    ComponentTypeHandle curHandle = ComponentTypeHandle(COMPONENT_TYPE_INDEX(group->components[i]));
-                    if (curHandle != prevHandle) {
-                        curBatch = group->batches.push();
-                        curBatch->index = i;
-                        curBatch->count = 0;
-                        prevHandle = curHandle;
-                    }
-                    curBatch->count++;
-                }
+        ComponentCallbacks::UpdateStageFunc updateFn;
+        const ComponentHandle* handles;
+        uint16_t count;
+        float dt;
+#if RMT_ENABLED
+        char name[64];
+#endif
+    };
+
+    static void updateChunkJob(int jobIndex, void* userParam)
+    {
+        const UpdateChunk* chunk = (const UpdateChunk*)userParam;
+#if RMT_ENABLED
+        rmt_BeginCPUSampleDynamic(chunk->name, 0);
+#endif
+        chunk->updateFn(chunk->handles, chunk->count, chunk->dt);
+#if RMT_ENABLED
+        rmt_EndCPUSample();
+#endif
+    }
+
+    static bool canUpdateInParallel(const ComponentType& ctype)
+    {
+        return (ctype.flags & ComponentFlag::ParallelUpdate) && 
+            (getConfig().engineFlags & InitEngineFlags::EnableJobDispatcher) && getNumWorkerThreads() > 0;
+    }
+
+    static uint16_t getUpdateChunkSize(const ComponentType& ctype)
+    {
+        return ctype.callbacks.updateChunkSize ? ctype.callbacks.updateChunkSize : DEFAULT_UPDATE_CHUNK_SIZE;
+    }
+
+    // Splits buckets [firstBucket, lastBucket) into chunks and updates all of them in parallel
+    static void updateBucketsParallel(ComponentGroup* group, int firstBucket, int lastBucket, 
+                                      ComponentUpdateStage::Enum stage, const char* stageName, float dt)
+    {
+        int numChunks = 0;
+        for (int i = firstBucket; i < lastBucket; i++) {
+            const ComponentGroup::Bucket& bucket = group->buckets[i];
+            const ComponentType& ctype = gECS->components[bucket.typeIndex];
+            if (ctype.callbacks.updateStage[stage]) {
+                uint16_t chunkSize = getUpdateChunkSize(ctype);
+                numChunks += (bucket.components.getCount() + chunkSize - 1) / chunkSize;
+            }
+        }
+        if (numChunks == 0)
+            return;
+
+        bx::AllocatorI* tmpAlloc = getTempAlloc();
+        UpdateChunk* chunks = (UpdateChunk*)BX_ALLOC(tmpAlloc, sizeof(UpdateChunk)*numChunks);
+        JobDesc* jobs = (JobDesc*)BX_ALLOC(tmpAlloc, sizeof(JobDesc)*numChunks);
+        if (!chunks || !jobs)
+            return;
+
+        int chunkIdx = 0;
+        for (int i = firstBucket; i < lastBucket; i++) {
+            ComponentGroup::Bucket& bucket = group->buckets[i];
+            const ComponentType& ctype = gECS->components[bucket.typeIndex];
+            if (!ctype.callbacks.updateStage[stage])
+                continue;
+
+            uint16_t chunkSize = getUpdateChunkSize(ctype);
+            int count = bucket.components.getCount();
+            for (int k = 0; k < count; k += chunkSize) {
+                UpdateChunk* chunk = &chunks[chunkIdx];
+                chunk->updateFn = ctype.callbacks.updateStage[stage];
+                chunk->handles = bucket.components.itemPtr(k);
+                chunk->count = uint16_t(bx::min<int>(chunkSize, count - k));
+                chunk->dt = dt;
+#if RMT_ENABLED
+                bx::snprintf(chunk->name, sizeof(chunk->name), "%s: %s (%d)", stageName, ctype.name, chunk->count);
+#else
+                BX_UNUSED(stageName);
+#endif
+                jobs[chunkIdx] = JobDesc(updateChunkJob, chunk, JobPriority::High);
+                chunkIdx++;
+            }
+        }
 
+        if (numChunks > 1) {
+            JobHandle handle = dispatchSmallJobs(jobs, uint16_t(numChunks));
+            if (handle.isValid()) {
+                waitAndDeleteJob(handle);
+                return;
             }
-            group->sorted = true;
         }
+
+        // Single chunk or dispatcher is full, just run them here
+        for (int i = 0; i < numChunks; i++)
+            updateChunkJob(i, &chunks[i]);
     }
 
     void ecs::updateGroup(ComponentUpdateStage::Enum stage, ComponentGroupHandle groupHandle, float dt)
     {
         BX_ASSERT(groupHandle.isValid());
 
-#if RMT_ENABLED
         const char* stageName = "";
+#if RMT_ENABLED
         switch (stage) {
         case ComponentUpdateStage::InputUpdate:
             stageName = "Input";
@@ -666,46 +1095,128 @@ namespace tee
 #endif
 
         ComponentGroup* group = gECS->componentGroups.getHandleData<ComponentGroup>(0, groupHandle);
-        sortAndBatchComponents(group);
 
         // Call their callbacks
         gECS->lockComponentGroups = true;
-        for (int i = 0, c = group->batches.getCount(); i < c; i++) {
-            ComponentGroup::Batch batch = group->batches[i];
-            const ComponentType& ctype = gECS->components[COMPONENT_TYPE_INDEX(group->components[batch.index])];
-            if (ctype.callbacks.updateStage[stage]) {
+        int i = 0;
+        int c = group->buckets.getCount();
+        while (i < c) {
+            ComponentGroup::Bucket& bucket = group->buckets[i];
+            const ComponentType& ctype = gECS->components[bucket.typeIndex];
+            int count = bucket.components.getCount();
+            if (!ctype.callbacks.updateStage[stage] || count == 0) {
+                i++;
+                continue;
+            }
+
+            if (canUpdateInParallel(ctype)) {
+                // Gather following parallel types that don't conflict with each other, and update them all at once
+                int firstBucket = i;
+                uint32_t readMask = 0, writeMask = 0;
+                while (i < c) {
+                    const ComponentType& t = gECS->components[group->buckets[i].typeIndex];
+                    if (t.callbacks.updateStage[stage] && group->buckets[i].components.getCount() > 0) {
+                        if (!canUpdateInParallel(t) ||
+                            (t.callbacks.writeMask & (readMask | writeMask)) || (t.callbacks.readMask & writeMask))
+                        {
+                            break;
+                        }
+                        readMask |= t.callbacks.readMask;
+                        writeMask |= t.callbacks.writeMask;
+                    }
+                    i++;
+                }
+
+                updateBucketsParallel(group, firstBucket, i, stage, stageName, dt);
+                continue;
+            }
+
 #if RMT_ENABLED
-                bx::snprintf(name, sizeof(name), "%s: %s (%d)", stageName, ctype.name, batch.count);
-                rmt_BeginCPUSampleDynamic(name, 0);
+            bx::snprintf(name, sizeof(name), "%s: %s (%d)", stageName, ctype.name, count);
+            rmt_BeginCPUSampleDynamic(name, 0);
 #endif
-                ctype.callbacks.updateStage[stage](group->components.itemPtr(batch.index), batch.count, dt);
+            ctype.callbacks.updateStage[stage](bucket.components.getBuffer(), uint16_t(count), dt);
 #if RMT_ENABLED
-                rmt_EndCPUSample();
+            rmt_EndCPUSample();
 #endif
-            }
+            i++;
         }
         gECS->lockComponentGroups = false;
     }
 
-    void ecs::cleanupGroupUpdates()
+    void ecs::updateType(ComponentUpdateStage::Enum stage, ComponentTypeHandle typeHandle, float dt)
     {
-        // Check for deferred add/removes and apply them
+        BX_ASSERT(typeHandle.isValid());
+        ComponentType& ctype = gECS->components[typeHandle.value];
 
-        if (gECS->deferredGroupAddCmds.getCount() > 0) {
-            for (int i = 0, c = gECS->deferredGroupAddCmds.getCount(); i < c; i++) {
-                const ComponentGroupPair p = gECS->deferredGroupAddCmds[i];
-                addToComponentGroup(p.cgroup, p.component);
+#if RMT_ENABLED
+        char name[64];
+        bx::snprintf(name, sizeof(name), "%s (%d)", ctype.name, ctype.dataPool.getCount());
+        rmt_BeginCPUSampleDynamic(name, 0);
+#endif
+
+        gECS->lockComponentGroups = true;
+        if (ctype.flags & ComponentFlag::Packed) {
+            const PackedStorage& ps = ctype.packed;
+            ComponentCallbacks::UpdateStagePackedFunc updateFn = ctype.callbacks.updateStagePacked[stage];
+            if (updateFn && ps.numActive > 0) {
+                if (canUpdateInParallel(ctype)) {
+                    parallelFor(0, ps.numActive, getUpdateChunkSize(ctype), [&](int first, int last) {
+                        updateFn(ps.ents + first, ps.data + first*ps.dataSize, uint16_t(last - first), dt);
+                    }, JobPriority::High);
+                } else {
+                    updateFn(ps.ents, ps.data, ps.numActive, dt);
+                }
             }
-            gECS->deferredGroupAddCmds.clear();
+        } else if (ctype.callbacks.updateStage[stage]) {
+            uint16_t count = ctype.dataPool.getCount();
+            ComponentHandle* handles = count > 0 ? (ComponentHandle*)BX_ALLOC(getTempAlloc(), sizeof(ComponentHandle)*count) : nullptr;
+            uint16_t numActive = 0;
+            if (handles) {
+                for (uint16_t k = 0; k < count; k++) {
+                    uint16_t cHandle = ctype.dataPool.handleAt(k);
+                    if (*ctype.dataPool.getHandleData<bool>(3, cHandle))
+                        handles[numActive++] = COMPONENT_MAKE_HANDLE(typeHandle.value, cHandle);
+                }
+            }
+            if (numActive > 0)
+                ctype.callbacks.updateStage[stage](handles, numActive, dt);
         }
+        gECS->lockComponentGroups = false;
 
-        if (gECS->deferredGroupRemoveCmds.getCount() > 0) {
-            for (int i = 0, c = gECS->deferredGroupRemoveCmds.getCount(); i < c; i++) {
-                const ComponentGroupPair p = gECS->deferredGroupRemoveCmds[i];
+#if RMT_ENABLED
+        rmt_EndCPUSample();
+#endif
+    }
+
+    void* ecs::getPackedData(ComponentTypeHandle typeHandle, const Entity** ents, uint16_t* count, uint16_t* numActive)
+    {
+        BX_ASSERT(typeHandle.isValid());
+        const ComponentType& ctype = gECS->components[typeHandle.value];
+        if ((ctype.flags & ComponentFlag::Packed) == 0)
+            return nullptr;
+
+        if (ents)
+            *ents = ctype.packed.ents;
+        if (count)
+            *count = ctype.packed.count;
+        if (numActive)
+            *numActive = ctype.packed.numActive;
+        return ctype.packed.data;
+    }
+
+    void ecs::cleanupGroupUpdates()
+    {
+        // Apply deferred add/removes in the order they were issued, each one is an append or swap-remove
+        BX_ASSERT(!gECS->lockComponentGroups);
+        for (int i = 0, c = gECS->deferredGroupCmds.getCount(); i < c; i++) {
+            const ComponentGroupPair p = gECS->deferredGroupCmds[i];
+            if (p.add)
+                addToComponentGroup(p.cgroup, p.component);
+            else
                 removeFromComponentGroup(p.cgroup, p.component);
-            }
-            gECS->deferredGroupRemoveCmds.clear();
         }
+        gECS->deferredGroupCmds.clear();
     }
 
     void ecs::debug(ImGuiApi* imgui, void* userData)
@@ -773,10 +1284,10 @@ namespace tee
         BX_ASSERT(handle.isValid());
         BX_ASSERT(ent.isValid());
 
-        const ComponentType& ctype = gECS->components[handle.value];
-        int r = ctype.entTable.find(ent.id);
-        if (r != -1)
-            return ComponentHandle(ctype.entTable[r]);
+        ComponentType& ctype = gECS->components[handle.value];
+        uint16_t instHandle = findComponentInstance(ctype, ent);
+        if (instHandle != UINT16_MAX)
+            return COMPONENT_MAKE_HANDLE(handle.value, instHandle);
         else
             return ComponentHandle();
     }
@@ -794,7 +1305,7 @@ namespace tee
         BX_ASSERT(handle.isValid());
 
         ComponentType& ctype = gECS->components[COMPONENT_TYPE_INDEX(handle)];
-        return ctype.dataPool.getHandleData(1, COMPONENT_INSTANCE_HANDLE(handle));
+        return getComponentData(ctype, COMPONENT_INSTANCE_HANDLE(handle));
     }
 
     Entity ecs::getEntity(ComponentHandle handle)
@@ -810,7 +1321,7 @@ namespace tee
         BX_ASSERT(handle.isValid());
 
         ComponentType& ctype = gECS->components[COMPONENT_TYPE_INDEX(handle)];
-        return *ctype.dataPool.getHandleData<ComponentGroupHandle>(2, COMPONENT_INSTANCE_HANDLE(handle));
+        return ctype.dataPool.getHandleData<GroupLink>(2, COMPONENT_INSTANCE_HANDLE(handle))->group;
     }
 
     uint16_t ecs::getAllComponents(ComponentTypeHandle typeHandle, ComponentHandle* handles, uint16_t maxComponents)
@@ -834,16 +1345,16 @@ namespace tee
     {
         int index = 0;
         for (int i = 0, c = gECS->components.getCount(); i < c; i++) {
-            const ComponentType& ctype = gECS->components[i];
-            int r = ctype.entTable.find(ent.id);
-            if (r == -1)
+            ComponentType& ctype = gECS->components[i];
+            uint16_t instHandle = findComponentInstance(ctype, ent);
+            if (instHandle == UINT16_MAX)
                 continue;
 
             if (index == maxComponents)
                 return maxComponents;
 
             if (handles)
-                handles[index] = ctype.entTable[r];
+                handles[index] = COMPONENT_MAKE_HANDLE(i, instHandle);
             index ++;
         }
 
@@ -854,10 +1365,17 @@ namespace tee
     {
         BX_ASSERT(groupHandle.isValid());
         ComponentGroup* group = gECS->componentGroups.getHandleData<ComponentGroup>(0, groupHandle);
-        uint16_t count = bx::min<uint16_t>(maxComponents, (uint16_t)group->components.getCount());
-
-        if (handles)
-            memcpy(handles, group->components.getBuffer(), count*sizeof(ComponentHandle));
+        uint16_t count = bx::min<uint16_t>(maxComponents, (uint16_t)group->count);
+
+        if (handles) {
+            int offset = 0;
+            for (int i = 0, c = group->buckets.getCount(); i < c && offset < count; i++) {
+                const ComponentGroup::Bucket& bucket = group->buckets[i];
+                int n = bx::min<int>(count - offset, bucket.components.getCount());
+                memcpy(handles + offset, bucket.components.getBuffer(), n*sizeof(ComponentHandle));
+                offset += n;
+            }
+        }
         return count;
     }
 
@@ -867,20 +1385,14 @@ namespace tee
         BX_ASSERT(groupHandle.isValid());
         ComponentGroup* group = gECS->componentGroups.getHandleData<ComponentGroup>(0, groupHandle);
 
-        sortAndBatchComponents(group);
+        ComponentGroup::Bucket* bucket = findGroupBucket(group, typeHandle.value);
+        if (!bucket)
+            return 0;
 
-        for (int i = 0, c = group->batches.getCount(); i < c; i++) {
-            const ComponentGroup::Batch& batch = group->batches[i];
-            if (typeHandle == ComponentTypeHandle(COMPONENT_TYPE_INDEX(group->components[batch.index]))) {
-                uint16_t count = bx::min<uint16_t>(maxComponents, (uint16_t)batch.count);
-                if (handles) {
-                    memcpy(handles, group->components.itemPtr(batch.index), count*sizeof(ComponentHandle));
-                }
-                return count;
-            }
-        }
-
-        return 0;
+        uint16_t count = bx::min<uint16_t>(maxComponents, (uint16_t)bucket->components.getCount());
+        if (handles)
+            memcpy(handles, bucket->components.getBuffer(), count*sizeof(ComponentHandle));
+        return count;
     }
 
 }   // namespace tee
\ No newline at end of file
@@ -36,6 +36,13 @@
 // FNT file format (Binary)
 #define FNT_SIGN "BMF"
 
+// Fonts are decoded in jobs, so the reentrant version of strtok is used
+#if BX_COMPILER_MSVC
+#   define fntStrTok strtok_s
+#else
+#   define fntStrTok strtok_r
+#endif
+
 namespace tee
 {
 #pragma pack(push, 1)
@@ -161,6 +168,11 @@ namespace tee
         bool loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
         void unloadObj(uintptr_t obj, bx::AllocatorI* alloc) override;
         void onReload(AssetHandle handle, bx::AllocatorI* alloc) override;
+
+        bool canDecode(const AssetParams& params, bx::AllocatorI* alloc) override;
+        bool decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded, bx::AllocatorI* alloc) override;
+        bool finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
+        void releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc) override;
     };
 
     struct FontKerning
@@ -450,10 +462,22 @@ namespace tee
         BX_ASSERT(handle.isValid());
     }
 
-    static Font* loadFontText(const MemoryBlock* mem, const char* filepath, const LoadFontParams& params, bx::AllocatorI* alloc)
+    // Font with the texture that should be loaded on main thread (loadFontTexture)
+    struct DecodedFont
+    {
+        Font* font;
+        bx::Path texFilepath;   // Empty if there is no texture
+        LoadTextureParams texParams;
+    };
+
+    // Decode functions are thread-safe if 'alloc' and 'tmpAlloc' are
+    static bool decodeFontText(const MemoryBlock* mem, const char* filepath, const LoadFontParams& params, 
+                               bx::AllocatorI* alloc, bx::AllocatorI* tmpAlloc, DecodedFont* dfont)
     {
-        bx::AllocatorI* tmpAlloc = getTempAlloc();
-        char* strbuff = (char*)BX_ALLOC(tmpAlloc, mem->size + 1);
+        char* strbuffData = (char*)BX_ALLOC(tmpAlloc, mem->size + 1);
+        if (!strbuffData)
+            return false;
+        char* strbuff = strbuffData;
         memcpy(strbuff, mem->data, mem->size);
         strbuff[mem->size] = 0;
 
@@ -468,6 +492,7 @@ namespace tee
         uint16_t charWidth = 0;
         int16_t padding[4];
         int16_t spacing[2];
+        char* tokCtx = nullptr;
 
         auto readKeyValue = [](char* token, char* key, char* value, size_t maxChars) {
             char* equal = strchr(token, '=');
@@ -503,9 +528,9 @@ namespace tee
             return index;
         };
 
-        auto readInfo = [&name, &size, &flags, &padding, &spacing, readKeyValue, parseNumbers]() {
+        auto readInfo = [&tokCtx, &name, &size, &flags, &padding, &spacing, readKeyValue, parseNumbers]() {
             char key[32], value[32];
-            char* token = strtok(nullptr, " ");
+            char* token = fntStrTok(nullptr, " ", &tokCtx);
             while (token) {
                 readKeyValue(token, key, value, 32);
                 if (strcmp(key, "face") == 0) {
@@ -521,13 +546,13 @@ namespace tee
                 } else if (strcmp(key, "spacing") == 0) {
                     parseNumbers(value, spacing, 2);
                 }
-                token = strtok(nullptr, " ");
+                token = fntStrTok(nullptr, " ", &tokCtx);
             }
         };
 
-        auto readCommon = [&lineHeight, &base, &scaleW, &scaleH, readKeyValue]() {
+        auto readCommon = [&tokCtx, &lineHeight, &base, &scaleW, &scaleH, readKeyValue]() {
             char key[32], value[32];
-            char* token = strtok(nullptr, " ");
+            char* token = fntStrTok(nullptr, " ", &tokCtx);
             while (token) {
                 readKeyValue(token, key, value, 32);
                 if (strcmp(key, "lineHeight") == 0) {
@@ -539,34 +564,34 @@ namespace tee
                 } else if (strcmp(key, "scaleH") == 0) {
                     scaleH = bx::toInt(value);
                 }
-                token = strtok(nullptr, " ");
+                token = fntStrTok(nullptr, " ", &tokCtx);
             }
         };
          
-        auto readPage = [&texFilepath, filepath, readKeyValue]() {
+        auto readPage = [&tokCtx, &texFilepath, filepath, readKeyValue]() {
             char key[32], value[32];
-            char* token = strtok(nullptr, " ");
+            char* token = fntStrTok(nullptr, " ", &tokCtx);
             while (token) {
                 readKeyValue(token, key, value, 32);
                 if (strcmp(key, "file") == 0) {
                     texFilepath = bx::Path(filepath).getDirectory();
                     texFilepath.joinUnix(value);                    
                 }
-                token = strtok(nullptr, " ");
+                token = fntStrTok(nullptr, " ", &tokCtx);
             }
         };
 
-        auto readChars = [&numGlyphs, readKeyValue]() {
+        auto readChars = [&tokCtx, &numGlyphs, readKeyValue]() {
             char key[32], value[32];
-            char* token = strtok(nullptr, " ");
+            char* token = fntStrTok(nullptr, " ", &tokCtx);
             readKeyValue(token, key, value, 32);
             if (strcmp(key, "count") == 0)
                 numGlyphs = bx::toInt(value);
         };
 
-        auto readChar = [readKeyValue, &charWidth](FontGlyph& g) {
+        auto readChar = [&tokCtx, readKeyValue, &charWidth](FontGlyph& g) {
             char key[32], value[32];
-            char* token = strtok(nullptr, " ");
+            char* token = fntStrTok(nullptr, " ", &tokCtx);
             while (token) {
                 readKeyValue(token, key, value, 32);
                 if (strcmp(key, "id") == 0) {
@@ -590,22 +615,22 @@ namespace tee
                     g.xadvance = (float)xadvance;
                     charWidth = bx::max<uint16_t>(charWidth, (uint16_t)xadvance);
                 }
-                token = strtok(nullptr, " ");
+                token = fntStrTok(nullptr, " ", &tokCtx);
             }
         };
 
-        auto readKernings = [&numKernings, readKeyValue]() {
+        auto readKernings = [&tokCtx, &numKernings, readKeyValue]() {
             char key[32], value[32];
-            char* token = strtok(nullptr, " ");
+            char* token = fntStrTok(nullptr, " ", &tokCtx);
             readKeyValue(token, key, value, 32);
             if (strcmp(key, "count") == 0)
                 numKernings = bx::toInt(value);
         };
 
-        auto readKerning = [readKeyValue](FontKerning& k, int kernIdx, FontGlyph* glyphs, int numGlyphs) {
+        auto readKerning = [&tokCtx, readKeyValue](FontKerning& k, int kernIdx, FontGlyph* glyphs, int numGlyphs) {
             char key[32], value[32];
             int firstGlyphIdx = -1;
-            char* token = strtok(nullptr, " ");
+            char* token = fntStrTok(nullptr, " ", &tokCtx);
             while (token) {
                 readKeyValue(token, key, value, 32);
                 if (strcmp(key, "first") == 0) {
@@ -621,7 +646,7 @@ namespace tee
                 } else if (strcmp(key, "amount") == 0) {
                     k.amount = (float)bx::toInt(value);
                 } 
-                token = strtok(nullptr, " ");
+                token = fntStrTok(nullptr, " ", &tokCtx);
             }
 
             BX_ASSERT(firstGlyphIdx != -1);
@@ -641,7 +666,7 @@ namespace tee
                 if (line[lineLen-1] == '\r')
                     line[lineLen-1] = 0;
 
-                char* token = strtok(line, " ");
+                char* token = fntStrTok(line, " ", &tokCtx);
                 // Read line descriptors
                 if (strcmp(token, "info") == 0) {
                     readInfo();
@@ -682,9 +707,15 @@ namespace tee
             numKernings*sizeof(FontKerning) +
             bx::HashTable<int, uint16_t>::GetImmutableSizeBytes(numGlyphs);
         uint8_t* buff = (uint8_t*)BX_ALLOC(alloc, totalSz);
+        if (!buff) {
+            if (kernings)
+                BX_FREE(tmpAlloc, kernings);
+            if (glyphs)
+                BX_FREE(tmpAlloc, glyphs);
+            BX_FREE(tmpAlloc, strbuffData);
+            return false;
+        }
         Font* font = new(buff) Font;
-        if (!font)
-            return nullptr;
         buff += sizeof(Font);
         font->glyphs = (FontGlyph*)buff;
         buff += numGlyphs * sizeof(FontGlyph);
@@ -694,7 +725,12 @@ namespace tee
         // Hashtable for characters
         if (!font->glyphTable.createWithBuffer(numGlyphs, buff)) {
             BX_ASSERT(false);
-            return nullptr;
+            if (kernings)
+                BX_FREE(tmpAlloc, kernings);
+            if (glyphs)
+                BX_FREE(tmpAlloc, glyphs);
+            BX_FREE(tmpAlloc, strbuffData);
+            return false;
         }
         for (int i = 0; i < numGlyphs; i++)
             font->glyphTable.add(glyphs[i].charId, i);
@@ -715,22 +751,25 @@ namespace tee
         memcpy(font->padding, padding, sizeof(padding));
         memcpy(font->spacing, spacing, sizeof(spacing));
 
-        if (!texFilepath.isEmpty()) {
-            LoadTextureParams tparams;
-            tparams.flags = TextureFlag::U_Clamp | TextureFlag::V_Clamp;
-            tparams.generateMips = !(params.flags & FontFlags::DistantField) ? params.generateMips : false;
-            font->texHandles[0] = asset::load("texture", texFilepath.cstr(), &tparams, 0,
-                                               alloc == gFontMgr->alloc ? nullptr : alloc);
-        }
+        dfont->font = font;
+        dfont->texFilepath = texFilepath;
+        dfont->texParams.flags = TextureFlag::U_Clamp | TextureFlag::V_Clamp;
+        dfont->texParams.generateMips = !(params.flags & FontFlags::DistantField) ? params.generateMips : false;
 
         memcpy(font->glyphs, glyphs, numGlyphs*sizeof(FontGlyph));
         if (numKernings > 0)
             memcpy(font->kerns, kernings, numKernings*sizeof(FontKerning));
 
-        return font;
+        if (kernings)
+            BX_FREE(tmpAlloc, kernings);
+        if (glyphs)
+            BX_FREE(tmpAlloc, glyphs);
+        BX_FREE(tmpAlloc, strbuffData);
+        return true;
     }
 
-    static Font* loadFontBinary(const MemoryBlock* mem, const char* filepath, const LoadFontParams& params, bx::AllocatorI* alloc)
+    static bool decodeFontBinary(const MemoryBlock* mem, const char* filepath, const LoadFontParams& params, 
+                                 bx::AllocatorI* alloc, bx::AllocatorI* tmpAlloc, DecodedFont* dfont)
     {
         bx::Error err;
         bx::MemoryReader ms(mem->data, mem->size);
@@ -740,7 +779,7 @@ namespace tee
         ms.read(sign, 3, &err);  sign[3] = 0;
         if (strcmp(FNT_SIGN, sign) != 0) {
             TEE_ERROR("Loading font '%s' failed: Invalid FNT (bmfont) binary file", filepath);
-            return nullptr;
+            return false;
         }
 
         // File version
@@ -748,7 +787,7 @@ namespace tee
         ms.read(&fileVersion, sizeof(fileVersion), &err);
         if (fileVersion != 3) {
             TEE_ERROR("Loading font '%s' failed: Invalid file version", filepath);
-            return nullptr;
+            return false;
         }
 
         //
@@ -766,7 +805,7 @@ namespace tee
 
         if (common.pages != 1) {
             TEE_ERROR("Loading font '%s' failed: Invalid number of pages", filepath);
-            return nullptr;
+            return false;
         }
 
         // Font pages (textures)
@@ -779,13 +818,19 @@ namespace tee
         // Characters
         ms.read(&block, sizeof(block), &err);
         int numGlyphs = block.size / sizeof(fntChar_t);
-        fntChar_t* chars = (fntChar_t*)alloca(sizeof(fntChar_t)*numGlyphs);
+        fntChar_t* chars = (fntChar_t*)BX_ALLOC(tmpAlloc, sizeof(fntChar_t)*numGlyphs);
+        if (!chars)
+            return false;
         ms.read(chars, block.size, &err);
 
         // Kernings
         int last_r = ms.read(&block, sizeof(block), &err);
         int numKerns = block.size / sizeof(fntKernPair_t);
-        fntKernPair_t* kerns = (fntKernPair_t*)alloca(sizeof(fntKernPair_t)*(numKerns + 1));
+        fntKernPair_t* kerns = (fntKernPair_t*)BX_ALLOC(tmpAlloc, sizeof(fntKernPair_t)*(numKerns + 1));
+        if (!kerns) {
+            BX_FREE(tmpAlloc, chars);
+            return false;
+        }
         if (numKerns > 0 && last_r > 0)
             ms.read(kerns, block.size, &err);
 
@@ -795,9 +840,12 @@ namespace tee
             numKerns*sizeof(FontKerning) + 
             bx::HashTable<int, uint16_t>::GetImmutableSizeBytes(numGlyphs);
         uint8_t* buff = (uint8_t*)BX_ALLOC(alloc, totalSz);
+        if (!buff) {
+            BX_FREE(tmpAlloc, kerns);
+            BX_FREE(tmpAlloc, chars);
+            return false;
+        }
         Font* font = new(buff) Font;
-        if (!font)
-            return nullptr;
         buff += sizeof(Font);
         font->glyphs = (FontGlyph*)buff;
         buff += numGlyphs * sizeof(FontGlyph);
@@ -807,7 +855,9 @@ namespace tee
         // Hashtable for characters
         if (!font->glyphTable.createWithBuffer(numGlyphs, buff)) {
             BX_ASSERT(false);
-            return nullptr;
+            BX_FREE(tmpAlloc, kerns);
+            BX_FREE(tmpAlloc, chars);
+            return false;
         }
 
         bx::strCopy(font->name, sizeof(font->name), fontName);
@@ -818,10 +868,9 @@ namespace tee
         font->scaleH = common.scale_h;
         font->flags |= params.flags;
 
-        LoadTextureParams tparams;
-        tparams.generateMips = params.generateMips;
-        font->texHandles[0] = asset::load("texture", texFilepath.cstr(), &tparams, 0,
-                                           alloc == gFontMgr->alloc ? nullptr : alloc);
+        dfont->font = font;
+        dfont->texFilepath = texFilepath;
+        dfont->texParams.generateMips = params.generateMips;
         font->numPages = 1;
         bx::memSet(font->glyphs, 0x00, sizeof(FontGlyph)*numGlyphs);
 
@@ -867,20 +916,75 @@ namespace tee
         }
         font->numKerns = numKerns;
 
-        return font;
+        BX_FREE(tmpAlloc, kerns);
+        BX_FREE(tmpAlloc, chars);
+        return true;
     }
 
-    bool FontLoader::loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc)
+    static bool decodeFont(const MemoryBlock* mem, const AssetParams& params, bx::AllocatorI* alloc, 
+                           bx::AllocatorI* tmpAlloc, DecodedFont* dfont)
     {
         const LoadFontParams* fparams = (const LoadFontParams*)params.userParams;
-        Font* font = nullptr;
         if (fparams->format == FontFileFormat::Text) {
-            font = loadFontText(mem, params.uri, *fparams, alloc ? alloc : gFontMgr->alloc);
+            return decodeFontText(mem, params.uri, *fparams, alloc ? alloc : gFontMgr->alloc, tmpAlloc, dfont);
         } else if (fparams->format == FontFileFormat::Binary) {
-            font = loadFontBinary(mem, params.uri, *fparams, alloc ? alloc : gFontMgr->alloc);
+            return decodeFontBinary(mem, params.uri, *fparams, alloc ? alloc : gFontMgr->alloc, tmpAlloc, dfont);
+        }
+        return false;
+    }
+
+    static Font* loadFontTexture(DecodedFont* dfont, bx::AllocatorI* alloc)
+    {
+        Font* font = dfont->font;
+        if (!dfont->texFilepath.isEmpty()) {
+            font->texHandles[0] = asset::load("texture", dfont->texFilepath.cstr(), &dfont->texParams, 0,
+                                               alloc == gFontMgr->alloc ? nullptr : alloc);
         }
-        *obj = uintptr_t(font);
-        return font != nullptr ? true : false;
+        return font;
+    }
+
+    bool FontLoader::loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc)
+    {
+        DecodedFont dfont;
+        if (!decodeFont(mem, params, alloc, getTempAlloc(), &dfont))
+            return false;
+        *obj = uintptr_t(loadFontTexture(&dfont, alloc));
+        return true;
+    }
+
+    bool FontLoader::canDecode(const AssetParams& params, bx::AllocatorI* alloc)
+    {
+        // Font memory is allocated in the job, custom allocators may not be thread-safe
+        return alloc == nullptr;
+    }
+
+    bool FontLoader::decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded, bx::AllocatorI* alloc)
+    {
+        DecodedFont* dfont = BX_NEW(getHeapAlloc(), DecodedFont);
+        if (!dfont)
+            return false;
+        if (!decodeFont(mem, params, alloc, getHeapAlloc(), dfont)) {
+            BX_DELETE(getHeapAlloc(), dfont);
+            return false;
+        }
+        *decoded = uintptr_t(dfont);
+        return true;
+    }
+
+    bool FontLoader::finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc)
+    {
+        DecodedFont* dfont = (DecodedFont*)decoded;
+        *obj = uintptr_t(loadFontTexture(dfont, alloc));
+        BX_DELETE(getHeapAlloc(), dfont);
+        return true;
+    }
+
+    void FontLoader::releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc)
+    {
+        DecodedFont* dfont = (DecodedFont*)decoded;
+        dfont->font->glyphTable.destroy();
+        BX_FREE(alloc ? alloc : gFontMgr->alloc, dfont->font);
+        BX_DELETE(getHeapAlloc(), dfont);
     }
 
     void FontLoader::unloadObj(uintptr_t obj, bx::AllocatorI* alloc)
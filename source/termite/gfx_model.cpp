@@ -36,6 +36,11 @@ namespace tee {
         bool loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
         void unloadObj(uintptr_t obj, bx::AllocatorI* alloc) override;
         void onReload(AssetHandle handle, bx::AllocatorI* alloc) override;
+
+        bool canDecode(const AssetParams& params, bx::AllocatorI* alloc) override;
+        bool decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded, bx::AllocatorI* alloc) override;
+        bool finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
+        void releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc) override;
     };
 
     struct ModelManager
@@ -251,15 +256,15 @@ namespace tee {
         BX_DELETE(alloc, model);
     }
 
-    static bool loadModel10(bx::MemoryReader* data, const t3dHeader& header, const AssetParams& params, uintptr_t* obj,
-                            bx::AllocatorI* alloc)
+    // Reads model data without creating gpu buffers (createModelBuffers), so it can run in a job
+    static Model* decodeModel10(bx::MemoryReader* data, const t3dHeader& header, const AssetParams& params,
+                                bx::AllocatorI* alloc)
     {
         BX_ASSERT(gModelMgr, "");
         BX_ASSERT(alloc, "");
 
         bx::Error err;
         LoadModelParams* mparams = (LoadModelParams*)params.userParams;
-        GfxDriver* gDriver = gModelMgr->driver;
 
         // TODO: convert this to a single alloc call
         // Create model
@@ -416,6 +421,21 @@ namespace tee {
             // For now IndexBuffers are always uint16_t
             geo.vbFlags = GfxBufferFlag::None;
             geo.ibFlags = GfxBufferFlag::None;
+        }
+
+        // TODO: Materials
+
+
+        return model;
+    }
+
+    // Main thread part of the load, model is unloaded on failure
+    static bool createModelBuffers(Model* model, bx::AllocatorI* alloc)
+    {
+        GfxDriver* gDriver = gModelMgr->driver;
+
+        for (int i = 0; i < model->numGeos; i++) {
+            Model::Geometry& geo = model->geos[i];
 
             // Gpu Buffers
             if (!model->vbIsDynamic) {
@@ -432,39 +452,76 @@ namespace tee {
             }
         }
 
-        // TODO: Materials
-
-
-        *obj = uintptr_t(model);
         return true;
     }
 
-    bool ModelLoader::loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc)
+    static Model* decodeModel(const MemoryBlock* mem, const AssetParams& params, bx::AllocatorI* alloc)
     {
         bx::Error err;
         bx::MemoryReader reader(mem->data, mem->size);
 
-        if (!alloc)
-            alloc = gModelMgr->alloc;
-
         // Read the header
         t3dHeader header;
         reader.read(&header, sizeof(header), &err);
 
         if (header.sign != T3D_SIGN) {
             TEE_ERROR("Load model failed: Invalid header");
-            return false;
+            return nullptr;
         }
 
         switch (header.version) {
         case T3D_VERSION_10:
-            return loadModel10(&reader, header, params, obj, alloc);
+            return decodeModel10(&reader, header, params, alloc);
         default:
             TEE_ERROR("Load model failed: Invalid version: 0x%x", header.version);
-            return false;
+            return nullptr;
         }
     }
 
+    bool ModelLoader::loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc)
+    {
+        if (!alloc)
+            alloc = gModelMgr->alloc;
+
+        Model* model = decodeModel(mem, params, alloc);
+        if (!model || !createModelBuffers(model, alloc))
+            return false;
+
+        *obj = uintptr_t(model);
+        return true;
+    }
+
+    bool ModelLoader::canDecode(const AssetParams& params, bx::AllocatorI* alloc)
+    {
+        // Model memory is allocated in the job, custom allocators may not be thread-safe
+        return alloc == nullptr;
+    }
+
+    bool ModelLoader::decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded, 
+                                bx::AllocatorI* alloc)
+    {
+        Model* model = decodeModel(mem, params, alloc ? alloc : gModelMgr->alloc);
+        if (!model)
+            return false;
+        *decoded = uintptr_t(model);
+        return true;
+    }
+
+    bool ModelLoader::finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj, 
+                                  bx::AllocatorI* alloc)
+    {
+        Model* model = (Model*)decoded;
+        if (!createModelBuffers(model, alloc ? alloc : gModelMgr->alloc))
+            return false;
+        *obj = uintptr_t(model);
+        return true;
+    }
+
+    void ModelLoader::releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc)
+    {
+        unloadModel((Model*)decoded, alloc ? alloc : gModelMgr->alloc);
+    }
+
     void ModelLoader::unloadObj(uintptr_t obj, bx::AllocatorI* alloc)
     {
         BX_ASSERT(gModelMgr);
@@ -4,9 +4,12 @@
 #include "tmath.h"
 #include "internal.h"
 #include "gfx_driver.h"
+#include "job_dispatcher.h"
 #include "rapidjson.h"
 
 #include "bx/readerwriter.h"
+#include "bx/sort.h"
+#include "bx/simd_t.h"
 #include "bxx/path.h"
 #include "bxx/array.h"
 #include "bxx/linked_list.h"
@@ -15,6 +18,7 @@
 
 #include TEE_MAKE_SHADER_PATH(shaders_h, sprite.vso)
 #include TEE_MAKE_SHADER_PATH(shaders_h, sprite.fso)
+#include TEE_MAKE_SHADER_PATH(shaders_h, sprite_inst.vso)
 
 #define MAKE_SPRITE_KEY(_Order, _Texture, _Id) \
     (uint64_t(_Order & kSpriteKeyOrderMask) << kSpriteKeyOrderShift) | (uint64_t(_Texture & kSpriteKeyTextureMask) << kSpriteKeyTextureShift) | uint64_t(_Id & kSpriteKeyIdMask)
@@ -31,6 +35,12 @@ namespace tee {
     static const uint8_t kSpriteKeyOrderShift = kSpriteKeyTextureBits + kSpriteKeyIdBits;
     static const uint8_t kSpriteKeyTextureShift = kSpriteKeyIdBits;
 
+    // Sprite geometry is filled by multiple jobs if there are at least two chunks of this size
+    static const int kSpriteFillChunkSize = 2048;
+
+    // Batches with 16bit indices can't reference more vertices than this (indices are relative to batch's first vertex)
+    static const uint32_t kSpriteMaxBatchVerts16 = UINT16_MAX + 1;
+
     struct SpriteVertex
     {
         vec2_t pos;
@@ -56,12 +66,43 @@ namespace tee {
     };
     VertexDecl SpriteVertex::Decl;
 
+    // Unit quad (0~1) that is shared by all instanced sprites, it is also used as the texture coords lerp factor
+    struct SpriteQuadVertex
+    {
+        vec2_t pos;
+
+        static void init()
+        {
+            gfx::beginDecl(&Decl);
+            gfx::addAttrib(&Decl, VertexAttrib::Position, 2, VertexAttribType::Float);
+            gfx::endDecl(&Decl);
+        }
+
+        static VertexDecl Decl;
+    };
+    VertexDecl SpriteQuadVertex::Decl;
+
+    // Per-instance data for quad sprites (sprite_inst.vsc: i_data0~i_data3)
+    // Colors are packed two channels per float (c0 + c1*256), which is exact in 32bit floats
+    struct SpriteInstanceData
+    {
+        vec4_t transform1;  // m11, m12, m21, m22 (quad rect is pre-multiplied)
+        vec4_t transform2;  // m31, m32, color.rg, color.ba
+        rect_t coords;      // texture coords rect
+        vec4_t colorAdd;    // colorAdd.rg, colorAdd.b, 0, 0
+    };
+
     class SpriteSheetLoader : public AssetLibCallbacksI
     {
     public:
         bool loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
         void unloadObj(uintptr_t obj, bx::AllocatorI* alloc) override;
         void onReload(AssetHandle handle, bx::AllocatorI* alloc) override;
+
+        bool canDecode(const AssetParams& params, bx::AllocatorI* alloc) override;
+        bool decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded, bx::AllocatorI* alloc) override;
+        bool finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
+        void releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc) override;
     };
 
     struct SpriteMesh
@@ -72,12 +113,18 @@ namespace tee {
         int numVerts;
         int numTris;
 
+        // Rectangle meshes can be drawn with the instanced quad
+        bool quad;
+        rect_t quadRect;        // top-left, right-bottom in normalized (-0.5~0.5) coords
+        rect_t quadCoords;      // texture coords of top-left, right-bottom
+
         SpriteMesh() :
             verts(nullptr),
             uvs(nullptr),
             tris(nullptr),
             numVerts(0),
-            numTris(0)
+            numTris(0),
+            quad(false)
         {
         }
     };
@@ -85,9 +132,19 @@ namespace tee {
     struct SpriteDrawBatch
     {
         AssetHandle texHandle;
-        uint16_t startIdx;
-        uint16_t numIndices;
+        uint8_t order;
+        uint32_t startVertex;   // Indices of the batch are relative to this vertex
         uint32_t numVerts;
+        uint32_t startIdx;
+        uint32_t numIndices;
+    };
+
+    struct SpriteInstanceBatch
+    {
+        AssetHandle texHandle;
+        uint32_t startInstance;
+        uint32_t numInstances;
+        bool mirrored;          // Flipped in one direction, triangles have reversed winding
     };
 
     struct SortedSprite
@@ -97,6 +154,28 @@ namespace tee {
         uint64_t key;
     };
 
+    // Place of each sorted sprite's geometry in the whole vertex/index data of the draw
+    struct SpriteGeometryRange
+    {
+        uint32_t firstVertex;
+        uint32_t firstIndex;
+        uint32_t baseVertex;    // First vertex of the sprite's batch, indices are relative to it
+    };
+
+    // Input/Output of sprite geometry fill, can be shared between multiple jobs
+    struct SpriteFillContext
+    {
+        const SortedSprite* sortedSprites;
+        const mat3_t* mats;
+        const ucolor_t* colors;
+        const SpriteGeometryRange* ranges;
+        uint32_t vertexBase;        // Vertex and index of the ranges that map to the start of verts/indices
+        uint32_t indexBase;
+        SpriteVertex* verts;
+        void* indices;
+        bool index32;
+    };
+
     struct SpriteFrame
     {
 #ifdef _DEBUG
@@ -132,13 +211,43 @@ namespace tee {
         }
     };
 
+    // Spatial partition of SpriteCache, each tile has it's own gpu buffers and is culled separately
+    struct SpriteCacheTile
+    {
+        rect_t bounds;
+
+        VertexBufferHandle vb;              // Static caches
+        IndexBufferHandle ib;
+        DynamicVertexBufferHandle dynVb;    // Dynamic caches
+        DynamicIndexBufferHandle dynIb;
+
+        uint32_t firstVertex;   // Tile's data in SpriteCache backup buffers
+        uint32_t numVerts;
+        uint32_t ibOffset;      // bytes
+        uint32_t ibSize;        // bytes
+        bool index32;
+
+        int firstBatch;
+        int numBatches;
+    };
+
+    // Geometry of the sprites in dynamic caches, so they can be updated later
+    struct SpriteCacheItem
+    {
+        Sprite* sprite;
+        int tile;               // -1 if the sprite was not valid when the cache was created
+        AssetHandle texHandle;
+        SpriteGeometryRange range;  // Relative to the tile
+        uint32_t numVerts;
+        uint32_t numIndices;
+    };
+
     struct SpriteCache
     {
         typedef bx::List<SpriteCache*>::Node LNode;
 
         bx::AllocatorI* alloc;
-        VertexBufferHandle vb;
-        IndexBufferHandle ib;
+        bool dynamic;
 
         // backup buffers to restore the gpu buffers
         void* verts;
@@ -146,21 +255,34 @@ namespace tee {
         void* indices;
         int ibSize;     // bytes
 
-        SpriteDrawBatch* batches;       // Draw batches 
+        SpriteDrawBatch* batches;       // Draw batches of all tiles
+        int* batchTiles;
         int numBatches;
 
+        SpriteCacheTile* tiles;
+        int numTiles;
+
+        SpriteCacheItem* items;         // Dynamic caches only, same order as the sprites that the cache is created with
+        int numItems;
+
         rect_t bounds;
 
         LNode lnode;
 
         SpriteCache(bx::AllocatorI* _alloc) :
             alloc(_alloc),
+            dynamic(false),
             verts(nullptr),
             vbSize(0),
             indices(nullptr),
             ibSize(0),
             batches(nullptr),
+            batchTiles(nullptr),
             numBatches(0),
+            tiles(nullptr),
+            numTiles(0),
+            items(nullptr),
+            numItems(0),
             lnode(this)
         {
         }
@@ -260,6 +382,9 @@ namespace tee {
         GfxDriver* driver;
         bx::AllocatorI* alloc;
         ProgramHandle spriteProg;
+        ProgramHandle spriteInstProg;       // Invalid if instancing is not supported
+        VertexBufferHandle quadVb;
+        IndexBufferHandle quadIb;
         UniformHandle u_texture;
         SpriteSheetLoader loader;
         SpriteSheet* failSheet;
@@ -267,13 +392,29 @@ namespace tee {
         bx::List<Sprite*> spriteList;       // keep a list of sprites for proper shutdown and sheet reloading
         bx::List<SpriteCache*> spriteCacheList;
         SpriteRenderMode::Enum renderMode;
+        bool instancing;
+
+        // Used when the transient buffers of a frame run out, sprites of the frame are appended after each other
+        DynamicVertexBufferHandle overflowVb;
+        DynamicIndexBufferHandle overflowIb;
+        uint32_t overflowMaxVerts;
+        uint32_t overflowMaxIndices;
+        uint32_t overflowNumVerts;
+        uint32_t overflowNumIndices;
+        uint64_t overflowFrame;
 
         SpriteMgr(bx::AllocatorI* _alloc) : 
             driver(nullptr),
             alloc(_alloc),
             failSheet(nullptr),
             asyncSheet(nullptr),
-            renderMode(SpriteRenderMode::Normal)
+            renderMode(SpriteRenderMode::Normal),
+            instancing(false),
+            overflowMaxVerts(0),
+            overflowMaxIndices(0),
+            overflowNumVerts(0),
+            overflowNumIndices(0),
+            overflowFrame(UINT64_MAX)
         {
         }
     };
@@ -345,47 +486,49 @@ namespace tee {
         }
     }
 
-    bool SpriteSheetLoader::loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, 
-                                    bx::AllocatorI* alloc)
+    // Parses the sheet without loading the texture, so it can run in a job (heap memory only)
+    // Texture file path is returned in 'texFilepath' and should be loaded with loadSpriteSheetTexture
+    static SpriteSheet* decodeSpriteSheet(const MemoryBlock* mem, const AssetParams& params, bx::AllocatorI* alloc,
+                                          bx::Path* texFilepath)
     {
-
-        const LoadSpriteSheetParams* ssParams = (const LoadSpriteSheetParams*)params.userParams;
-
-        bx::AllocatorI* tmpAlloc = getTempAlloc();
-        char* jsonStr = (char*)BX_ALLOC(tmpAlloc, mem->size + 1);
+        bx::AllocatorI* heapAlloc = getHeapAlloc();
+        char* jsonStr = (char*)BX_ALLOC(heapAlloc, mem->size + 1);
         if (!jsonStr) {
             TEE_ERROR("Out of Memory");
-            return false;
+            return nullptr;
         }
         memcpy(jsonStr, mem->data, mem->size);
         jsonStr[mem->size] = 0;
 
-        json::StackAllocator jalloc(tmpAlloc);
-        json::StackPoolAllocator jpool(4096, &jalloc);
-        json::StackDocument jdoc(&jpool, 1024, &jalloc);
+        json::HeapAllocator jalloc;
+        json::HeapPoolAllocator jpool(4096, &jalloc);
+        json::HeapDocument jdoc(&jpool, 1024, &jalloc);
 
         if (jdoc.ParseInsitu(jsonStr).HasParseError()) {
             TEE_ERROR("Parse Json Error: %s (Pos: %d)", GetParseError_En(jdoc.GetParseError()), jdoc.GetErrorOffset());                 
-            return false;
+            BX_FREE(heapAlloc, jsonStr);
+            return nullptr;
         }
-        BX_FREE(tmpAlloc, jsonStr);
 
         if (!jdoc.HasMember("frames") || !jdoc.HasMember("meta")) {
             TEE_ERROR("SpriteSheet Json is Invalid");
-            return false;
+            BX_FREE(heapAlloc, jsonStr);
+            return nullptr;
         }
-        const json::svalue_t& jframes = jdoc["frames"];
-        const json::svalue_t& jmeta = jdoc["meta"];
+        const json::hvalue_t& jframes = jdoc["frames"];
+        const json::hvalue_t& jmeta = jdoc["meta"];
 
         BX_ASSERT(jframes.IsArray());
         int numFrames = jframes.Size();
-        if (numFrames == 0)
-            return false;
+        if (numFrames == 0) {
+            BX_FREE(heapAlloc, jsonStr);
+            return nullptr;
+        }
 
         // evaluate total vertices, triangles and uvs
         int numTotalVerts = 0, numTotalTris = 0, numTotalUvs = 0;
         for (int i = 0; i < numFrames; i++) {
-            const json::svalue_t& jframe = jframes[i];
+            const json::hvalue_t& jframe = jframes[i];
             if (jframe.HasMember("vertices")) {
                 numTotalVerts += jframe["vertices"].Size();
                 if (jframe.HasMember("verticesUV"))
@@ -405,8 +548,10 @@ namespace tee {
             numTotalVerts*sizeof(vec2_t) + numTotalTris*sizeof(uint16_t)*3 + numTotalUvs*sizeof(vec2_t) + 
             numFrames*sizeof(SpriteMesh) + bx::LinearAllocator::getExtraAllocSize(totalAllocs);
         uint8_t* buff = (uint8_t*)BX_ALLOC(alloc ? alloc : gSpriteMgr->alloc, totalSz);
-        if (!buff)
-            return false;
+        if (!buff) {
+            BX_FREE(heapAlloc, jsonStr);
+            return nullptr;
+        }
         bx::LinearAllocator lalloc(buff, totalSz);
         SpriteSheet* ss = BX_NEW(&lalloc, SpriteSheet);
         ss->buff = buff;
@@ -418,30 +563,23 @@ namespace tee {
             ss->scale = bx::toFloat(jmeta["scale"].GetString());
 
         // image width/height
-        const json::svalue_t& jsize = jmeta["size"];
+        const json::hvalue_t& jsize = jmeta["size"];
         float imgWidth = float(jsize["w"].GetInt());
         float imgHeight = float(jsize["h"].GetInt());
 
-        // Make texture path and load it
+        // Make texture path
         const char* imageFile = jmeta["image"].GetString();
-        bx::Path texFilepath = bx::Path(params.uri).getDirectory();
-        texFilepath.joinUnix(imageFile);
-
-        LoadTextureParams texParams;
-        texParams.flags = ssParams->flags;
-        texParams.generateMips = ssParams->generateMips;
-        texParams.skipMips = ssParams->skipMips;
-        texParams.fmt = ssParams->fmt;
-        ss->texHandle = asset::load("texture", texFilepath.cstr(), &texParams, params.flags, alloc ? alloc : nullptr);
+        *texFilepath = bx::Path(params.uri).getDirectory();
+        texFilepath->joinUnix(imageFile);
 
         for (int i = 0; i < numFrames; i++) {
             SpriteSheetFrame& frame = ss->frames[i];
-            const json::svalue_t& jframe = jframes[i];
+            const json::hvalue_t& jframe = jframes[i];
             const char* filename = jframe["filename"].GetString();
             frame.filenameHash = tinystl::hash_string(filename, strlen(filename));
             bool rotated = jframe["rotated"].GetBool();
 
-            const json::svalue_t& jframeFrame = jframe["frame"];
+            const json::hvalue_t& jframeFrame = jframe["frame"];
             float frameWidth = float(jframeFrame["w"].GetInt());
             float frameHeight = float(jframeFrame["h"].GetInt());
             if (rotated)
@@ -452,13 +590,13 @@ namespace tee {
                                   frameWidth / imgWidth,
                                   frameHeight / imgHeight);
 
-            const json::svalue_t& jsourceSize = jframe["sourceSize"];
+            const json::hvalue_t& jsourceSize = jframe["sourceSize"];
             frame.sourceSize = vec2(float(jsourceSize["w"].GetInt()),
                                      float(jsourceSize["h"].GetInt()));
 
             // Normalize pos/size offsets (0~1)
             // Rotate offset can only be 90 degrees
-            const json::svalue_t& jssFrame = jframe["spriteSourceSize"];
+            const json::hvalue_t& jssFrame = jframe["spriteSourceSize"];
             float srcx = float(jssFrame["x"].GetInt());
             float srcy = float(jssFrame["y"].GetInt());
             float srcw = float(jssFrame["w"].GetInt());
@@ -474,9 +612,9 @@ namespace tee {
             }
             frame.pixelRatio = frame.sourceSize.x / frame.sourceSize.y;
 
-            const json::svalue_t& jpivot = jframe["pivot"];
-            const json::svalue_t& jpivotX = jpivot["x"];
-            const json::svalue_t& jpivotY = jpivot["y"];
+            const json::hvalue_t& jpivot = jframe["pivot"];
+            const json::hvalue_t& jpivotX = jpivot["x"];
+            const json::hvalue_t& jpivotY = jpivot["y"];
             float pivotx = jpivotX.IsFloat() ?  jpivotX.GetFloat() : float(jpivotX.GetInt());
             float pivoty = jpivotY.IsFloat() ?  jpivotY.GetFloat() : float(jpivotY.GetInt());
             frame.pivot = vec2(pivotx - 0.5f, -pivoty + 0.5f);     // convert to our coordinates
@@ -488,7 +626,7 @@ namespace tee {
             // Mesh
             if (jframe.HasMember("vertices")) {
                 SpriteMesh& mesh = ss->meshes[i];
-                const json::svalue_t& jverts = jframe["vertices"];
+                const json::hvalue_t& jverts = jframe["vertices"];
                 mesh.verts = loadSpriteVerts(jverts, &mesh.numVerts, &lalloc);
             
                 // Convert vertices to normalized (-0.5~0.5) of the sprite frame
@@ -512,6 +650,7 @@ namespace tee {
                     mesh.tris = loadSpriteTris(jframe["triangles"], &mesh.numTris, &lalloc);
 
                 reorderSpriteMeshTriangles(&mesh);
+                mesh.quad = false;
             } else {
                 rect_t texcoords = frame.frame;
                 vec2_t topLeft = vec2(srcx/frame.sourceSize.x - 0.5f,
@@ -539,13 +678,89 @@ namespace tee {
 
                 mesh.tris[0] = 0;       mesh.tris[1] = 1;       mesh.tris[2] = 2;
                 mesh.tris[3] = 2;       mesh.tris[4] = 1;       mesh.tris[5] = 3;
+
+                mesh.quad = true;
+                mesh.quadRect = rect(topLeft, rightBottom);
+                mesh.quadCoords = texcoords;
             }
         }
 
+        BX_FREE(heapAlloc, jsonStr);
+        return ss;
+    }
+
+    static void loadSpriteSheetTexture(SpriteSheet* ss, const char* texFilepath, const AssetParams& params, 
+                                       bx::AllocatorI* alloc)
+    {
+        const LoadSpriteSheetParams* ssParams = (const LoadSpriteSheetParams*)params.userParams;
+
+        LoadTextureParams texParams;
+        texParams.flags = ssParams->flags;
+        texParams.generateMips = ssParams->generateMips;
+        texParams.skipMips = ssParams->skipMips;
+        texParams.fmt = ssParams->fmt;
+        ss->texHandle = asset::load("texture", texFilepath, &texParams, params.flags, alloc ? alloc : nullptr);
+    }
+
+    bool SpriteSheetLoader::loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, 
+                                    bx::AllocatorI* alloc)
+    {
+        bx::Path texFilepath;
+        SpriteSheet* ss = decodeSpriteSheet(mem, params, alloc, &texFilepath);
+        if (!ss)
+            return false;
+        loadSpriteSheetTexture(ss, texFilepath.cstr(), params, alloc);
+
+        *obj = uintptr_t(ss);
+        return true;
+    }
+
+    struct DecodedSpriteSheet
+    {
+        SpriteSheet* ss;
+        bx::Path texFilepath;
+    };
+
+    bool SpriteSheetLoader::canDecode(const AssetParams& params, bx::AllocatorI* alloc)
+    {
+        // Sheet memory is allocated in the job, custom allocators may not be thread-safe
+        return alloc == nullptr;
+    }
+
+    bool SpriteSheetLoader::decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded, 
+                                      bx::AllocatorI* alloc)
+    {
+        DecodedSpriteSheet* dss = BX_NEW(getHeapAlloc(), DecodedSpriteSheet);
+        if (!dss)
+            return false;
+        dss->ss = decodeSpriteSheet(mem, params, alloc, &dss->texFilepath);
+        if (!dss->ss) {
+            BX_DELETE(getHeapAlloc(), dss);
+            return false;
+        }
+        *decoded = uintptr_t(dss);
+        return true;
+    }
+
+    bool SpriteSheetLoader::finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj, 
+                                        bx::AllocatorI* alloc)
+    {
+        DecodedSpriteSheet* dss = (DecodedSpriteSheet*)decoded;
+        SpriteSheet* ss = dss->ss;
+        loadSpriteSheetTexture(ss, dss->texFilepath.cstr(), params, alloc);
+        BX_DELETE(getHeapAlloc(), dss);
+
         *obj = uintptr_t(ss);
         return true;
     }
 
+    void SpriteSheetLoader::releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc)
+    {
+        DecodedSpriteSheet* dss = (DecodedSpriteSheet*)decoded;
+        BX_FREE(alloc ? alloc : gSpriteMgr->alloc, dss->ss->buff);
+        BX_DELETE(getHeapAlloc(), dss);
+    }
+
     void SpriteSheetLoader::unloadObj(uintptr_t obj, bx::AllocatorI* alloc)
     {
         BX_ASSERT(gSpriteMgr);
@@ -659,10 +874,78 @@ namespace tee {
         ss->meshes[0].tris = tris;
         ss->meshes[0].verts = verts;
         ss->meshes[0].uvs = uvs;
+        ss->meshes[0].quad = true;
+        ss->meshes[0].quadRect = rect(-0.5f, 0.5f, 0.5f, -0.5f);
+        ss->meshes[0].quadCoords = rect(0, 0, 1.0f, 1.0f);
 
         return ss;
     }
 
+    static void createInstancingResources(GfxDriver* driver)
+    {
+        if (!(driver->getCaps().supported & GpuCapsFlag::Instancing))
+            return;
+
+        static const SpriteQuadVertex quadVerts[] = {
+            {vec2(0, 0)},
+            {vec2(1.0f, 0)},
+            {vec2(0, 1.0f)},
+            {vec2(1.0f, 1.0f)}
+        };
+        static const uint16_t quadIndices[] = {
+            0, 1, 2,
+            2, 1, 3
+        };
+
+        gSpriteMgr->spriteInstProg =
+            driver->createProgram(driver->createShader(driver->makeRef(sprite_inst_vso, sizeof(sprite_inst_vso), nullptr, nullptr)),
+                                  driver->createShader(driver->makeRef(sprite_fso, sizeof(sprite_fso), nullptr, nullptr)),
+                                  true);
+        gSpriteMgr->quadVb = driver->createVertexBuffer(driver->makeRef(quadVerts, sizeof(quadVerts), nullptr, nullptr),
+                                                        SpriteQuadVertex::Decl, GfxBufferFlag::None);
+        gSpriteMgr->quadIb = driver->createIndexBuffer(driver->makeRef(quadIndices, sizeof(quadIndices), nullptr, nullptr),
+                                                       GfxBufferFlag::None);
+    }
+
+    // Creates gpu buffers of all cache tiles from the backup buffers
+    static void createCacheBuffers(GfxDriver* driver, SpriteCache* sc)
+    {
+        for (int i = 0; i < sc->numTiles; i++) {
+            SpriteCacheTile& tile = sc->tiles[i];
+            const GfxMemory* vmem = driver->makeRef((SpriteVertex*)sc->verts + tile.firstVertex,
+                                                    sizeof(SpriteVertex)*tile.numVerts, nullptr, nullptr);
+            const GfxMemory* imem = driver->makeRef((uint8_t*)sc->indices + tile.ibOffset, tile.ibSize, nullptr, nullptr);
+            GfxBufferFlag::Bits ibFlags = tile.index32 ? GfxBufferFlag::Index32 : GfxBufferFlag::None;
+
+            if (sc->dynamic) {
+                tile.dynVb = driver->createDynamicVertexBufferMem(vmem, SpriteVertex::Decl, GfxBufferFlag::None);
+                tile.dynIb = driver->createDynamicIndexBufferMem(imem, ibFlags);
+            } else {
+                tile.vb = driver->createVertexBuffer(vmem, SpriteVertex::Decl, GfxBufferFlag::None);
+                tile.ib = driver->createIndexBuffer(imem, ibFlags);
+            }
+        }
+    }
+
+    static void destroyCacheBuffers(GfxDriver* driver, SpriteCache* sc)
+    {
+        for (int i = 0; i < sc->numTiles; i++) {
+            SpriteCacheTile& tile = sc->tiles[i];
+            if (tile.vb.isValid())
+                driver->destroyVertexBuffer(tile.vb);
+            if (tile.ib.isValid())
+                driver->destroyIndexBuffer(tile.ib);
+            if (tile.dynVb.isValid())
+                driver->destroyDynamicVertexBuffer(tile.dynVb);
+            if (tile.dynIb.isValid())
+                driver->destroyDynamicIndexBuffer(tile.dynIb);
+            tile.vb = VertexBufferHandle();
+            tile.ib = IndexBufferHandle();
+            tile.dynVb = DynamicVertexBufferHandle();
+            tile.dynIb = DynamicIndexBufferHandle();
+        }
+    }
+
     bool gfx::initSpriteSystem(GfxDriver* driver, bx::AllocatorI* alloc)
     {
         if (gSpriteMgr) {
@@ -678,6 +961,7 @@ namespace tee {
         gSpriteMgr->driver = driver;
 
         SpriteVertex::init();
+        SpriteQuadVertex::init();
 
         gSpriteMgr->spriteProg = 
             driver->createProgram(driver->createShader(driver->makeRef(sprite_vso, sizeof(sprite_vso), nullptr, nullptr)),
@@ -687,6 +971,7 @@ namespace tee {
             return false;
 
         gSpriteMgr->u_texture = driver->createUniform("u_texture", UniformType::Int1, 1);
+        createInstancingResources(driver);
 
         // Create fail spritesheet
         gSpriteMgr->failSheet = createDummySpriteSheet(asset::getFailHandle("texture"), gSpriteMgr->alloc);    
@@ -772,6 +1057,7 @@ namespace tee {
             return false;
 
         gSpriteMgr->u_texture = driver->createUniform("u_texture", UniformType::Int1, 1);
+        createInstancingResources(driver);
 
         // Recreate all sprite cache buffers
         SpriteCache::LNode* node = gSpriteMgr->spriteCacheList.getFirst();
@@ -780,8 +1066,7 @@ namespace tee {
 
             BX_ASSERT(sc->verts);
             BX_ASSERT(sc->indices);
-            sc->vb = driver->createVertexBuffer(driver->makeRef(sc->verts, sc->vbSize, nullptr, nullptr), SpriteVertex::Decl, 0);
-            sc->ib = driver->createIndexBuffer(driver->makeRef(sc->indices, sc->ibSize, nullptr, nullptr), 0);
+            createCacheBuffers(driver, sc);
 
             node = node->next;
         }
@@ -797,17 +1082,29 @@ namespace tee {
             driver->destroyProgram(gSpriteMgr->spriteProg);
         if (gSpriteMgr->u_texture.isValid())
             driver->destroyUniform(gSpriteMgr->u_texture);
+        if (gSpriteMgr->spriteInstProg.isValid())
+            driver->destroyProgram(gSpriteMgr->spriteInstProg);
+        if (gSpriteMgr->quadVb.isValid())
+            driver->destroyVertexBuffer(gSpriteMgr->quadVb);
+        if (gSpriteMgr->quadIb.isValid())
+            driver->destroyIndexBuffer(gSpriteMgr->quadIb);
+        gSpriteMgr->spriteInstProg = ProgramHandle();
+        gSpriteMgr->quadVb = VertexBufferHandle();
+        gSpriteMgr->quadIb = IndexBufferHandle();
+
+        if (gSpriteMgr->overflowVb.isValid())
+            driver->destroyDynamicVertexBuffer(gSpriteMgr->overflowVb);
+        if (gSpriteMgr->overflowIb.isValid())
+            driver->destroyDynamicIndexBuffer(gSpriteMgr->overflowIb);
+        gSpriteMgr->overflowVb = DynamicVertexBufferHandle();
+        gSpriteMgr->overflowIb = DynamicIndexBufferHandle();
+        gSpriteMgr->overflowMaxVerts = gSpriteMgr->overflowMaxIndices = 0;
+        gSpriteMgr->overflowNumVerts = gSpriteMgr->overflowNumIndices = 0;
 
         // Destroy all sprite cache buffers
         SpriteCache::LNode* node = gSpriteMgr->spriteCacheList.getFirst();
         while (node) {
-            SpriteCache* sc = node->data;
-            if (sc->vb.isValid())
-                driver->destroyVertexBuffer(sc->vb);
-            if (sc->ib.isValid())
-                driver->destroyIndexBuffer(sc->ib);
-            sc->vb = VertexBufferHandle();
-            sc->ib = IndexBufferHandle();
+            destroyCacheBuffers(driver, node->data);
             node = node->next;
         }
     }
@@ -822,6 +1119,16 @@ namespace tee {
         return gSpriteMgr->renderMode;
     }
 
+    void sprite::setInstancing(bool enable)
+    {
+        gSpriteMgr->instancing = enable;
+    }
+
+    bool sprite::isInstancingEnabled()
+    {
+        return gSpriteMgr->instancing && gSpriteMgr->spriteInstProg.isValid();
+    }
+
     void sprite::addFrame(Sprite* sprite,
                           AssetHandle texHandle, SpriteFlag::Bits flags, const vec2_t pivot /*= vec2_t(0, 0)*/, 
                           const vec2_t topLeftCoords /*= vec2_t(0, 0)*/, const vec2_t bottomRightCoords /*= vec2_t(1.0f, 1.0f)*/, 
@@ -1316,7 +1623,7 @@ namespace tee {
         TransientVertexBuffer tvb;
         TransientIndexBuffer tib;
 
-        if (!gDriver->allocTransientBuffers(&tvb, SpriteVertex::Decl, numVerts, &tib, numIndices))
+        if (!gDriver->allocTransientBuffers32(&tvb, SpriteVertex::Decl, numVerts, &tib, numIndices))
             return;
         SpriteVertex* verts = (SpriteVertex*)tvb.data;
         uint16_t* indices = (uint16_t*)tib.data;
@@ -1397,8 +1704,10 @@ namespace tee {
             if (batchKey != prevKey) {
                 curBatch = batches.push();
                 curBatch->texHandle = frame.texHandle;
+                curBatch->order = sprite->order;
                 curBatch->numVerts = 0;
                 curBatch->numIndices = 0;
+                curBatch->startVertex = 0;
                 curBatch->startIdx = indexIdx;
                 prevKey = batchKey;
             }
@@ -1494,225 +1803,362 @@ namespace tee {
     }
 
 
-    void sprite::draw(uint8_t viewId, Sprite** sprites, uint16_t numSprites, const mat3_t* mats,
-                      ProgramHandle progOverride /*= ProgramHandle()*/, sprite::StateCallback stateCallback /*= nullptr*/,
-                      void* stateUserData, const ucolor_t* colors)
+    // Sort sprites by order->texture->id, so they can be batched
+    static SortedSprite* sortSprites(Sprite** sprites, int numSprites, bx::AllocatorI* alloc)
     {
-    #if termite_DEV
-        if (gSpriteMgr->renderMode == SpriteRenderMode::Wireframe)
-            return drawSpritesWireframe(viewId, sprites, numSprites, mats);
-    #endif
+        SortedSprite* sortedSprites = (SortedSprite*)BX_ALLOC(alloc, sizeof(SortedSprite)*numSprites);
+        uint64_t* keys = (uint64_t*)BX_ALLOC(alloc, sizeof(uint64_t)*numSprites*2);
+        uint32_t* indices = (uint32_t*)BX_ALLOC(alloc, sizeof(uint32_t)*numSprites*2);
+        if (!sortedSprites || !keys || !indices)
+            return nullptr;
 
-        // Filter out invalid sprites
-        for (int si = 0; si < numSprites; si++) {
-            if (sprites[si]->curFrameIdx < sprites[si]->frames.getCount())
-                continue;
-            bx::xchg(sprites[si], sprites[numSprites-1]);
-            --numSprites;
+        for (int i = 0; i < numSprites; i++) {
+            const SpriteFrame& frame = sprites[i]->getCurFrame();
+            keys[i] = MAKE_SPRITE_KEY(sprites[i]->order, frame.texHandle.value, sprites[i]->id);
+            indices[i] = uint32_t(i);
         }
 
-        if (numSprites <= 0)
-            return;
-        BX_ASSERT(sprites);
-
-        GfxDriver* gDriver = gSpriteMgr->driver;
+        // LSD radix sort, returns early if keys are already sorted (sprites are usually submitted in the same order)
+        if (numSprites > 1)
+            bx::radixSort(keys, keys + numSprites, indices, indices + numSprites, uint32_t(numSprites));
 
-        // Evaluate final vertices and indexes
-        int numVerts = 0, numIndices = 0;
-        for (int si = 0; si < numSprites; si++) {
-            Sprite* sprite = sprites[si];
-            const SpriteFrame& frame = sprite->frames[sprite->curFrameIdx];
+        for (int i = 0; i < numSprites; i++) {
+            int index = int(indices[i]);
+            sortedSprites[i].index = index;
+            sortedSprites[i].sprite = sprites[index];
+            sortedSprites[i].key = keys[i];
+        }
+        return sortedSprites;
+    }
 
-            if (frame.ssHandle.isValid()) {
-                BX_ASSERT(frame.meshId != -1);
-                SpriteSheet* sheet = asset::getObjPtr<SpriteSheet>(frame.ssHandle);
-                const SpriteMesh& mesh = sheet->meshes[frame.meshId];
-                numVerts += mesh.numVerts;
-                numIndices += mesh.numTris*3;
-            } else {
-                numVerts += 4;
-                numIndices += 6;
-            }
+    // Scale and offset of the sprite's normalized geometry, flipping is applied as negative scale
+    static SpriteFlag::Bits calcSpriteScale(const Sprite* sprite, const SpriteFrame& frame, vec2_t* pScale, vec2_t* pPos)
+    {
+        vec2_t halfSize = sprite->halfSize;
+        float pixelRatio = frame.pixelRatio;
+        SpriteFlag::Bits flip = sprite->flip | frame.flags;
+        float scalex, scaley;
+        if (halfSize.y <= 0) {
+            scalex = halfSize.x*2.0f;
+            scaley = scalex / pixelRatio;
+        } else if (halfSize.x <= 0) {
+            scaley = halfSize.y*2.0f;
+            scalex = scaley*pixelRatio;
+        } else {
+            scalex = halfSize.x*2.0f;
+            scaley = halfSize.y*2.0f;
         }
 
-        TransientVertexBuffer tvb;
-        TransientIndexBuffer tib;
+        vec2_t scale = vec2(scalex, scaley) * sprite->scale;
+        if (flip & SpriteFlip::FlipX)
+            scale.x = -scale.x;
+        if (flip & SpriteFlip::FlipY)
+            scale.y = -scale.y;
 
-        if (!gDriver->allocTransientBuffers(&tvb, SpriteVertex::Decl, numVerts, &tib, numIndices))
-            return;
-        SpriteVertex* verts = (SpriteVertex*)tvb.data;
-        uint16_t* indices = (uint16_t*)tib.data;
-        bx::AllocatorI* tmpAlloc = getTempAlloc();
+        *pScale = scale;
+        *pPos = sprite->posOffset - frame.pivot;
+        return flip;
+    }
 
-        // Sort sprites by order->texture->id and batch them
-        SortedSprite* sortedSprites = (SortedSprite*)BX_ALLOC(tmpAlloc, sizeof(SortedSprite)*numSprites);
+    // Final transform of the sprite's normalized geometry: offset/pivot/size/flip x sprite's own matrix
+    static void calcSpriteTransform(const Sprite* sprite, const SpriteFrame& frame, const mat3_t& mat, mat3_t* finalMat)
+    {
+        vec2_t scale, pos;
+        calcSpriteScale(sprite, frame, &scale, &pos);
 
-        for (int i = 0; i < numSprites; i++) {
-            const SpriteFrame& frame = sprites[i]->getCurFrame();
-            sortedSprites[i].index = i;
-            sortedSprites[i].sprite = sprites[i];
-            sortedSprites[i].key = MAKE_SPRITE_KEY(sprites[i]->order, frame.texHandle.value, sprites[i]->id);
-        }
+        // PreMat = TranslateMat * ScaleMat
+        mat3_t preMat;
+        preMat.m11 = scale.x;       preMat.m12 = 0;             preMat.m13 = 0;
+        preMat.m21 = 0;             preMat.m22 = scale.y;       preMat.m23 = 0;
+        preMat.m31 = scale.x*pos.x; preMat.m32 = scale.y*pos.y; preMat.m33 = 1.0f;
+        bx::mat3Mul(finalMat->f, preMat.f, mat.f);
+    }
 
-        if (numSprites > 1) {
-            std::sort(sortedSprites, sortedSprites + numSprites, [](const SortedSprite& a, const SortedSprite&b)->bool {
-                return a.key < b.key;
-            });
+    static inline bool isQuadSprite(const SpriteFrame& frame)
+    {
+        return !frame.ssHandle.isValid() || asset::getObjPtr<SpriteSheet>(frame.ssHandle)->meshes[frame.meshId].quad;
+    }
+
+    static BX_FORCE_INLINE void storeSimd(void* dest, bx::simd128_t a)
+    {
+        // Vertex buffers are not guaranteed to be 16 bytes aligned, compilers turn this into an unaligned store
+        memcpy(dest, &a, sizeof(a));
+    }
+
+    static BX_FORCE_INLINE void writeSpriteIndices(const SpriteFillContext& ctx, uint32_t first, const uint32_t* values, 
+                                                   int num)
+    {
+        if (ctx.index32) {
+            memcpy((uint32_t*)ctx.indices + first, values, sizeof(uint32_t)*num);
+        } else {
+            uint16_t* indices = (uint16_t*)ctx.indices + first;
+            for (int i = 0; i < num; i++)
+                indices[i] = uint16_t(values[i]);
         }
+    }
 
-        // Fill draw data (geometry)
-        mat3_t preMat, finalMat;
-        int indexIdx = 0;
-        int vertexIdx = 0;
+    // Transforms and writes quad sprites [first, first + count), four at a time (count <= 4)
+    // Sprites are transposed to SoA, so the transform is calculated once for all four
+    static void fillSpriteQuads(const SpriteFillContext& ctx, int first, int count)
+    {
+        using namespace bx;
+        BX_STATIC_ASSERT(sizeof(SpriteVertex) == 48);
+        BX_ASSERT(count > 0 && count <= 4);
 
-        // Batching
-        bx::Array<SpriteDrawBatch> batches;
-        batches.create(32, 64, tmpAlloc);
-        uint32_t prevKey = UINT32_MAX;
-        SpriteDrawBatch* curBatch = nullptr;
+        // Normalized quad of texture sprites: (pos, coords)
+        static const float kDefaultQuad[4][4] = {
+            {-0.5f,  0.5f, 0,    0},
+            { 0.5f,  0.5f, 1.0f, 0},
+            {-0.5f, -0.5f, 0,    1.0f},
+            { 0.5f, -0.5f, 1.0f, 1.0f}
+        };
 
-        for (int si = 0; si < numSprites; si++) {
-            const SortedSprite ss = sortedSprites[si];
-            Sprite* sprite = sprites[ss.index];
-            const SpriteFrame& frame = sprite->frames[sprite->curFrameIdx];
+        float sx[4], sy[4], tx[4], ty[4];
+        float m11[4], m12[4], m21[4], m22[4], m31[4], m32[4];
+        SpriteFlag::Bits flips[4];
+        for (int l = 0; l < 4; l++) {
+            // Unused lanes repeat the last sprite
+            const SortedSprite& ss = ctx.sortedSprites[first + bx::min(l, count - 1)];
+            const SpriteFrame& frame = ss.sprite->getCurFrame();
+            const mat3_t& mat = ctx.mats[ss.index];
+            vec2_t scale, pos;
+            flips[l] = calcSpriteScale(ss.sprite, frame, &scale, &pos);
+            sx[l] = scale.x;        sy[l] = scale.y;
+            tx[l] = scale.x*pos.x;  ty[l] = scale.y*pos.y;
+            m11[l] = mat.m11;   m12[l] = mat.m12;
+            m21[l] = mat.m21;   m22[l] = mat.m22;
+            m31[l] = mat.m31;   m32[l] = mat.m32;
+        }
 
-            vec2_t halfSize = sprite->halfSize;
-            float pixelRatio = frame.pixelRatio;
-            SpriteFlag::Bits flipX = sprite->flip | frame.flags;
-            SpriteFlag::Bits flipY = sprite->flip | frame.flags;
-            float scalex, scaley;
-            if (halfSize.y <= 0) {
-                scalex = halfSize.x*2.0f;
-                scaley = scalex / pixelRatio;
-            } else if (halfSize.x <= 0) {
-                scaley = halfSize.y*2.0f;
-                scalex = scaley*pixelRatio;
+        // FinalMat = PreMat * Mat, PreMat only has scale and translation, so only the 2D affine part is needed
+        simd128_t vsx = simd_ld<simd128_t>(sx[0], sx[1], sx[2], sx[3]);
+        simd128_t vsy = simd_ld<simd128_t>(sy[0], sy[1], sy[2], sy[3]);
+        simd128_t vtx = simd_ld<simd128_t>(tx[0], tx[1], tx[2], tx[3]);
+        simd128_t vty = simd_ld<simd128_t>(ty[0], ty[1], ty[2], ty[3]);
+        simd128_t v11 = simd_ld<simd128_t>(m11[0], m11[1], m11[2], m11[3]);
+        simd128_t v12 = simd_ld<simd128_t>(m12[0], m12[1], m12[2], m12[3]);
+        simd128_t v21 = simd_ld<simd128_t>(m21[0], m21[1], m21[2], m21[3]);
+        simd128_t v22 = simd_ld<simd128_t>(m22[0], m22[1], m22[2], m22[3]);
+        simd128_t v31 = simd_ld<simd128_t>(m31[0], m31[1], m31[2], m31[3]);
+        simd128_t v32 = simd_ld<simd128_t>(m32[0], m32[1], m32[2], m32[3]);
+
+        simd128_t a = simd_mul(vsx, v11);
+        simd128_t b = simd_mul(vsx, v12);
+        simd128_t c = simd_mul(vsy, v21);
+        simd128_t d = simd_mul(vsy, v22);
+        simd128_t e = simd_madd(vtx, v11, simd_madd(vty, v21, v31));
+        simd128_t f = simd_madd(vtx, v12, simd_madd(vty, v22, v32));
+
+        // Transpose back to AoS: transform1 = (m11, m12, m21, m22), transform2.zw = (m31, m32)
+        simd128_t ab01 = simd_shuf_xAyB(a, b);
+        simd128_t ab23 = simd_shuf_zCwD(a, b);
+        simd128_t cd01 = simd_shuf_xAyB(c, d);
+        simd128_t cd23 = simd_shuf_zCwD(c, d);
+        simd128_t ef01 = simd_shuf_xAyB(e, f);
+        simd128_t ef23 = simd_shuf_zCwD(e, f);
+        simd128_t transform1[4] = {
+            simd_shuf_xyAB(ab01, cd01),
+            simd_shuf_zwCD(ab01, cd01),
+            simd_shuf_xyAB(ab23, cd23),
+            simd_shuf_zwCD(ab23, cd23)
+        };
+        simd128_t transform2[4] = {
+            simd_swiz_xyxy(ef01),
+            ef01,
+            simd_swiz_xyxy(ef23),
+            ef23
+        };
+
+        for (int l = 0; l < count; l++) {
+            int si = first + l;
+            const SortedSprite& ss = ctx.sortedSprites[si];
+            const SpriteFrame& frame = ss.sprite->getCurFrame();
+            const SpriteMesh* mesh = frame.ssHandle.isValid() ? 
+                &asset::getObjPtr<SpriteSheet>(frame.ssHandle)->meshes[frame.meshId] : nullptr;
+
+            uint32_t color = !ctx.colors ? ss.sprite->color.n : ctx.colors[ss.index].n;
+            ucolor_t colorAdd = ss.sprite->colorAdd;
+            colorAdd.a = (flips[l] & SpriteFlip::FlipX) ? 0 : 255;
+
+            // Each vertex is written with three 16 byte stores: 
+            // (pos, m11, m12), (m21, m22, m31, m32), (coords, color, colorAdd)
+            simd128_t mid = simd_shuf_zwCD(transform1[l], transform2[l]);
+            simd128_t vcolor = simd_ild<simd128_t>(0, 0, color, colorAdd.n);
+            const SpriteGeometryRange& range = ctx.ranges[si];
+            uint8_t* dest = (uint8_t*)(ctx.verts + (range.firstVertex - ctx.vertexBase));
+            for (int i = 0; i < 4; i++) {
+                simd128_t posCoords = mesh ? 
+                    simd_ld<simd128_t>(mesh->verts[i].x, mesh->verts[i].y, mesh->uvs[i].x, mesh->uvs[i].y) :
+                    simd_ld<simd128_t>(kDefaultQuad[i][0], kDefaultQuad[i][1], kDefaultQuad[i][2], kDefaultQuad[i][3]);
+                storeSimd(dest, simd_shuf_xyAB(posCoords, transform1[l]));
+                storeSimd(dest + 16, mid);
+                storeSimd(dest + 32, simd_shuf_zwCD(posCoords, vcolor));
+                dest += sizeof(SpriteVertex);
+            }
+
+            // Flipping in one direction reverses the triangles' winding
+            uint32_t indices[6];
+            uint32_t idx = range.firstVertex - range.baseVertex;
+            if (((flips[l] & SpriteFlip::FlipX) != 0) == ((flips[l] & SpriteFlip::FlipY) != 0)) {
+                indices[0] = idx;       indices[1] = idx + 1;   indices[2] = idx + 2;
+                indices[3] = idx + 2;   indices[4] = idx + 1;   indices[5] = idx + 3;
             } else {
-                scalex = halfSize.x*2.0f;
-                scaley = halfSize.y*2.0f;
+                indices[0] = idx + 2;   indices[1] = idx + 1;   indices[2] = idx;
+                indices[3] = idx + 3;   indices[4] = idx + 1;   indices[5] = idx + 2;
             }
+            writeSpriteIndices(ctx, range.firstIndex - ctx.indexBase, indices, 6);
+        }
+    }
 
-            vec2_t pos = sprite->posOffset - frame.pivot;
-            vec2_t scale = vec2(scalex, scaley) * sprite->scale;
-            ucolor_t _colorAdd = sprite->colorAdd;
-            _colorAdd.a = 255;
+    static void fillSpriteMesh(const SpriteFillContext& ctx, int si)
+    {
+        const SortedSprite& ss = ctx.sortedSprites[si];
+        const SpriteFrame& frame = ss.sprite->getCurFrame();
+        BX_ASSERT(frame.meshId != -1);
+        const SpriteMesh& mesh = asset::getObjPtr<SpriteSheet>(frame.ssHandle)->meshes[frame.meshId];
+
+        mat3_t finalMat;
+        calcSpriteTransform(ss.sprite, frame, ctx.mats[ss.index], &finalMat);
+        SpriteFlag::Bits flip = ss.sprite->flip | frame.flags;
+
+        vec3_t transform1 = vec3(finalMat.m11, finalMat.m12, finalMat.m21);
+        vec3_t transform2 = vec3(finalMat.m22, finalMat.m31, finalMat.m32);
+        uint32_t color = !ctx.colors ? ss.sprite->color.n : ctx.colors[ss.index].n;
+        ucolor_t colorAdd = ss.sprite->colorAdd;
+        colorAdd.a = (flip & SpriteFlip::FlipX) ? 0 : 255;
+
+        const SpriteGeometryRange& range = ctx.ranges[si];
+        SpriteVertex* verts = ctx.verts + (range.firstVertex - ctx.vertexBase);
+        for (int i = 0, c = mesh.numVerts; i < c; i++) {
+            verts[i].pos = mesh.verts[i];
+            verts[i].transform1 = transform1;
+            verts[i].transform2 = transform2;
+            verts[i].coords = vec2(mesh.uvs[i].x, mesh.uvs[i].y);
+            verts[i].color = color;
+            verts[i].colorAdd = colorAdd.n;
+        }
 
-            bool reorder = false;
-            if (flipX & SpriteFlip::FlipX) {
-                scale.x = -scale.x;
-                reorder = !reorder;
-                _colorAdd.a = 0;
-            }
-            if (flipY & SpriteFlip::FlipY) {
-                scale.y = -scale.y;
-                reorder = !reorder;
-            }
-
-            // Transform (offset x sprite's own matrix)
-            // PreMat = TranslateMat * ScaleMat
-            preMat.m11 = scale.x;       preMat.m12 = 0;             preMat.m13 = 0;
-            preMat.m21 = 0;             preMat.m22 = scale.y;       preMat.m23 = 0;
-            preMat.m31 = scale.x*pos.x; preMat.m32 = scale.y*pos.y; preMat.m33 = 1.0f;
-            bx::mat3Mul(finalMat.f, preMat.f, mats[ss.index].f);
+        // Flipping in one direction reverses the triangles' winding
+        bool reorder = ((flip & SpriteFlip::FlipX) != 0) != ((flip & SpriteFlip::FlipY) != 0);
+        uint32_t idx = range.firstVertex - range.baseVertex;
+        uint32_t firstIndex = range.firstIndex - ctx.indexBase;
+        for (int i = 0, c = mesh.numTris*3; i < c; i += 3) {
+            uint32_t tri[3] = {mesh.tris[i] + idx, mesh.tris[i + 1] + idx, mesh.tris[i + 2] + idx};
+            if (reorder)
+                bx::xchg(tri[0], tri[2]);
+            writeSpriteIndices(ctx, firstIndex + i, tri, 3);
+        }
+    }
 
-            vec3_t transform1 = vec3(finalMat.m11, finalMat.m12, finalMat.m21);
-            vec3_t transform2 = vec3(finalMat.m22, finalMat.m31, finalMat.m32);
-            uint32_t color;
-            if (!colors)    color = ss.sprite->color.n;
-            else            color = colors[ss.index].n;
-            uint32_t colorAdd = _colorAdd.n;
+    static void fillSpriteGeometryRange(const SpriteFillContext& ctx, int first, int last)
+    {
+        int si = first;
+        while (si < last) {
+            // Gather up to four consecutive quads for the SIMD path
+            int count = 0;
+            while (count < 4 && si + count < last && isQuadSprite(ctx.sortedSprites[si + count].sprite->getCurFrame()))
+                count++;
 
-            // Batch
-            uint32_t batchKey = SPRITE_KEY_GET_BATCH(ss.key);
-            if (batchKey != prevKey) {
-                curBatch = batches.push();
-                curBatch->texHandle = frame.texHandle;
-                curBatch->numVerts = 0;
-                curBatch->numIndices = 0;
-                curBatch->startIdx = indexIdx;
-                prevKey = batchKey;
+            if (count > 0) {
+                fillSpriteQuads(ctx, si, count);
+                si += count;
+            } else {
+                fillSpriteMesh(ctx, si);
+                si++;
             }
-        
-            int startIdx = indexIdx;
-            // Fill geometry data
-            if (frame.ssHandle.isValid()) {
-                SpriteSheet* sheet = asset::getObjPtr<SpriteSheet>(frame.ssHandle);
-                BX_ASSERT(frame.meshId != -1);
-                const SpriteMesh& mesh = sheet->meshes[frame.meshId];
-
-                for (int i = 0, c = mesh.numVerts; i < c; i++) {
-                    int k = i + vertexIdx;
-                    verts[k].pos = mesh.verts[i];
-                    verts[k].transform1 = transform1;
-                    verts[k].transform2 = transform2;
-                    verts[k].coords = vec2(mesh.uvs[i].x, mesh.uvs[i].y);
-                    verts[k].color = color;
-                    verts[k].colorAdd = colorAdd;
-                }
+        }
+    }
 
-                for (int i = 0, c = mesh.numTris; i < c; i++) {
-                    int k = i*3;
-                    indices[k + indexIdx] = mesh.tris[k] + vertexIdx;
-                    indices[k + indexIdx + 1] = mesh.tris[k + 1] + vertexIdx;
-                    indices[k + indexIdx + 2] = mesh.tris[k + 2] + vertexIdx;
-                }
+    // Calculates place of sorted sprites' geometry, 'ranges' should have an extra item for the totals
+    static void calcSpriteGeometryRanges(const SortedSprite* sortedSprites, int numSprites, SpriteGeometryRange* ranges)
+    {
+        uint32_t vertexIdx = 0;
+        uint32_t indexIdx = 0;
+        for (int si = 0; si < numSprites; si++) {
+            const SpriteFrame& frame = sortedSprites[si].sprite->getCurFrame();
+            ranges[si].firstVertex = vertexIdx;
+            ranges[si].firstIndex = indexIdx;
+            ranges[si].baseVertex = 0;
 
-                int numIndices = mesh.numTris*3;
-                indexIdx += numIndices;
+            if (frame.ssHandle.isValid()) {
+                BX_ASSERT(frame.meshId != -1);
+                const SpriteMesh& mesh = asset::getObjPtr<SpriteSheet>(frame.ssHandle)->meshes[frame.meshId];
                 vertexIdx += mesh.numVerts;
-                curBatch->numVerts += mesh.numVerts;
-                curBatch->numIndices += uint16_t(numIndices);
+                indexIdx += mesh.numTris*3;
             } else {
-                // Make a normalized quad
-                SpriteVertex& v0 = verts[vertexIdx];
-                SpriteVertex& v1 = verts[vertexIdx + 1];
-                SpriteVertex& v2 = verts[vertexIdx + 2];
-                SpriteVertex& v3 = verts[vertexIdx + 3];
-                v0.pos = vec2(-0.5f, 0.5f);
-                v0.coords = vec2(0, 0);
-
-                v1.pos = vec2(0.5f, 0.5f);
-                v1.coords = vec2(1.0f, 0);
-
-                v2.pos = vec2(-0.5f, -0.5f);
-                v2.coords = vec2(0, 1.0f);
-
-                v3.pos = vec2(0.5f, -0.5f);
-                v3.coords = vec2(1.0f, 1.0f);
-
-                v0.transform1 = v1.transform1 = v2.transform1 = v3.transform1 = transform1;
-                v0.transform2 = v1.transform2 = v2.transform2 = v3.transform2 = transform2;
-                v0.color = v1.color = v2.color = v3.color = color;
-                v0.colorAdd = v1.colorAdd = v2.colorAdd = v3.colorAdd = colorAdd;
-
-                indices[indexIdx] = vertexIdx;
-                indices[indexIdx + 1] = vertexIdx + 1;
-                indices[indexIdx + 2] = vertexIdx + 2;
-                indices[indexIdx + 3] = vertexIdx + 2;
-                indices[indexIdx + 4] = vertexIdx + 1;
-                indices[indexIdx + 5] = vertexIdx + 3;
-
                 vertexIdx += 4;
                 indexIdx += 6;
-                curBatch->numVerts += 4;
-                curBatch->numIndices += 6;
             }
+        }
+        ranges[numSprites].firstVertex = vertexIdx;
+        ranges[numSprites].firstIndex = indexIdx;
+        ranges[numSprites].baseVertex = 0;
+    }
 
-            if (reorder) {
-                for (int i = startIdx; i < indexIdx; i+=3) {
-                    bx::xchg(indices[i], indices[i + 2]);
-                }
+    // Makes draw batches (order->texture) of sorted sprites [first, last), a new batch is also started if the current
+    // one references more than 'maxBatchVerts'. Batch vertices/indices are relative to the 'first' sprite
+    static void batchSprites(const SortedSprite* sortedSprites, SpriteGeometryRange* ranges, int first, int last,
+                             uint32_t maxBatchVerts, bx::Array<SpriteDrawBatch>* batches)
+    {
+        uint32_t vertexBase = ranges[first].firstVertex;
+        uint32_t indexBase = ranges[first].firstIndex;
+        uint32_t prevKey = UINT32_MAX;
+        SpriteDrawBatch* curBatch = nullptr;
+
+        for (int si = first; si < last; si++) {
+            const SortedSprite& ss = sortedSprites[si];
+            SpriteGeometryRange& range = ranges[si];
+            uint32_t numVerts = ranges[si + 1].firstVertex - range.firstVertex;
+            uint32_t numIndices = ranges[si + 1].firstIndex - range.firstIndex;
+
+            uint32_t batchKey = SPRITE_KEY_GET_BATCH(ss.key);
+            if (batchKey != prevKey || curBatch->numVerts + numVerts > maxBatchVerts) {
+                curBatch = batches->push();
+                curBatch->texHandle = ss.sprite->getCurFrame().texHandle;
+                curBatch->order = ss.sprite->order;
+                curBatch->startVertex = range.firstVertex - vertexBase;
+                curBatch->numVerts = 0;
+                curBatch->startIdx = range.firstIndex - indexBase;
+                curBatch->numIndices = 0;
+                prevKey = batchKey;
             }
+
+            range.baseVertex = vertexBase + curBatch->startVertex;
+            curBatch->numVerts += numVerts;
+            curBatch->numIndices += numIndices;
         }
+    }
 
-        // Draw
+    // Fills vertices and indices of sorted sprites [first, last), big sprite sets are split between jobs
+    static void fillSpriteGeometry(const SpriteFillContext& ctx, int first, int last)
+    {
+        if (last - first >= kSpriteFillChunkSize*2) {
+            parallelFor(first, last, kSpriteFillChunkSize, [&ctx](int chunkFirst, int chunkLast) {
+                fillSpriteGeometryRange(ctx, chunkFirst, chunkLast);
+            }, JobPriority::High);
+        } else {
+            fillSpriteGeometryRange(ctx, first, last);
+        }
+    }
+
+    static void submitSpriteBatches(uint8_t viewId, const bx::Array<SpriteDrawBatch>& batches, ProgramHandle prog,
+                                    const TransientVertexBuffer* tvb, const TransientIndexBuffer* tib,
+                                    DynamicVertexBufferHandle vb, DynamicIndexBufferHandle ib,
+                                    uint32_t vbOffset, uint32_t ibOffset,
+                                    sprite::StateCallback stateCallback, void* stateUserData)
+    {
+        GfxDriver* gDriver = gSpriteMgr->driver;
         GfxState::Bits state = gfx::stateBlendAlpha() | GfxState::RGBWrite | GfxState::AlphaWrite | GfxState::CullCCW;
-        ProgramHandle prog = !progOverride.isValid() ? gSpriteMgr->spriteProg : progOverride;
         for (int i = 0, c = batches.getCount(); i < c; i++) {
             const SpriteDrawBatch batch = batches[i];
             gDriver->setState(state, 0);
-            gDriver->setTransientVertexBufferI(0, &tvb, 0, batch.numVerts);
-            gDriver->setTransientIndexBufferI(&tib, batch.startIdx, batch.numIndices);
+            if (tvb) {
+                gDriver->setTransientVertexBufferI(0, tvb, batch.startVertex, batch.numVerts);
+                gDriver->setTransientIndexBufferI(tib, batch.startIdx, batch.numIndices);
+            } else {
+                gDriver->setDynamicVertexBuffer(0, vb, vbOffset + batch.startVertex, batch.numVerts);
+                gDriver->setDynamicIndexBuffer(ib, ibOffset + batch.startIdx, batch.numIndices);
+            }
 
             bool textureOverride = false;
             if (stateCallback) {
@@ -1722,13 +2168,209 @@ namespace tee {
                 gDriver->setTexture(0, gSpriteMgr->u_texture, asset::getObjPtr<Texture>(batch.texHandle)->handle, TextureFlag::FromTexture);
             gDriver->submit(viewId, prog, 0, false);
         }
+    }
+
+    // Draws sorted sprites [first, last) from the overflow dynamic buffers, used when the transient buffers of the frame
+    // run out. Each call of the frame writes after the previous one, so buffers are only grown when a frame needs more
+    static void drawSpritesOverflow(uint8_t viewId, SpriteFillContext ctx, SpriteGeometryRange* ranges, int first, int last,
+                                    ProgramHandle prog, sprite::StateCallback stateCallback, void* stateUserData)
+    {
+        GfxDriver* gDriver = gSpriteMgr->driver;
+        uint32_t numVerts = ranges[last].firstVertex - ranges[first].firstVertex;
+        uint32_t numIndices = ranges[last].firstIndex - ranges[first].firstIndex;
+
+        uint64_t frame = getFrameIndex();
+        if (gSpriteMgr->overflowFrame != frame) {
+            gSpriteMgr->overflowFrame = frame;
+            gSpriteMgr->overflowNumVerts = 0;
+            gSpriteMgr->overflowNumIndices = 0;
+        }
+
+        // Grow by recreating the buffers, the driver keeps the old ones until the frame is rendered
+        if (gSpriteMgr->overflowNumVerts + numVerts > gSpriteMgr->overflowMaxVerts ||
+            gSpriteMgr->overflowNumIndices + numIndices > gSpriteMgr->overflowMaxIndices)
+        {
+            if (gSpriteMgr->overflowVb.isValid())
+                gDriver->destroyDynamicVertexBuffer(gSpriteMgr->overflowVb);
+            if (gSpriteMgr->overflowIb.isValid())
+                gDriver->destroyDynamicIndexBuffer(gSpriteMgr->overflowIb);
+
+            uint32_t maxVerts = bx::uint32_max(gSpriteMgr->overflowMaxVerts*2, numVerts);
+            uint32_t maxIndices = bx::uint32_max(gSpriteMgr->overflowMaxIndices*2, numIndices);
+            gSpriteMgr->overflowVb = gDriver->createDynamicVertexBuffer(maxVerts, SpriteVertex::Decl, GfxBufferFlag::None);
+            gSpriteMgr->overflowIb = gDriver->createDynamicIndexBuffer(maxIndices, GfxBufferFlag::None);
+            gSpriteMgr->overflowMaxVerts = maxVerts;
+            gSpriteMgr->overflowMaxIndices = maxIndices;
+            gSpriteMgr->overflowNumVerts = 0;
+            gSpriteMgr->overflowNumIndices = 0;
+            if (!gSpriteMgr->overflowVb.isValid() || !gSpriteMgr->overflowIb.isValid()) {
+                TEE_ERROR("Creating sprite overflow buffers failed (%u vertices)", maxVerts);
+                gSpriteMgr->overflowMaxVerts = gSpriteMgr->overflowMaxIndices = 0;
+                return;
+            }
+        }
+
+        uint32_t vbOffset = gSpriteMgr->overflowNumVerts;
+        uint32_t ibOffset = gSpriteMgr->overflowNumIndices;
+        gSpriteMgr->overflowNumVerts += numVerts;
+        gSpriteMgr->overflowNumIndices += numIndices;
+
+        // Indices are 16bit and relative to the start of their batch, so batches are split every 64k vertices
+        const GfxMemory* vmem = gDriver->alloc(sizeof(SpriteVertex)*numVerts);
+        const GfxMemory* imem = gDriver->alloc(sizeof(uint16_t)*numIndices);
+
+        bx::Array<SpriteDrawBatch> batches;
+        batches.create(32, 64, getTempAlloc());
+        batchSprites(ctx.sortedSprites, ranges, first, last, kSpriteMaxBatchVerts16, &batches);
+
+        ctx.vertexBase = ranges[first].firstVertex;
+        ctx.indexBase = ranges[first].firstIndex;
+        ctx.verts = (SpriteVertex*)vmem->data;
+        ctx.indices = imem->data;
+        ctx.index32 = false;
+        fillSpriteGeometry(ctx, first, last);
+
+        gDriver->updateDynamicVertexBuffer(gSpriteMgr->overflowVb, vbOffset, vmem);
+        gDriver->updateDynamicIndexBuffer(gSpriteMgr->overflowIb, ibOffset, imem);
+        submitSpriteBatches(viewId, batches, prog, nullptr, nullptr, gSpriteMgr->overflowVb, gSpriteMgr->overflowIb,
+                            vbOffset, ibOffset, stateCallback, stateUserData);
 
         batches.destroy();
     }
 
-    SpriteCache* sprite::createCache(bx::AllocatorI* alloc, Sprite** sprites, uint16_t numSprites, const mat3_t* mats,
-                                     const ucolor_t* colors /*= nullptr*/)
+    static void writeSpriteInstance(const SortedSprite& ss, const mat3_t* mats, const ucolor_t* colors,
+                                    SpriteInstanceData* inst)
+    {
+        const Sprite* sprite = ss.sprite;
+        const SpriteFrame& frame = sprite->getCurFrame();
+
+        rect_t quadRect = rect(-0.5f, 0.5f, 0.5f, -0.5f);
+        rect_t quadCoords = rect(0, 0, 1.0f, 1.0f);
+        if (frame.ssHandle.isValid()) {
+            const SpriteMesh& mesh = asset::getObjPtr<SpriteSheet>(frame.ssHandle)->meshes[frame.meshId];
+            quadRect = mesh.quadRect;
+            quadCoords = mesh.quadCoords;
+        }
+
+        // Pre-multiply the quad rect, so unit quad (0~1) is transformed directly: QuadMat * FinalMat
+        mat3_t finalMat;
+        calcSpriteTransform(sprite, frame, mats[ss.index], &finalMat);
+        float w = quadRect.xmax - quadRect.xmin;
+        float h = quadRect.ymax - quadRect.ymin;
+        inst->transform1 = vec4(w*finalMat.m11, w*finalMat.m12, h*finalMat.m21, h*finalMat.m22);
+
+        ucolor_t color = colors ? colors[ss.index] : sprite->color;
+        ucolor_t colorAdd = sprite->colorAdd;
+        inst->transform2 = vec4(quadRect.xmin*finalMat.m11 + quadRect.ymin*finalMat.m21 + finalMat.m31,
+                                quadRect.xmin*finalMat.m12 + quadRect.ymin*finalMat.m22 + finalMat.m32,
+                                float(color.r) + float(color.g)*256.0f,
+                                float(color.b) + float(color.a)*256.0f);
+        inst->coords = quadCoords;
+        inst->colorAdd = vec4(float(colorAdd.r) + float(colorAdd.g)*256.0f, float(colorAdd.b), 0, 0);
+    }
+
+    static inline bool isSpriteMirrored(const SortedSprite& ss)
+    {
+        SpriteFlag::Bits flip = ss.sprite->flip | ss.sprite->getCurFrame().flags;
+        return ((flip & SpriteFlip::FlipX) != 0) != ((flip & SpriteFlip::FlipY) != 0);
+    }
+
+    // Quad sprites with the default program are drawn with the shared unit quad and instance buffers (sprite::setInstancing)
+    // Sorted sprites are drawn in as many instance buffers as the frame has left
+    // Returns the number of sorted sprites that are drawn, the rest should be drawn with the vertex buffer path
+    static int drawSpritesInstanced(uint8_t viewId, const SortedSprite* sortedSprites, int numSprites, const mat3_t* mats,
+                                    sprite::StateCallback stateCallback, void* stateUserData, const ucolor_t* colors)
+    {
+        for (int si = 0; si < numSprites; si++) {
+            if (!isQuadSprite(sortedSprites[si].sprite->getCurFrame()))
+                return 0;
+        }
+
+        GfxDriver* gDriver = gSpriteMgr->driver;
+        const uint16_t stride = sizeof(SpriteInstanceData);
+        bx::Array<SpriteInstanceBatch> batches;
+        batches.create(32, 64, getTempAlloc());
+
+        // Flipping in one direction reverses the winding of the unit quad, vertex path reverses the indices instead
+        // So mirrored instances go to their own batches, which cull the opposite side
+        GfxState::Bits state = gfx::stateBlendAlpha() | GfxState::RGBWrite | GfxState::AlphaWrite;
+        int first = 0;
+        while (first < numSprites) {
+            uint32_t count = gDriver->getAvailInstanceDataBuffer(uint32_t(numSprites - first), stride);
+            if (count == 0)
+                break;
+            int last = first + int(count);
+
+            InstanceDataBuffer idb;
+            gDriver->allocInstanceDataBuffer(&idb, count, stride);
+            SpriteInstanceData* instances = (SpriteInstanceData*)idb.data;
+
+            // Every run of the same batch key is written in two parts: normal sprites, then the mirrored ones
+            batches.clear();
+            uint32_t instIdx = 0;
+            int runStart = first;
+            while (runStart < last) {
+                uint32_t batchKey = SPRITE_KEY_GET_BATCH(sortedSprites[runStart].key);
+                int runEnd = runStart + 1;
+                for (; runEnd < last; runEnd++) {
+                    uint32_t key = SPRITE_KEY_GET_BATCH(sortedSprites[runEnd].key);
+                    if (key != batchKey)
+                        break;
+                }
+
+                for (int m = 0; m < 2; m++) {
+                    bool mirrored = m == 1;
+                    SpriteInstanceBatch* batch = nullptr;
+                    for (int si = runStart; si < runEnd; si++) {
+                        const SortedSprite& ss = sortedSprites[si];
+                        if (isSpriteMirrored(ss) != mirrored)
+                            continue;
+                        if (!batch) {
+                            batch = batches.push();
+                            batch->texHandle = ss.sprite->getCurFrame().texHandle;
+                            batch->startInstance = instIdx;
+                            batch->numInstances = 0;
+                            batch->mirrored = mirrored;
+                        }
+                        writeSpriteInstance(ss, mats, colors, &instances[instIdx++]);
+                        ++batch->numInstances;
+                    }
+                }
+                runStart = runEnd;
+            }
+
+            // Draw
+            for (int i = 0, c = batches.getCount(); i < c; i++) {
+                const SpriteInstanceBatch batch = batches[i];
+                gDriver->setState(state | (batch.mirrored ? GfxState::CullCW : GfxState::CullCCW), 0);
+                gDriver->setVertexBuffer(0, gSpriteMgr->quadVb);
+                gDriver->setIndexBuffer(gSpriteMgr->quadIb, 0, 6);
+                gDriver->setInstanceDataBuffer(&idb, batch.startInstance, batch.numInstances);
+
+                bool textureOverride = false;
+                if (stateCallback) {
+                    stateCallback(gDriver, stateUserData, &textureOverride);
+                }
+                if (batch.texHandle.isValid() & !textureOverride)
+                    gDriver->setTexture(0, gSpriteMgr->u_texture, asset::getObjPtr<Texture>(batch.texHandle)->handle, TextureFlag::FromTexture);
+                gDriver->submit(viewId, gSpriteMgr->spriteInstProg, 0, false);
+            }
+            first = last;
+        }
+
+        batches.destroy();
+        return first;
+    }
+
+    void sprite::draw(uint8_t viewId, Sprite** sprites, uint16_t numSprites, const mat3_t* mats,
+                      ProgramHandle progOverride /*= ProgramHandle()*/, sprite::StateCallback stateCallback /*= nullptr*/,
+                      void* stateUserData, const ucolor_t* colors)
     {
+    #if termite_DEV
+        if (gSpriteMgr->renderMode == SpriteRenderMode::Wireframe)
+            return drawSpritesWireframe(viewId, sprites, numSprites, mats);
+    #endif
+
         // Filter out invalid sprites
         for (int si = 0; si < numSprites; si++) {
             if (sprites[si]->curFrameIdx < sprites[si]->frames.getCount())
@@ -1738,208 +2380,262 @@ namespace tee {
         }
 
         if (numSprites <= 0)
-            return nullptr;
+            return;
         BX_ASSERT(sprites);
 
-        // Evaluate final vertices and indexes
-        int numVerts = 0, numIndices = 0;
-        for (int si = 0; si < numSprites; si++) {
-            Sprite* sprite = sprites[si];
-            const SpriteFrame& frame = sprite->frames[sprite->curFrameIdx];
-
-            if (frame.ssHandle.isValid()) {
-                BX_ASSERT(frame.meshId != -1);
-                SpriteSheet* sheet = asset::getObjPtr<SpriteSheet>(frame.ssHandle);
-                const SpriteMesh& mesh = sheet->meshes[frame.meshId];
-                numVerts += mesh.numVerts;
-                numIndices += mesh.numTris*3;
-            } else {
-                numVerts += 4;
-                numIndices += 6;
-            }
-        }
-
-        // Create vertex and index buffers
-        SpriteCache* sc = BX_NEW(alloc, SpriteCache)(alloc);
-        sc->vbSize = sizeof(SpriteVertex)*numVerts;
-        sc->verts = BX_ALLOC(alloc, sc->vbSize);
-        sc->ibSize = sizeof(uint16_t)*numIndices;
-        sc->indices = BX_ALLOC(alloc, sc->ibSize);
-
-        SpriteVertex* verts = (SpriteVertex*)sc->verts;
-        uint16_t* indices = (uint16_t*)sc->indices;
-
+        GfxDriver* gDriver = gSpriteMgr->driver;
         bx::AllocatorI* tmpAlloc = getTempAlloc();
 
-        // Calculate bounds
-        sc->bounds = rect_t::Null;
-        for (int i = 0; i < numSprites; i++) {
-            rect_t spriteBounds = getDrawRect(sprites[i]);
-            vec2_t bounds[4] = {spriteBounds.vmin,
-                vec2(spriteBounds.xmax, spriteBounds.ymin),
-                vec2(spriteBounds.xmin, spriteBounds.ymax),
-                spriteBounds.vmax};
-            for (int k = 0; k < 4; k++) {
-                vec2_t tpt;
-                bx::vec2MulMat3(tpt.f, bounds[k].f, mats[i].f);
-                tmath::rectPushPoint(&sc->bounds, tpt);
-            }
-        }
-
-        // Sort sprites by order->texture->id and batch them
-        SortedSprite* sortedSprites = (SortedSprite*)BX_ALLOC(tmpAlloc, sizeof(SortedSprite)*numSprites);
+        // Sort sprites by order->texture->id
+        SortedSprite* sortedSprites = sortSprites(sprites, numSprites, tmpAlloc);
+        if (!sortedSprites)
+            return;
 
-        for (int i = 0; i < numSprites; i++) {
-            const SpriteFrame& frame = sprites[i]->getCurFrame();
-            sortedSprites[i].index = i;
-            sortedSprites[i].sprite = sprites[i];
-            sortedSprites[i].key = MAKE_SPRITE_KEY(sprites[i]->order, frame.texHandle.value, sprites[i]->id);
+        int first = 0;
+        if (!progOverride.isValid() && sprite::isInstancingEnabled()) {
+            first = drawSpritesInstanced(viewId, sortedSprites, numSprites, mats, stateCallback, stateUserData, colors);
+            if (first == numSprites)
+                return;
         }
 
-        if (numSprites > 1) {
-            std::sort(sortedSprites, sortedSprites + numSprites, [](const SortedSprite& a, const SortedSprite&b)->bool {
-                return a.key < b.key;
-            });
-        }
+        // Evaluate final vertices and indexes of the rest
+        SpriteGeometryRange* ranges = (SpriteGeometryRange*)BX_ALLOC(tmpAlloc, sizeof(SpriteGeometryRange)*(numSprites + 1));
+        if (!ranges)
+            return;
+        calcSpriteGeometryRanges(sortedSprites, numSprites, ranges);
 
-        // Fill draw data (geometry)
-        mat3_t preMat, finalMat;
-        int indexIdx = 0;
-        int vertexIdx = 0;
+        SpriteFillContext ctx;
+        ctx.sortedSprites = sortedSprites;
+        ctx.mats = mats;
+        ctx.colors = colors;
+        ctx.ranges = ranges;
+        ctx.index32 = false;
 
-        // Batching
+        ProgramHandle prog = !progOverride.isValid() ? gSpriteMgr->spriteProg : progOverride;
         bx::Array<SpriteDrawBatch> batches;
         batches.create(32, 64, tmpAlloc);
-        uint32_t prevKey = UINT32_MAX;
-        SpriteDrawBatch* curBatch = nullptr;
 
-        for (int si = 0; si < numSprites; si++) {
-            const SortedSprite ss = sortedSprites[si];
-            Sprite* sprite = sprites[ss.index];
-            const SpriteFrame& frame = sprite->frames[sprite->curFrameIdx];
-
-            vec2_t halfSize = sprite->halfSize;
-            float pixelRatio = frame.pixelRatio;
-            SpriteFlag::Bits flipX = sprite->flip | frame.flags;
-            SpriteFlag::Bits flipY = sprite->flip | frame.flags;
-            float scalex, scaley;
-            if (halfSize.y <= 0) {
-                scalex = halfSize.x*2.0f;
-                scaley = scalex / pixelRatio;
-            } else if (halfSize.x <= 0) {
-                scaley = halfSize.y*2.0f;
-                scalex = scaley*pixelRatio;
-            } else {
-                scalex = halfSize.x*2.0f;
-                scaley = halfSize.y*2.0f;
-            }
-
-            vec2_t pos = sprite->posOffset - frame.pivot;
-            vec2_t scale = vec2(scalex, scaley) * sprite->scale;
-
-            bool reorder = false;
-            if (flipX & SpriteFlip::FlipX) {
-                scale.x = -scale.x;
-                reorder = !reorder;
+        // Transient index buffers are 16bit, so batches are split every 64k vertices
+        // If the sprites don't fit into the remaining transient buffers, they are drawn in multiple allocations
+        while (first < numSprites) {
+            uint32_t availVerts = gDriver->getAvailTransientVertexBuffer(
+                ranges[numSprites].firstVertex - ranges[first].firstVertex, SpriteVertex::Decl);
+            uint32_t availIndices = gDriver->getAvailTransientIndexBuffer(
+                ranges[numSprites].firstIndex - ranges[first].firstIndex);
+
+            int last = first;
+            while (last < numSprites &&
+                   ranges[last + 1].firstVertex - ranges[first].firstVertex <= availVerts &&
+                   ranges[last + 1].firstIndex - ranges[first].firstIndex <= availIndices)
+            {
+                last++;
             }
-            if (flipY & SpriteFlip::FlipY) {
-                scale.y = -scale.y;
-                reorder = !reorder;
+            if (last == first)
+                break;
+
+            TransientVertexBuffer tvb;
+            TransientIndexBuffer tib;
+            if (!gDriver->allocTransientBuffers32(&tvb, SpriteVertex::Decl, ranges[last].firstVertex - ranges[first].firstVertex,
+                                                &tib, ranges[last].firstIndex - ranges[first].firstIndex))
+            {
+                break;
             }
 
-            // Transform (offset x sprite's own matrix)
-            // PreMat = TranslateMat * ScaleMat
-            preMat.m11 = scale.x;       preMat.m12 = 0;             preMat.m13 = 0;
-            preMat.m21 = 0;             preMat.m22 = scale.y;       preMat.m23 = 0;
-            preMat.m31 = scale.x*pos.x; preMat.m32 = scale.y*pos.y; preMat.m33 = 1.0f;
-            bx::mat3Mul(finalMat.f, preMat.f, mats[ss.index].f);
+            batches.clear();
+            batchSprites(sortedSprites, ranges, first, last, kSpriteMaxBatchVerts16, &batches);
 
-            vec3_t transform1 = vec3(finalMat.m11, finalMat.m12, finalMat.m21);
-            vec3_t transform2 = vec3(finalMat.m22, finalMat.m31, finalMat.m32);
-            uint32_t color;
-            if (!colors)    color = ss.sprite->color.n;
-            else            color = colors[ss.index].n;
-            uint32_t colorAdd = ss.sprite->colorAdd.n;
+            // Fill draw data (geometry)
+            ctx.vertexBase = ranges[first].firstVertex;
+            ctx.indexBase = ranges[first].firstIndex;
+            ctx.verts = (SpriteVertex*)tvb.data;
+            ctx.indices = tib.data;
+            fillSpriteGeometry(ctx, first, last);
 
-            // Batch
-            uint32_t batchKey = SPRITE_KEY_GET_BATCH(ss.key);
-            if (batchKey != prevKey) {
-                curBatch = batches.push();
-                curBatch->texHandle = frame.texHandle;
-                curBatch->numVerts = 0;
-                curBatch->numIndices = 0;
-                curBatch->startIdx = indexIdx;
-                prevKey = batchKey;
-            }
+            // Draw
+            submitSpriteBatches(viewId, batches, prog, &tvb, &tib, DynamicVertexBufferHandle(), DynamicIndexBufferHandle(),
+                                0, 0, stateCallback, stateUserData);
+            first = last;
+        }
 
-            // Fill geometry data
-            int startIdx = indexIdx;
-            if (frame.ssHandle.isValid()) {
-                SpriteSheet* sheet = asset::getObjPtr<SpriteSheet>(frame.ssHandle);
-                BX_ASSERT(frame.meshId != -1);
-                const SpriteMesh& mesh = sheet->meshes[frame.meshId];
+        // Transient buffers of this frame are exhausted, draw the rest from the overflow buffers
+        if (first < numSprites)
+            drawSpritesOverflow(viewId, ctx, ranges, first, numSprites, prog, stateCallback, stateUserData);
 
-                for (int i = 0, c = mesh.numVerts; i < c; i++) {
-                    int k = i + vertexIdx;
-                    verts[k].pos = mesh.verts[i];
-                    verts[k].transform1 = transform1;
-                    verts[k].transform2 = transform2;
-                    verts[k].coords = vec2(mesh.uvs[i].x, mesh.uvs[i].y);
-                    verts[k].color = color;
-                    verts[k].colorAdd = colorAdd;
-                }
+        batches.destroy();
+    }
 
-                for (int i = 0, c = mesh.numTris; i < c; i++) {
-                    int k = i*3;
-                    indices[k + indexIdx] = mesh.tris[k] + vertexIdx;
-                    indices[k + indexIdx + 1] = mesh.tris[k + 1] + vertexIdx;
-                    indices[k + indexIdx + 2] = mesh.tris[k + 2] + vertexIdx;
-                }
+    static rect_t calcSpriteWorldRect(Sprite* sprite, const mat3_t& mat)
+    {
+        rect_t spriteBounds = sprite::getDrawRect(sprite);
+        vec2_t bounds[4] = {spriteBounds.vmin,
+            vec2(spriteBounds.xmax, spriteBounds.ymin),
+            vec2(spriteBounds.xmin, spriteBounds.ymax),
+            spriteBounds.vmax};
+        rect_t rc = rect_t::Null;
+        for (int k = 0; k < 4; k++) {
+            vec2_t tpt;
+            bx::vec2MulMat3(tpt.f, bounds[k].f, mat.f);
+            tmath::rectPushPoint(&rc, tpt);
+        }
+        return rc;
+    }
 
-                int numIndices = mesh.numTris*3;
-                indexIdx += numIndices;
-                vertexIdx += mesh.numVerts;
-                curBatch->numVerts += mesh.numVerts;
-                curBatch->numIndices += uint16_t(numIndices);
-            } else {
-                // Make a normalized quad
-                SpriteVertex& v0 = verts[vertexIdx];
-                SpriteVertex& v1 = verts[vertexIdx + 1];
-                SpriteVertex& v2 = verts[vertexIdx + 2];
-                SpriteVertex& v3 = verts[vertexIdx + 3];
-                v0.pos = vec2(-0.5f, 0.5f);
-                v0.coords = vec2(0, 0);
+    static inline uint32_t getCacheTileKey(const rect_t& rc, float tileSize)
+    {
+        if (tileSize <= 0)
+            return 0;
+        float cx = (rc.xmin + rc.xmax)*0.5f/tileSize;
+        float cy = (rc.ymin + rc.ymax)*0.5f/tileSize;
+        int tx = bx::clamp<int>(int(bx::floor(cx)), INT16_MIN, INT16_MAX);
+        int ty = bx::clamp<int>(int(bx::floor(cy)), INT16_MIN, INT16_MAX);
+        return (uint32_t(ty - INT16_MIN) << 16) | uint32_t(tx - INT16_MIN);
+    }
 
-                v1.pos = vec2(0.5f, 0.5f);
-                v1.coords = vec2(1.0f, 0);
+    // Sprites are grouped into tiles by the center of their bounds. Every tile has it's own buffers and batches,
+    // tileSize <= 0 puts all sprites in a single tile
+    static SpriteCache* createCacheTiles(bx::AllocatorI* alloc, Sprite** sprites, uint16_t numSprites, const mat3_t* mats,
+                                         const ucolor_t* colors, float tileSize, bool dynamic)
+    {
+        BX_ASSERT(sprites);
+        bx::AllocatorI* tmpAlloc = getTempAlloc();
+        GfxDriver* gDriver = getGfxDriver();
 
-                v2.pos = vec2(-0.5f, -0.5f);
-                v2.coords = vec2(0, 1.0f);
+        // Skip invalid sprites, group the rest by tile
+        uint32_t* keys = (uint32_t*)BX_ALLOC(tmpAlloc, sizeof(uint32_t)*numSprites*2);
+        uint32_t* indices = (uint32_t*)BX_ALLOC(tmpAlloc, sizeof(uint32_t)*numSprites*2);
+        rect_t* rects = (rect_t*)BX_ALLOC(tmpAlloc, sizeof(rect_t)*numSprites);
+        if (!keys || !indices || !rects)
+            return nullptr;
 
-                v3.pos = vec2(0.5f, -0.5f);
-                v3.coords = vec2(1.0f, 1.0f);
+        int numValid = 0;
+        for (int i = 0; i < numSprites; i++) {
+            if (sprites[i]->curFrameIdx >= sprites[i]->frames.getCount())
+                continue;
+            rects[i] = calcSpriteWorldRect(sprites[i], mats[i]);
+            keys[numValid] = getCacheTileKey(rects[i], tileSize);
+            indices[numValid] = uint32_t(i);
+            numValid++;
+        }
+        if (numValid == 0)
+            return nullptr;
 
-                v0.transform1 = v1.transform1 = v2.transform1 = v3.transform1 = transform1;
-                v0.transform2 = v1.transform2 = v2.transform2 = v3.transform2 = transform2;
-                v0.color = v1.color = v2.color = v3.color = color;
-                v0.colorAdd = v1.colorAdd = v2.colorAdd = v3.colorAdd = colorAdd;
+        if (numValid > 1)
+            bx::radixSort(keys, keys + numValid, indices, indices + numValid, uint32_t(numValid));
+
+        // Sprites, matrices and colors in tile order, so each tile can be sorted and filled separately
+        Sprite** tileSprites = (Sprite**)BX_ALLOC(tmpAlloc, sizeof(Sprite*)*numValid);
+        mat3_t* tileMats = (mat3_t*)BX_ALLOC(tmpAlloc, sizeof(mat3_t)*numValid);
+        ucolor_t* tileColors = colors ? (ucolor_t*)BX_ALLOC(tmpAlloc, sizeof(ucolor_t)*numValid) : nullptr;
+        int* tileStarts = (int*)BX_ALLOC(tmpAlloc, sizeof(int)*(numValid + 1));
+        int numTiles = 0;
+        for (int i = 0; i < numValid; i++) {
+            int index = int(indices[i]);
+            tileSprites[i] = sprites[index];
+            tileMats[i] = mats[index];
+            if (colors)
+                tileColors[i] = colors[index];
+            if (i == 0 || keys[i] != keys[i - 1])
+                tileStarts[numTiles++] = i;
+        }
+        tileStarts[numTiles] = numValid;
 
-                indices[indexIdx] = vertexIdx;
-                indices[indexIdx + 1] = vertexIdx + 1;
-                indices[indexIdx + 2] = vertexIdx + 2;
-                indices[indexIdx + 3] = vertexIdx + 2;
-                indices[indexIdx + 4] = vertexIdx + 1;
-                indices[indexIdx + 5] = vertexIdx + 3;
+        SpriteCache* sc = BX_NEW(alloc, SpriteCache)(alloc);
+        sc->dynamic = dynamic;
+        sc->numTiles = numTiles;
+        sc->tiles = (SpriteCacheTile*)BX_ALLOC(alloc, sizeof(SpriteCacheTile)*numTiles);
+        if (dynamic) {
+            sc->numItems = numSprites;
+            sc->items = (SpriteCacheItem*)BX_ALLOC(alloc, sizeof(SpriteCacheItem)*numSprites);
+            for (int i = 0; i < numSprites; i++) {
+                sc->items[i].sprite = sprites[i];
+                sc->items[i].tile = -1;
+            }
+        }
 
-                vertexIdx += 4;
-                indexIdx += 6;
-                curBatch->numVerts += 4;
-                curBatch->numIndices += 6;
+        // Sort sprites of each tile by order->texture->id and evaluate final vertices and indexes
+        SortedSprite** tileSorted = (SortedSprite**)BX_ALLOC(tmpAlloc, sizeof(SortedSprite*)*numTiles);
+        SpriteGeometryRange** tileRanges = (SpriteGeometryRange**)BX_ALLOC(tmpAlloc, sizeof(SpriteGeometryRange*)*numTiles);
+        uint32_t numVerts = 0;
+        uint32_t ibSize = 0;
+        sc->bounds = rect_t::Null;
+        for (int t = 0; t < numTiles; t++) {
+            int first = tileStarts[t];
+            int count = tileStarts[t + 1] - first;
+            tileSorted[t] = sortSprites(tileSprites + first, count, tmpAlloc);
+            tileRanges[t] = (SpriteGeometryRange*)BX_ALLOC(tmpAlloc, sizeof(SpriteGeometryRange)*(count + 1));
+            BX_ASSERT(tileSorted[t] && tileRanges[t]);
+            calcSpriteGeometryRanges(tileSorted[t], count, tileRanges[t]);
+
+            // Use 32bit indices for big tiles if supported, otherwise batches are split every 64k vertices
+            SpriteCacheTile& tile = sc->tiles[t];
+            bx::memSet(&tile, 0x00, sizeof(tile));
+            tile.vb = VertexBufferHandle();
+            tile.ib = IndexBufferHandle();
+            tile.dynVb = DynamicVertexBufferHandle();
+            tile.dynIb = DynamicIndexBufferHandle();
+            tile.firstVertex = numVerts;
+            tile.numVerts = tileRanges[t][count].firstVertex;
+            tile.index32 = tile.numVerts > kSpriteMaxBatchVerts16 && (gDriver->getCaps().supported & GpuCapsFlag::Index32);
+            tile.ibOffset = ibSize;
+            tile.ibSize = (tile.index32 ? sizeof(uint32_t) : sizeof(uint16_t))*tileRanges[t][count].firstIndex;
+
+            tile.bounds = rect_t::Null;
+            for (int i = first; i < first + count; i++) {
+                const rect_t& rc = rects[indices[i]];
+                tmath::rectPushPoint(&tile.bounds, rc.vmin);
+                tmath::rectPushPoint(&tile.bounds, rc.vmax);
             }
+            tmath::rectPushPoint(&sc->bounds, tile.bounds.vmin);
+            tmath::rectPushPoint(&sc->bounds, tile.bounds.vmax);
+
+            numVerts += tile.numVerts;
+            ibSize += tile.ibSize;
+        }
+
+        // Create backup buffers
+        sc->vbSize = sizeof(SpriteVertex)*numVerts;
+        sc->verts = BX_ALLOC(alloc, sc->vbSize);
+        sc->ibSize = ibSize;
+        sc->indices = BX_ALLOC(alloc, sc->ibSize);
 
-            if (reorder) {
-                for (int i = startIdx; i < indexIdx; i += 3) {
-                    bx::xchg(indices[i], indices[i + 2]);
+        // Batch and fill geometry data of each tile
+        bx::Array<SpriteDrawBatch> batches;
+        batches.create(32, 64, tmpAlloc);
+        bx::Array<int> batchTiles;
+        batchTiles.create(32, 64, tmpAlloc);
+        for (int t = 0; t < numTiles; t++) {
+            SpriteCacheTile& tile = sc->tiles[t];
+            int first = tileStarts[t];
+            int count = tileStarts[t + 1] - first;
+            SortedSprite* sortedSprites = tileSorted[t];
+            SpriteGeometryRange* ranges = tileRanges[t];
+
+            tile.firstBatch = batches.getCount();
+            batchSprites(sortedSprites, ranges, 0, count, tile.index32 ? UINT32_MAX : kSpriteMaxBatchVerts16, &batches);
+            tile.numBatches = batches.getCount() - tile.firstBatch;
+            for (int i = 0; i < tile.numBatches; i++)
+                *batchTiles.push() = t;
+
+            SpriteFillContext ctx;
+            ctx.sortedSprites = sortedSprites;
+            ctx.mats = tileMats + first;
+            ctx.colors = tileColors ? tileColors + first : nullptr;
+            ctx.ranges = ranges;
+            ctx.vertexBase = 0;
+            ctx.indexBase = 0;
+            ctx.verts = (SpriteVertex*)sc->verts + tile.firstVertex;
+            ctx.indices = (uint8_t*)sc->indices + tile.ibOffset;
+            ctx.index32 = tile.index32;
+            fillSpriteGeometry(ctx, 0, count);
+
+            if (dynamic) {
+                for (int si = 0; si < count; si++) {
+                    SpriteCacheItem& item = sc->items[indices[first + sortedSprites[si].index]];
+                    item.tile = t;
+                    item.texHandle = sortedSprites[si].sprite->getCurFrame().texHandle;
+                    item.range = ranges[si];
+                    item.numVerts = ranges[si + 1].firstVertex - ranges[si].firstVertex;
+                    item.numIndices = ranges[si + 1].firstIndex - ranges[si].firstIndex;
                 }
             }
         }
@@ -1947,13 +2643,14 @@ namespace tee {
         // save batches
         sc->numBatches = batches.getCount();
         sc->batches = (SpriteDrawBatch*)BX_ALLOC(alloc, sizeof(SpriteDrawBatch)*sc->numBatches);
+        sc->batchTiles = (int*)BX_ALLOC(alloc, sizeof(int)*sc->numBatches);
         bx::memCopy(sc->batches, batches.getBuffer(), batches.getCount()*sizeof(SpriteDrawBatch));
+        bx::memCopy(sc->batchTiles, batchTiles.getBuffer(), batchTiles.getCount()*sizeof(int));
         batches.destroy();
+        batchTiles.destroy();
 
         // Create buffers
-        GfxDriver* gDriver = getGfxDriver();
-        sc->vb = gDriver->createVertexBuffer(gDriver->makeRef(sc->verts, sc->vbSize, nullptr, nullptr), SpriteVertex::Decl, 0);
-        sc->ib = gDriver->createIndexBuffer(gDriver->makeRef(sc->indices, sc->ibSize, nullptr, nullptr), 0);
+        createCacheBuffers(gDriver, sc);
 
         // Add to SpriteCache list for graphics restore
         gSpriteMgr->spriteCacheList.add(&sc->lnode);
@@ -1961,36 +2658,149 @@ namespace tee {
         return sc;
     }
 
-    void sprite::drawCache(uint8_t viewId, SpriteCache* spriteCache,
-                           ProgramHandle progOverride /*= ProgramHandle()*/, 
-                           sprite::StateCallback stateCallback /*= nullptr*/, void* stateUserData /*= nullptr*/)
+    SpriteCache* sprite::createCache(bx::AllocatorI* alloc, Sprite** sprites, uint16_t numSprites, const mat3_t* mats,
+                                     const ucolor_t* colors /*= nullptr*/)
+    {
+        if (numSprites == 0)
+            return nullptr;
+        return createCacheTiles(alloc, sprites, numSprites, mats, colors, 0, false);
+    }
+
+    SpriteCache* sprite::createDynamicCache(bx::AllocatorI* alloc, Sprite** sprites, uint16_t numSprites, const mat3_t* mats,
+                                            float tileSize, const ucolor_t* colors /*= nullptr*/)
+    {
+        if (numSprites == 0)
+            return nullptr;
+        return createCacheTiles(alloc, sprites, numSprites, mats, colors, tileSize, true);
+    }
+
+    bool sprite::updateCache(SpriteCache* spriteCache, int index, const mat3_t& mat, const ucolor_t* color /*= nullptr*/)
     {
-        GfxDriver* gDriver = getGfxDriver();
         SpriteCache* sc = spriteCache;
+        BX_ASSERT(sc->dynamic, "Only dynamic sprite caches can be updated");
+        if (!sc->dynamic || index < 0 || index >= sc->numItems)
+            return false;
+
+        SpriteCacheItem& item = sc->items[index];
+        Sprite* sprite = item.sprite;
+        if (item.tile < 0 || sprite->curFrameIdx >= sprite->frames.getCount())
+            return false;
+
+        // Texture and the size of geometry can't change, because the sprite is already placed in a batch
+        const SpriteFrame& frame = sprite->getCurFrame();
+        SpriteGeometryRange ranges[2];
+        SortedSprite ss;
+        ss.index = 0;
+        ss.sprite = sprite;
+        ss.key = 0;
+        calcSpriteGeometryRanges(&ss, 1, ranges);
+        if (frame.texHandle != item.texHandle || ranges[1].firstVertex != item.numVerts || ranges[1].firstIndex != item.numIndices)
+            return false;
+
+        SpriteCacheTile& tile = sc->tiles[item.tile];
+        uint32_t indexSize = tile.index32 ? sizeof(uint32_t) : sizeof(uint16_t);
+        SpriteVertex* verts = (SpriteVertex*)sc->verts + tile.firstVertex + item.range.firstVertex;
+        uint8_t* indices = (uint8_t*)sc->indices + tile.ibOffset + item.range.firstIndex*indexSize;
+
+        // Refill the sprite in backup buffers, then upload only it's part of the tile
+        SpriteFillContext ctx;
+        ctx.sortedSprites = &ss;
+        ctx.mats = &mat;
+        ctx.colors = color;
+        ctx.ranges = &item.range;
+        ctx.vertexBase = item.range.firstVertex;
+        ctx.indexBase = item.range.firstIndex;
+        ctx.verts = verts;
+        ctx.indices = indices;
+        ctx.index32 = tile.index32;
+        fillSpriteGeometryRange(ctx, 0, 1);
+
+        GfxDriver* gDriver = getGfxDriver();
+        if (tile.dynVb.isValid()) {
+            gDriver->updateDynamicVertexBuffer(tile.dynVb, item.range.firstVertex,
+                                               gDriver->copy(verts, sizeof(SpriteVertex)*item.numVerts));
+            gDriver->updateDynamicIndexBuffer(tile.dynIb, item.range.firstIndex,
+                                              gDriver->copy(indices, indexSize*item.numIndices));
+        }
+
+        // Bounds only grow, so the sprite is still drawn when it moves out of it's original tile
+        rect_t rc = calcSpriteWorldRect(sprite, mat);
+        tmath::rectPushPoint(&tile.bounds, rc.vmin);
+        tmath::rectPushPoint(&tile.bounds, rc.vmax);
+        tmath::rectPushPoint(&sc->bounds, rc.vmin);
+        tmath::rectPushPoint(&sc->bounds, rc.vmax);
+        return true;
+    }
+
+    static void drawCacheTiles(uint8_t viewId, SpriteCache* sc, const rect_t* viewRect, ProgramHandle progOverride,
+                               sprite::StateCallback stateCallback, void* stateUserData)
+    {
+        GfxDriver* gDriver = getGfxDriver();
+
+        // Collect batches of visible tiles
+        // Batches of multiple tiles are sorted by order, so overlapping sprites of neighbor tiles are drawn correctly
+        bx::AllocatorI* tmpAlloc = getTempAlloc();
+        uint32_t* keys = (uint32_t*)BX_ALLOC(tmpAlloc, sizeof(uint32_t)*sc->numBatches*2);
+        if (!keys)
+            return;
+        uint32_t numVisible = 0;
+        for (int t = 0; t < sc->numTiles; t++) {
+            const SpriteCacheTile& tile = sc->tiles[t];
+            if (viewRect && !tmath::rectTestRect(tile.bounds, *viewRect))
+                continue;
+            for (int i = tile.firstBatch, c = tile.firstBatch + tile.numBatches; i < c; i++)
+                keys[numVisible++] = (uint32_t(sc->batches[i].order) << 24) | uint32_t(i);
+        }
+        if (numVisible > 1 && sc->numTiles > 1)
+            bx::radixSort(keys, keys + sc->numBatches, numVisible);
 
         GfxState::Bits state = gfx::stateBlendAlpha() | GfxState::RGBWrite | GfxState::AlphaWrite | GfxState::CullCCW;
         ProgramHandle prog = !progOverride.isValid() ? gSpriteMgr->spriteProg : progOverride;
-        for (int i = 0, c = sc->numBatches; i < c; i++) {
-            const SpriteDrawBatch batch = sc->batches[i];
+        for (uint32_t i = 0; i < numVisible; i++) {
+            int batchIdx = int(keys[i] & 0xffffff);
+            const SpriteDrawBatch batch = sc->batches[batchIdx];
+            const SpriteCacheTile& tile = sc->tiles[sc->batchTiles[batchIdx]];
             gDriver->setState(state, 0);
-            gDriver->setVertexBufferI(0, sc->vb, 0, batch.numVerts);
-            gDriver->setIndexBuffer(sc->ib, batch.startIdx, batch.numIndices);
-            if (batch.texHandle.isValid())
-                gDriver->setTexture(0, gSpriteMgr->u_texture, asset::getObjPtr<Texture>(batch.texHandle)->handle, TextureFlag::FromTexture);
+            if (sc->dynamic) {
+                gDriver->setDynamicVertexBuffer(0, tile.dynVb, batch.startVertex, batch.numVerts);
+                gDriver->setDynamicIndexBuffer(tile.dynIb, batch.startIdx, batch.numIndices);
+            } else {
+                gDriver->setVertexBufferI(0, tile.vb, batch.startVertex, batch.numVerts);
+                gDriver->setIndexBuffer(tile.ib, batch.startIdx, batch.numIndices);
+            }
+
             bool textureOverride = false;
             if (stateCallback) {
                 stateCallback(gDriver, stateUserData, &textureOverride);
             }
+            if (batch.texHandle.isValid() & !textureOverride)
+                gDriver->setTexture(0, gSpriteMgr->u_texture, asset::getObjPtr<Texture>(batch.texHandle)->handle, TextureFlag::FromTexture);
             gDriver->submit(viewId, prog, 0, false);
         }
     }
 
+    void sprite::drawCache(uint8_t viewId, SpriteCache* spriteCache,
+                           ProgramHandle progOverride /*= ProgramHandle()*/, 
+                           sprite::StateCallback stateCallback /*= nullptr*/, void* stateUserData /*= nullptr*/)
+    {
+        drawCacheTiles(viewId, spriteCache, nullptr, progOverride, stateCallback, stateUserData);
+    }
+
+    void sprite::drawCache(uint8_t viewId, SpriteCache* spriteCache, const rect_t& viewRect,
+                           ProgramHandle progOverride /*= ProgramHandle()*/, 
+                           sprite::StateCallback stateCallback /*= nullptr*/, void* stateUserData /*= nullptr*/)
+    {
+        drawCacheTiles(viewId, spriteCache, &viewRect, progOverride, stateCallback, stateUserData);
+    }
+
     void sprite::destroyCache(SpriteCache* spriteCache)
     {
         SpriteCache* sc = spriteCache;
         if (sc->alloc) {
             gSpriteMgr->spriteCacheList.remove(&sc->lnode);
 
+            destroyCacheBuffers(getGfxDriver(), sc);
+
             if (sc->verts) {
                 BX_FREE(sc->alloc, sc->verts);
             }
@@ -2003,12 +2813,16 @@ namespace tee {
                 BX_FREE(sc->alloc, sc->batches);
             }
 
-            GfxDriver* gDriver = getGfxDriver();
-            if (sc->vb.isValid()) {
-                gDriver->destroyVertexBuffer(sc->vb);
+            if (sc->batchTiles) {
+                BX_FREE(sc->alloc, sc->batchTiles);
             }
-            if (sc->ib.isValid()) {
-                gDriver->destroyIndexBuffer(sc->ib);
+
+            if (sc->tiles) {
+                BX_FREE(sc->alloc, sc->tiles);
+            }
+
+            if (sc->items) {
+                BX_FREE(sc->alloc, sc->items);
             }
 
             BX_DELETE(sc->alloc, sc);
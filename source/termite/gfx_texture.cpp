@@ -50,6 +50,11 @@ namespace tee {
         bool loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
         void unloadObj(uintptr_t obj, bx::AllocatorI* alloc) override;
         void onReload(AssetHandle handle, bx::AllocatorI* alloc) override;
+
+        bool canDecode(const AssetParams& params, bx::AllocatorI* alloc) override;
+        bool decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded, bx::AllocatorI* alloc) override;
+        bool finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
+        void releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc) override;
     };
 
     struct TextureCacheItem
@@ -91,7 +96,7 @@ namespace tee {
             driver = nullptr;
             enableTextureDecodeCache = false;
             isETC2Supported = false;
-            saveCacheJobHandle = nullptr;
+            saveCacheJobHandle = JobHandle();
         }
     };
 
@@ -325,6 +330,10 @@ namespace tee {
             gTexLoader->isETC2Supported = true;
         } 
 
+        // Textures can be decoded in multiple jobs at the same time, so the ETC2 decoder tables are built once here
+        if (!gTexLoader->isETC2Supported)
+            setupAlphaTable();
+
         if (BX_ENABLED(BX_PLATFORM_ANDROID) || BX_ENABLED(BX_PLATFORM_IOS)) {
             if (!gTexLoader->isETC2Supported) {
                 BX_WARN("ETC2 formated is not supported in this device. Engine will decode and cache ETC2 textures internally, may cause longer load times");
@@ -437,12 +446,51 @@ namespace tee {
                                   output_w, output_h, output_stride_in_bytes, num_channels) != 0;
     }
 
-    static bool loadUncompressed(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc)
+    // Pixels of a texture file that are ready to be passed to the driver, see createDecodedTexture
+    struct DecodedTexture
     {
-        BX_ASSERT(gTexLoader);
-        GfxDriver* driver = gTexLoader->driver;
-        const LoadTextureParams* texParams = (const LoadTextureParams*)params.userParams;
+        TextureHandle handle;       // Texture is already created (loaded from decode cache)
+        TextureInfo info;
+        TextureFormat::Enum fmt;    // Format of 'data', differs from info.format for software decoded textures
+        bool hasMips;
+        uint16_t numLayers;
+        void* data;
+        uint32_t size;
+        GfxReleaseMemCallback releaseFn;    // Frees 'data'
+        void* releaseUserData;
+
+        DecodedTexture()
+        {
+            bx::memSet(&info, 0x00, sizeof(info));
+            fmt = TextureFormat::Unknown;
+            hasMips = false;
+            numLayers = 1;
+            data = nullptr;
+            size = 0;
+            releaseFn = nullptr;
+            releaseUserData = nullptr;
+        }
+    };
+
+    static void heapCallbackFreeImage(void* ptr, void* userData)
+    {
+        BX_FREE(getHeapAlloc(), ptr);
+    }
+
+    static void bimgCallbackFreeImage(void* ptr, void* userData)
+    {
+        bimg::imageFree((bimg::ImageContainer*)userData);
+    }
+
+    static void freeDecodedTexture(DecodedTexture* dtex)
+    {
+        if (dtex->data && dtex->releaseFn)
+            dtex->releaseFn(dtex->data, dtex->releaseUserData);
+        dtex->data = nullptr;
+    }
 
+    static bool decodeUncompressed(const MemoryBlock* mem, const LoadTextureParams* texParams, DecodedTexture* dtex)
+    {
         int numComp;
         TextureFormat::Enum fmt = texParams->fmt;
         switch (fmt) {
@@ -488,16 +536,6 @@ namespace tee {
         if (!pixels)
             return false;
 
-        Texture* texture;
-        if (alloc)
-            texture = BX_NEW(alloc, Texture)();
-        else
-            texture = gTexLoader->texturePool.newInstance();
-        if (!texture) {
-            stbi_image_free(pixels);
-            return false;
-        }
-
         // If texture format is Unknown, fix the format by guessing it
         if (fmt == TextureFormat::Unknown) {
             switch (comp) {
@@ -519,7 +557,6 @@ namespace tee {
 
         // Generate mips
         int numMips = 1;    // default
-        const GfxMemory* gmem = nullptr;
         if (texParams->generateMips) {
             numMips = 1 + (int)bx::floor(bx::log2((float)bx::uint32_max(width, height)));
             int skipMips = bx::uint32_min(numMips - 1, texParams->skipMips);
@@ -542,17 +579,13 @@ namespace tee {
             numMips -= skipMips;
 
             // Allocate the buffer and generate mips
-            gmem = driver->alloc(sizeBytes);
-            if (!gmem) {
+            uint8_t* mipPixels = (uint8_t*)BX_ALLOC(getHeapAlloc(), sizeBytes);
+            if (!mipPixels) {
                 stbi_image_free(pixels);
-                if (alloc)
-                    BX_DELETE(alloc, texture);
-                else
-                    gTexLoader->texturePool.deleteInstance(texture);
                 return false;
             }
 
-            uint8_t* srcPixels = gmem->data;
+            uint8_t* srcPixels = mipPixels;
             if (skipMips > 0) {
                 stbir_resize_uint8(pixels, origWidth, origHeight, 0, srcPixels, width, height, 0, numComp);
             } else {
@@ -575,25 +608,27 @@ namespace tee {
                 mipWidth = bx::uint32_max(1, mipWidth >> 1);
                 mipHeight = bx::uint32_max(1, mipHeight >> 1);
             }
+
+            dtex->data = mipPixels;
+            dtex->size = sizeBytes;
+            dtex->releaseFn = heapCallbackFreeImage;
         } else {
-            gmem = driver->makeRef(pixels, width*height*numComp, stbCallbackFreeImage, nullptr);
+            dtex->data = pixels;
+            dtex->size = width*height*numComp;
+            dtex->releaseFn = stbCallbackFreeImage;
         }
 
-        texture->handle = driver->createTexture2D(width, height, texParams->generateMips, 1, fmt, texParams->flags, gmem);
-        if (!texture->handle.isValid())
-            return false;
+        dtex->fmt = fmt;
+        dtex->hasMips = texParams->generateMips;
+        dtex->numLayers = 1;
 
-        TextureInfo* info = &texture->info;
+        TextureInfo* info = &dtex->info;
         info->width = width;
         info->height = height;
         info->format = fmt;
         info->numMips = 1;
         info->storageSize = width * height * numComp;
         info->bitsPerPixel = numComp * 8;
-        texture->ratio = float(info->width) / float(info->height);
-
-        *obj = uintptr_t(texture);
-
         return true;
     }
 
@@ -658,19 +693,9 @@ namespace tee {
         return outData;
     }
 
-    static bool loadCompressed(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc)
+    // Decode cache is only used in the blocking path (TextureLoaderAll::canDecode), it's not thread-safe
+    static bool decodeCompressed(const MemoryBlock* mem, const AssetParams& params, DecodedTexture* dtex)
     {
-        const LoadTextureParams* texParams = (const LoadTextureParams*)params.userParams;
-
-        Texture* texture;
-        if (alloc)
-            texture = BX_NEW(alloc, Texture)();
-        else
-            texture = gTexLoader->texturePool.newInstance();
-        if (!texture)
-            return false;
-
-        GfxDriver* driver = gTexLoader->driver;
         bimg::ImageContainer imgInfo;
         bx::Error err;
         if (!bimg::imageParse(imgInfo, mem->data, mem->size, &err)) {
@@ -687,27 +712,32 @@ namespace tee {
 
         // 
         bimg::ImageContainer* img = bimg::imageParse(getHeapAlloc(), mem->data, mem->size);
-        if (!img || !img->m_data)
+        if (!img)
             return false;
+        if (!img->m_data) {
+            bimg::imageFree(img);
+            return false;
+        }
 
-        texture->info.width = imgInfo.m_width;
-        texture->info.height = imgInfo.m_height;
-        texture->info.format = (TextureFormat::Enum)imgInfo.m_format;
-        texture->info.numMips = imgInfo.m_numMips;
-        texture->info.storageSize = img->m_size;
-        texture->info.depth = img->m_depth;
-        texture->info.cubeMap = img->m_cubeMap;
-        texture->info.bitsPerPixel = bimg::getBitsPerPixel(imgInfo.m_format);
-        texture->ratio = float(imgInfo.m_width) / float(imgInfo.m_height);
+        dtex->info.width = imgInfo.m_width;
+        dtex->info.height = imgInfo.m_height;
+        dtex->info.format = (TextureFormat::Enum)imgInfo.m_format;
+        dtex->info.numMips = imgInfo.m_numMips;
+        dtex->info.storageSize = img->m_size;
+        dtex->info.depth = img->m_depth;
+        dtex->info.cubeMap = img->m_cubeMap;
+        dtex->info.bitsPerPixel = bimg::getBitsPerPixel(imgInfo.m_format);
+        dtex->hasMips = img->m_numMips > 1;
+        dtex->numLayers = img->m_numLayers;
 
         if (isFormatSupported) {
             // TODO: support Cube/3D textures
             BX_ASSERT(img->m_depth == 1 && !img->m_cubeMap);
-            texture->handle = driver->createTexture2D(img->m_width, img->m_height, img->m_numMips>1, img->m_numLayers,
-                (TextureFormat::Enum)img->m_format, texParams->flags, driver->makeRef(img->m_data, img->m_size, [](void* ptr, void* userData) {
-                bimg::ImageContainer* img = (bimg::ImageContainer*)userData;
-                bimg::imageFree(img);
-            }, img));
+            dtex->fmt = (TextureFormat::Enum)img->m_format;
+            dtex->data = img->m_data;
+            dtex->size = img->m_size;
+            dtex->releaseFn = bimgCallbackFreeImage;
+            dtex->releaseUserData = img;
         } else {
             bool decode = true;
             uint32_t dataHash = 0;
@@ -739,28 +769,27 @@ namespace tee {
                         cacheJob->numChannels = 4;
                         memcpy(cacheJob->pixelData, decoded, decodedSize);
 
+                        // Chain after the previous save job, instead of blocking the loader until it's finished
                         JobDesc j(saveCacheTextureJob, cacheJob, JobPriority::Low);
-                        if (gTexLoader->saveCacheJobHandle)
-                            waitAndDeleteJob(gTexLoader->saveCacheJobHandle);
-                        gTexLoader->saveCacheJobHandle = dispatchBigJobs(&j, 1);
+                        gTexLoader->saveCacheJobHandle = dispatchBigJobsAfter(gTexLoader->saveCacheJobHandle, &j, 1);
 
                         if (gTexLoader->saveCacheJobHandle) {
                             updateTextureCacheItem(bx::hash<bx::HashCrc32>(params.uri), dataHash);
                         } else {
                             BX_WARN("SaveCacheJob Error");
+                            BX_FREE(getHeapAlloc(), cacheJob);
                         }
                     }
 
-                    texture->handle = driver->createTexture2D(img->m_width, img->m_height, img->m_numMips>1, img->m_numLayers,
-                                                              TextureFormat::RGBA8, texParams->flags,
-                                                              driver->makeRef(decoded, decodedSize, [](void* ptr, void* userData) {
-                        BX_FREE(getHeapAlloc(), ptr);
-                    }, nullptr));
+                    dtex->fmt = TextureFormat::RGBA8;
+                    dtex->data = decoded;
+                    dtex->size = decodedSize;
+                    dtex->releaseFn = heapCallbackFreeImage;
                 }
             } else {
                 // Try to open the decoded file from cache
-                texture->handle = loadTextureFromCache(params, driver);
-                if (!texture->handle.isValid()) {
+                dtex->handle = loadTextureFromCache(params, gTexLoader->driver);
+                if (!dtex->handle.isValid()) {
                     // Some error occured on opening cached file, remove it from cache db
                     removeTextureCacheItem(params.uri);
                 }
@@ -768,6 +797,38 @@ namespace tee {
 
             bimg::imageFree(img);
         }
+
+        return dtex->data || dtex->handle.isValid();
+    }
+
+    // Main thread part of the load, 'dtex' data is always consumed
+    static bool createDecodedTexture(DecodedTexture* dtex, const LoadTextureParams* texParams, uintptr_t* obj,
+                                     bx::AllocatorI* alloc)
+    {
+        Texture* texture;
+        if (alloc)
+            texture = BX_NEW(alloc, Texture)();
+        else
+            texture = gTexLoader->texturePool.newInstance();
+        if (!texture) {
+            freeDecodedTexture(dtex);
+            return false;
+        }
+
+        texture->info = dtex->info;
+        texture->ratio = float(dtex->info.width) / float(dtex->info.height);
+
+        if (dtex->handle.isValid()) {
+            texture->handle = dtex->handle;
+        } else {
+            GfxDriver* driver = gTexLoader->driver;
+            texture->handle = driver->createTexture2D(dtex->info.width, dtex->info.height, dtex->hasMips, dtex->numLayers,
+                                                      dtex->fmt, texParams->flags,
+                                                      driver->makeRef(dtex->data, dtex->size, dtex->releaseFn, 
+                                                                      dtex->releaseUserData));
+            dtex->data = nullptr;   // Owned by the driver now
+        }
+
         if (!texture->handle.isValid()) {
             if (alloc)
                 BX_DELETE(alloc, texture);
@@ -779,9 +840,7 @@ namespace tee {
         return true;
     }
 
-
-    bool TextureLoaderAll::loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj,
-                                   bx::AllocatorI* alloc)
+    static bool decodeTexture(const MemoryBlock* mem, const AssetParams& params, DecodedTexture* dtex)
     {
         bx::Path path(params.uri);
         bx::Path ext = path.getFileExt();
@@ -792,15 +851,59 @@ namespace tee {
             *lz4Ext = 0;
 
         if (ext.isEqual("ktx") || ext.isEqual("dds") || ext.isEqual("pvr")) {
-            return loadCompressed(mem, params, obj, alloc);
+            return decodeCompressed(mem, params, dtex);
         } else if (ext.isEqual("png") || ext.isEqual("tga") || ext.isEqual("jpg") || ext.isEqual("bmp") ||
                    ext.isEqual("jpeg") || ext.isEqual("psd") || ext.isEqual("hdr") || ext.isEqual("gif")) {
-            return loadUncompressed(mem, params, obj, alloc);
+            return decodeUncompressed(mem, (const LoadTextureParams*)params.userParams, dtex);
         } else {
             return false;
         }
     }
 
+    bool TextureLoaderAll::loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj,
+                                   bx::AllocatorI* alloc)
+    {
+        DecodedTexture dtex;
+        if (!decodeTexture(mem, params, &dtex))
+            return false;
+        return createDecodedTexture(&dtex, (const LoadTextureParams*)params.userParams, obj, alloc);
+    }
+
+    bool TextureLoaderAll::canDecode(const AssetParams& params, bx::AllocatorI* alloc)
+    {
+        return !gTexLoader->enableTextureDecodeCache;
+    }
+
+    bool TextureLoaderAll::decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded,
+                                     bx::AllocatorI* alloc)
+    {
+        DecodedTexture* dtex = BX_NEW(getHeapAlloc(), DecodedTexture);
+        if (!dtex)
+            return false;
+        if (!decodeTexture(mem, params, dtex)) {
+            BX_DELETE(getHeapAlloc(), dtex);
+            return false;
+        }
+        *decoded = uintptr_t(dtex);
+        return true;
+    }
+
+    bool TextureLoaderAll::finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj,
+                                       bx::AllocatorI* alloc)
+    {
+        DecodedTexture* dtex = (DecodedTexture*)decoded;
+        bool r = createDecodedTexture(dtex, (const LoadTextureParams*)params.userParams, obj, alloc);
+        BX_DELETE(getHeapAlloc(), dtex);
+        return r;
+    }
+
+    void TextureLoaderAll::releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc)
+    {
+        DecodedTexture* dtex = (DecodedTexture*)decoded;
+        freeDecodedTexture(dtex);
+        BX_DELETE(getHeapAlloc(), dtex);
+    }
+
     void TextureLoaderAll::unloadObj(uintptr_t obj, bx::AllocatorI* alloc)
     {
         BX_ASSERT(gTexLoader);
@@ -3,6 +3,7 @@
 #include "bx/allocator.h"
 #include "math.h"
 #include "assetlib.h"
+#include "ecs.h"
 
 // Internal API file
 // Only accessed by engine internals
@@ -18,7 +19,8 @@ namespace tee {
     bool initJobDispatcher(bx::AllocatorI* alloc,
                            uint16_t maxSmallFibers = 0, uint32_t smallFiberStackSize = 0,
                            uint16_t maxBigFibers = 0, uint32_t bigFiberStackSize = 0,
-                           bool lockThreadsToCores = true, uint8_t numThreads = UINT8_MAX);
+                           bool lockThreadsToCores = true, uint8_t numThreads = UINT8_MAX,
+                           uint8_t numReservedCores = 1);
     void shutdownJobDispatcher();
 
     bool initPluginSystem(const char* pluginPath, bx::AllocatorI* alloc);
@@ -27,6 +29,11 @@ namespace tee {
     namespace asset {
         bool init(AssetLibInitFlags::Bits flags, IoDriver* driver, bx::AllocatorI* alloc, IoDriver* blockingDriver = nullptr);
         void shutdown();
+
+        // Finalizes assets that are decoded in jobs, called every frame on main thread
+        void update();
+        // Waits for decode jobs and discards their results, must be called before job dispatcher is shutdown
+        void cancelDecodes();
     }
 
     namespace sdl {
@@ -37,6 +44,11 @@ namespace tee {
     namespace ecs {
         bool init(bx::AllocatorI* alloc);
         void shutdown();
+
+        // registerComponent for EcsApi version 0 plugins, which are built with the older ComponentCallbacks
+        ComponentTypeHandle registerComponentV0(const char* name, const ComponentCallbacks* callbacks,
+                                                ComponentFlag::Bits flags, uint32_t dataSize, uint16_t poolSize,
+                                                uint16_t growSize, bx::AllocatorI* alloc);
     }
 
     namespace cmd {
@@ -7,15 +7,28 @@
 #include "bx/thread.h"
 #include "bx/uint32_t.h"
 #include "bx/string.h"
-#include "bxx/pool.h"
-#include "bxx/stack.h"
-#include "bxx/linked_list.h"
+#include "bx/rng.h"
+#include "bx/timer.h"
 #include "bxx/lock.h"
+#include "bxx/array.h"
 
 #include "fcontext/fcontext.h"
+#include "remotery/Remotery.h"
 
-#include <mutex>
-#include <thread>
+#include <atomic>
+
+#if BX_PLATFORM_WINDOWS
+#   define WIN32_LEAN_AND_MEAN
+#   include <Windows.h>
+#else
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID
+#   include <sched.h>
+#   include <stdio.h>
+#endif
 
 using namespace tee;
 
@@ -25,34 +38,123 @@ using namespace tee;
 #define DEFAULT_BIG_STACKSIZE 524288   // 512kb
 #define MAX_WAIT_STACKS 32
 #define WAIT_STACK_SIZE 8192    // 8kb
+#define FIBER_POOL_RESERVE_FACTOR 4     // Fiber pools can grow up to 4x of their initial size, then jobs wait for free fibers
+#define FIBER_POOL_GROW_SIZE 16
+#define MAX_CPUS 256
 
 class FiberPool;
 
 struct Fiber
 {
-    typedef bx::List<Fiber*>::Node LNode;
-
-    uint32_t ownerThread;    // by default, owner thread is 0, which indicates that thread owns this fiber
-                             // If we wait on a job (fiber), owner thread gets a valid value
     uint16_t jobIndex;
     uint16_t stackIndex;
     JobCounter* counter;
-    JobCounter* waitCounter;
     fcontext_t context;
     FiberPool* ownerPool;
 
-    LNode lnode;
-
     JobCallback callback;
     JobPriority::Enum priority;
     void* userData;
+};
+
+// Chase-Lev work-stealing deque
+// Reference: "Correct and Efficient Work-Stealing for Weak Memory Models" - Le, Pop, Cohen, Nardelli
+// Only the owner thread can push/pop from the bottom, other threads steal from the top
+// Indices only grow, so they are 64bit to never overflow
+class JobDeque
+{
+private:
+    std::atomic<int64_t> m_top;
+    std::atomic<int64_t> m_bottom;
+    std::atomic<Fiber*>* m_items;
+    int64_t m_mask;
+
+public:
+    JobDeque();
+    bool create(uint32_t capacity, bx::AllocatorI* alloc);
+    void destroy(bx::AllocatorI* alloc);
+
+    bool push(Fiber* fiber);
+    Fiber* pop();
+    Fiber* steal();
+
+    inline bool isEmpty() const
+    {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+
+    inline int32_t getCount() const
+    {
+        return int32_t(bx::max<int64_t>(m_bottom.load(std::memory_order_relaxed) - m_top.load(std::memory_order_relaxed), 0));
+    }
+};
+
+// Shared FIFO queue for jobs that are dispatched from threads that don't own a JobDeque (or when it's full)
+// All job threads poll it along with their local queues
+class JobInjectQueue
+{
+private:
+    Fiber** m_items;
+    uint32_t m_mask;
+    uint32_t m_head;
+    volatile int32_t m_count;
+    bx::Lock m_lock;
+
+public:
+    JobInjectQueue();
+    bool create(uint32_t capacity, bx::AllocatorI* alloc);
+    void destroy(bx::AllocatorI* alloc);
 
-    Fiber() :
-        lnode(this)
+    bool push(Fiber* fiber);
+    Fiber* pop();
+
+    inline bool isEmpty() const
     {
+        return m_count == 0;
     }
 };
 
+// Reserves address space for all stacks up front, stack memory is committed on first use
+// Each stack has a guard page below it, which is never committed
+class StackArena
+{
+private:
+    bx::AllocatorI* m_alloc;
+    uint8_t* m_base;
+    uint8_t* m_committed;
+    size_t m_slotSize;      // Guard page + stack
+    size_t m_pageSize;
+    uint16_t m_maxStacks;
+    uint16_t m_numCommitted;
+
+public:
+    StackArena();
+    bool create(uint16_t maxStacks, uint32_t stackSize, bx::AllocatorI* alloc);
+    void destroy();
+
+    bool commit(uint16_t index);
+    void decommit(uint16_t index);
+    fcontext_stack_t getStack(uint16_t index) const;
+
+    inline bool isCommitted(uint16_t index) const
+    {
+        return m_committed[index] != 0;
+    }
+
+    inline uint16_t getNumCommitted() const
+    {
+        return m_numCommitted;
+    }
+};
+
+// Job that is dispatched while all fibers of the pool are in use, it's started when a fiber is released
+struct PendingJob
+{
+    JobDesc job;
+    uint16_t index;
+    JobCounter* counter;
+};
+
 class FiberPool
 {
 private:
@@ -60,35 +162,166 @@ private:
 
     Fiber* m_fibers;
     Fiber** m_ptrs;
-    fcontext_stack_t* m_stacks;
+    StackArena m_stacks;
 
-    uint16_t m_maxFibers;
+    uint16_t m_numFibers;   // Current size of the pool, grows on demand
+    uint16_t m_maxFibers;   // Reserved size
     int32_t m_index;
+    uint16_t m_peakCount;
+
+    bx::Array<PendingJob> m_pending;    // In dispatch order, items before m_pendingHead are already started
+    int m_pendingHead;
+    volatile int32_t m_numPending;
 
     bx::Lock m_lock;
 
+    bool grow();
+    Fiber* allocFiber(JobCallback callbackFn, void* userData, uint16_t index, JobPriority::Enum priority, 
+                      JobCounter* counter);
+
 public:
     FiberPool();
-    bool create(uint16_t maxFibers, uint32_t stackSize, bx::AllocatorI* alloc);
+    bool create(uint16_t numFibers, uint16_t maxFibers, uint32_t stackSize, bx::AllocatorI* alloc);
     void destroy();
 
     Fiber* newFiber(JobCallback callbackFn, void* userData, uint16_t index, JobPriority::Enum priority, FiberPool* pool,
                     JobCounter* counter);
     void deleteFiber(Fiber* fiber);
+    void releaseIdleStacks();
+
+    // Keeps the job until a fiber is free, returns false only if out of memory
+    bool deferJob(const JobDesc& job, uint16_t index, JobCounter* counter);
+    // Creates fibers for pending jobs as long as there are free fibers, returns number of fibers
+    int newPendingFibers(Fiber** fibers, int maxFibers);
+
+    inline bool hasPendingJobs() const
+    {
+        return m_numPending > 0;
+    }
 
     inline uint16_t getMax() const
     {
         return m_maxFibers;
     }
+
+    inline uint16_t getSize() const
+    {
+        return m_numFibers;
+    }
+
+    inline uint16_t getCount() const
+    {
+        return uint16_t(m_numFibers - m_index);
+    }
+
+    inline uint16_t getPeak() const
+    {
+        return m_peakCount;
+    }
+
+    inline void resetPeak()
+    {
+        m_peakCount = getCount();
+    }
+
+    inline uint16_t getNumCommittedStacks() const
+    {
+        return m_stacks.getNumCommitted();
+    }
+};
+
+struct ThreadData;
+
+// Lives on the stack of the waiting context, until the counter is signaled
+struct WaitNode
+{
+    bx::Semaphore* semaphore;   // Posted when the counter is signaled
+    WaitNode* next;
+};
+
+struct CounterContainer;
+
+// Work that is scheduled when a counter is signaled
+// Either dispatches 'jobs' on 'target' counter, or just decrements 'target' (when-all)
+struct Continuation
+{
+    CounterContainer* target;
+    FiberPool* pool;        // nullptr for when-all
+    JobDesc* jobs;
+    uint16_t numJobs;
+    Continuation* next;
+};
+
+struct CounterContainer
+{
+    JobCounter counter;     // Must be the first member, fibers point to it
+    volatile int32_t signaled;  // Set by the last finished job, after that waiters can safely release the counter
+    WaitNode* waiters;      // Threads parked on this counter
+    Continuation* continuations;    // If set, the counter is deleted automatically after it's signaled
+    bx::Lock lock;
+    volatile uint32_t generation;   // Bumped on every release, JobHandles carry it to detect stale use
+
+    CounterContainer()
+    {
+        counter = 0;
+        signaled = 0;
+        waiters = nullptr;
+        continuations = nullptr;
+        generation = 1;
+    }
+};
+
+// Lock-free free-list of job counters
+// The head is tagged with an ABA counter, next links are indices into the counter array
+class CounterPool
+{
+private:
+    bx::AllocatorI* m_alloc;
+    CounterContainer* m_counters;
+    std::atomic<uint32_t>* m_next;
+    std::atomic<uint64_t> m_head;   // tag(32) | index(32)
+    uint16_t m_maxCounters;
+
+    static const uint32_t kInvalidIndex = UINT32_MAX;
+
+    void push(uint32_t index);
+    uint32_t pop();
+
+public:
+    CounterPool();
+    bool create(uint16_t maxCounters, bx::AllocatorI* alloc);
+    void destroy();
+
+    CounterContainer* newCounter();
+    bool deleteCounter(CounterContainer* container, JobHandle handle);
+
+    // Returns nullptr if the handle is invalid or the counter is already released
+    CounterContainer* fromHandle(JobHandle handle) const;
+    JobHandle toHandle(const CounterContainer* container) const;
+
+    inline uint16_t getMax() const
+    {
+        return m_maxCounters;
+    }
 };
 
 struct ThreadData
 {
     Fiber* running;     // Current running fiber
-    fcontext_stack_t stacks[MAX_WAIT_STACKS];
+    StackArena stacks;  // Wait stacks, MAX_WAIT_STACKS
+    CounterContainer* waitCounters[MAX_WAIT_STACKS];    // Counter that each wait stack is waiting on, nullptr for thread's root context
     int stackIdx;
     bool main;
     uint32_t threadId;   
+    int16_t cpu;        // Logical cpu that thread is locked to, -1 if it's not locked
+    JobDeque deques[JobPriority::Count];    // Local job queues, one for each priority
+    bx::RngMwc rng;     // Picks random victims for stealing
+
+    bx::Semaphore semaphore;    // Sleeps on this when there is nothing to do
+    ThreadData* nextIdle;
+    bool idle;
+
+    JobThreadStats stats;       // Only written by the owner thread
 
     ThreadData()
     {
@@ -96,15 +329,14 @@ struct ThreadData
         stackIdx = 0;
         main = false;
         threadId = 0;
-        bx::memSet(stacks, 0x00, sizeof(stacks));
+        cpu = -1;
+        nextIdle = nullptr;
+        idle = false;
+        bx::memSet(&stats, 0x00, sizeof(stats));
+        bx::memSet(waitCounters, 0x00, sizeof(waitCounters));
     }
 };
 
-struct CounterContainer
-{
-    JobCounter counter;
-};
-
 struct JobDispatcher
 {
     bx::AllocatorI* alloc;
@@ -113,50 +345,190 @@ struct JobDispatcher
     FiberPool smallFibers;
     FiberPool bigFibers;
 
-    bx::List<Fiber*> waitList[JobPriority::Count];  // 3 lists for each priority
-    bx::Lock jobLock;
-    bx::Lock counterLock;
+    ThreadData** threadDatas;   // Main thread is the first one, then worker threads
+    uint8_t numThreadDatas;
+
+    ThreadData* idleList;       // Threads that are sleeping on their semaphores
+    volatile int32_t numIdle;
+    bx::Lock idleLock;
+
     bx::TlsData threadData;
     volatile int32_t stop;
 
     fcontext_stack_t mainStack;
-    bx::FixedPool<CounterContainer> counterPool;
-    JobCounter dummyCounter;
+    CounterPool counterPool;
+    JobInjectQueue injectQueues[JobPriority::Count];    // Jobs of non-dispatcher threads, one for each priority
 
-    bx::Semaphore semaphore;
+    JobDispatcherStats stats;
+    JobThreadStats* threadStats;    // Snapshot buffer for stats.threads
+    int64_t statsResetTime;
+    volatile int32_t profileJobs;
 
     JobDispatcher()
     {
         alloc = nullptr;
         threads = nullptr;
         numThreads = 0;
+        threadDatas = nullptr;
+        numThreadDatas = 0;
+        idleList = nullptr;
+        numIdle = 0;
         stop = 0;
-        dummyCounter = 0;
+        threadStats = nullptr;
+        statsResetTime = 0;
+        profileJobs = 0;
         bx::memSet(&mainStack, 0x00, sizeof(mainStack));
+        bx::memSet(&stats, 0x00, sizeof(stats));
     }
 };
 
 static JobDispatcher* gDispatcher = nullptr;
 
+static size_t getPageSize()
+{
+#if BX_PLATFORM_WINDOWS
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (size_t)si.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static void* reserveVirtualMem(size_t size)
+{
+#if BX_PLATFORM_WINDOWS
+    return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void* ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return ptr != MAP_FAILED ? ptr : nullptr;
+#endif
+}
+
+static void releaseVirtualMem(void* ptr, size_t size)
+{
+#if BX_PLATFORM_WINDOWS
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif
+}
+
+static bool commitVirtualMem(void* ptr, size_t size)
+{
+#if BX_PLATFORM_WINDOWS
+    return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static void decommitVirtualMem(void* ptr, size_t size)
+{
+#if BX_PLATFORM_WINDOWS
+    VirtualFree(ptr, size, MEM_DECOMMIT);
+#else
+    madvise(ptr, size, MADV_DONTNEED);
+    mprotect(ptr, size, PROT_NONE);
+#endif
+}
+
+StackArena::StackArena()
+{
+    m_alloc = nullptr;
+    m_base = nullptr;
+    m_committed = nullptr;
+    m_slotSize = 0;
+    m_pageSize = 0;
+    m_maxStacks = 0;
+    m_numCommitted = 0;
+}
+
+bool StackArena::create(uint16_t maxStacks, uint32_t stackSize, bx::AllocatorI* alloc)
+{
+    m_alloc = alloc;
+    m_pageSize = getPageSize();
+    m_slotSize = m_pageSize + ((size_t(stackSize) + m_pageSize - 1) & ~(m_pageSize - 1));
+    m_maxStacks = maxStacks;
+
+    m_committed = (uint8_t*)BX_ALLOC(alloc, maxStacks);
+    if (!m_committed)
+        return false;
+    bx::memSet(m_committed, 0x00, maxStacks);
+
+    m_base = (uint8_t*)reserveVirtualMem(m_slotSize*maxStacks);
+    return m_base != nullptr;
+}
+
+void StackArena::destroy()
+{
+    if (m_base) {
+        releaseVirtualMem(m_base, m_slotSize*m_maxStacks);
+        m_base = nullptr;
+    }
+    if (m_committed) {
+        BX_FREE(m_alloc, m_committed);
+        m_committed = nullptr;
+    }
+    m_numCommitted = 0;
+}
+
+bool StackArena::commit(uint16_t index)
+{
+    BX_ASSERT(index < m_maxStacks);
+    if (m_committed[index])
+        return true;
+
+    // Skip the guard page at the bottom
+    if (!commitVirtualMem(m_base + m_slotSize*index + m_pageSize, m_slotSize - m_pageSize))
+        return false;
+    m_committed[index] = 1;
+    m_numCommitted++;
+    return true;
+}
+
+void StackArena::decommit(uint16_t index)
+{
+    BX_ASSERT(index < m_maxStacks);
+    if (!m_committed[index])
+        return;
+
+    decommitVirtualMem(m_base + m_slotSize*index + m_pageSize, m_slotSize - m_pageSize);
+    m_committed[index] = 0;
+    m_numCommitted--;
+}
+
+fcontext_stack_t StackArena::getStack(uint16_t index) const
+{
+    // Stacks grow down, so sptr is the top of the slot
+    fcontext_stack_t stack;
+    stack.sptr = m_base + m_slotSize*(index + 1);
+    stack.ssize = m_slotSize - m_pageSize;
+    return stack;
+}
+
 FiberPool::FiberPool()
 {
     m_fibers = nullptr;
-    m_stacks = nullptr;
+    m_numFibers = 0;
     m_maxFibers = 0;
     m_index = 0;
+    m_peakCount = 0;
     m_ptrs = nullptr;
     m_alloc = nullptr;
+    m_pendingHead = 0;
+    m_numPending = 0;
 }
 
-bool FiberPool::create(uint16_t maxFibers, uint32_t stackSize, bx::AllocatorI* alloc)
+bool FiberPool::create(uint16_t numFibers, uint16_t maxFibers, uint32_t stackSize, bx::AllocatorI* alloc)
 {
+    BX_ASSERT(numFibers <= maxFibers);
     m_alloc = alloc;
 
-    // Create pool structure
+    // Create pool structure for the whole reserved size
     size_t totalSize =
         sizeof(Fiber)*maxFibers +
-        sizeof(Fiber*)*maxFibers +
-        sizeof(fcontext_stack_t)*maxFibers;
+        sizeof(Fiber*)*maxFibers;
 
     uint8_t* buff = (uint8_t*)BX_ALLOC(alloc, totalSize);
     if (!buff)
@@ -166,49 +538,444 @@ bool FiberPool::create(uint16_t maxFibers, uint32_t stackSize, bx::AllocatorI* a
     m_fibers = (Fiber*)buff;
     buff += sizeof(Fiber)*maxFibers;
     m_ptrs = (Fiber**)buff;
-    buff += sizeof(Fiber*)*maxFibers;
-    m_stacks = (fcontext_stack_t*)buff;
 
     for (uint16_t i = 0; i < maxFibers; i++)
-        m_ptrs[maxFibers - i - 1] = &m_fibers[i];
+        m_fibers[i].stackIndex = i;
+
+    for (uint16_t i = 0; i < numFibers; i++)
+        m_ptrs[numFibers - i - 1] = &m_fibers[i];
+    m_numFibers = numFibers;
     m_maxFibers = maxFibers;
-    m_index = maxFibers;
+    m_index = numFibers;
 
-    // Create contexts and their stack memories
-    for (uint16_t i = 0; i < maxFibers; i++) {
-        m_stacks[i] = create_fcontext_stack(stackSize);
-        m_fibers[i].stackIndex = i;
-        if (!m_stacks[i].sptr)
-            return false;
-    }
+    if (!m_pending.create(FIBER_POOL_GROW_SIZE, FIBER_POOL_GROW_SIZE, alloc))
+        return false;
 
-    return true;
+    // Reserve stack memories, they are committed when each fiber is used for the first time
+    return m_stacks.create(maxFibers, stackSize, alloc);
 }
 
 void FiberPool::destroy()
 {
-    for (uint16_t i = 0; i < m_maxFibers; i++) {
-        if (m_stacks[i].sptr)
-            destroy_fcontext_stack(&m_stacks[i]);
-    }
+    m_stacks.destroy();
+    m_pending.destroy();
 
-    // Free the whole buffer (context+ptrs+stacks)
+    // Free the whole buffer (context+ptrs)
     if (m_fibers)
         BX_FREE(m_alloc, m_fibers);
 }
 
-static ThreadData* createThreadData(bx::AllocatorI* alloc, uint32_t threadId, bool main)
+bool FiberPool::grow()
+{
+    uint16_t count = bx::min<uint16_t>(FIBER_POOL_GROW_SIZE, m_maxFibers - m_numFibers);
+    if (count == 0)
+        return false;
+
+    // Pool is empty, so new fibers simply go to the bottom of the free list
+    BX_ASSERT(m_index == 0);
+    for (uint16_t i = 0; i < count; i++)
+        m_ptrs[m_index++] = &m_fibers[m_numFibers + count - i - 1];
+    m_numFibers += count;
+    return true;
+}
+
+void FiberPool::releaseIdleStacks()
+{
+    bx::LockScope lk(m_lock);
+    for (int32_t i = 0; i < m_index; i++)
+        m_stacks.decommit(m_ptrs[i]->stackIndex);
+}
+
+CounterPool::CounterPool() : m_head(0)
+{
+    m_alloc = nullptr;
+    m_counters = nullptr;
+    m_next = nullptr;
+    m_maxCounters = 0;
+}
+
+bool CounterPool::create(uint16_t maxCounters, bx::AllocatorI* alloc)
+{
+    m_alloc = alloc;
+    m_counters = (CounterContainer*)BX_ALLOC(alloc, sizeof(CounterContainer)*maxCounters);
+    m_next = (std::atomic<uint32_t>*)BX_ALLOC(alloc, sizeof(std::atomic<uint32_t>)*maxCounters);
+    if (!m_counters || !m_next)
+        return false;
+    m_maxCounters = maxCounters;
+
+    for (uint16_t i = 0; i < maxCounters; i++) {
+        BX_PLACEMENT_NEW(&m_counters[i], CounterContainer);
+        BX_PLACEMENT_NEW(&m_next[i], std::atomic<uint32_t>)(i + 1 < maxCounters ? uint32_t(i + 1) : kInvalidIndex);
+    }
+    m_head.store(maxCounters > 0 ? 0 : kInvalidIndex, std::memory_order_relaxed);
+    return true;
+}
+
+void CounterPool::destroy()
+{
+    if (m_counters) {
+        BX_FREE(m_alloc, m_counters);
+        m_counters = nullptr;
+    }
+    if (m_next) {
+        BX_FREE(m_alloc, m_next);
+        m_next = nullptr;
+    }
+    m_maxCounters = 0;
+}
+
+void CounterPool::push(uint32_t index)
+{
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do {
+        m_next[index].store(uint32_t(head & 0xffffffff), std::memory_order_relaxed);
+        newHead = (((head >> 32) + 1) << 32) | index;
+    } while (!m_head.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+}
+
+uint32_t CounterPool::pop()
+{
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    uint64_t newHead;
+    uint32_t index;
+    do {
+        index = uint32_t(head & 0xffffffff);
+        if (index == kInvalidIndex)
+            return kInvalidIndex;
+        // Next may be stale if another thread popped this item in the meantime, the tag makes the CAS fail then
+        newHead = (((head >> 32) + 1) << 32) | m_next[index].load(std::memory_order_relaxed);
+    } while (!m_head.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire));
+    return index;
+}
+
+CounterContainer* CounterPool::newCounter()
+{
+    uint32_t index = pop();
+    if (index == kInvalidIndex)
+        return nullptr;
+
+    CounterContainer* container = &m_counters[index];
+    container->counter = 0;
+    container->signaled = 0;
+    container->waiters = nullptr;
+    container->continuations = nullptr;
+    return container;
+}
+
+bool CounterPool::deleteCounter(CounterContainer* container, JobHandle handle)
+{
+    // Only one caller can release a handle, the rest see a new generation and fail
+    uint32_t generation = uint32_t(handle) >> 16;
+    uint32_t nextGeneration = generation < UINT16_MAX ? generation + 1 : 1;
+    if (bx::atomicCompareAndSwap<uint32_t>(&container->generation, generation, nextGeneration) != generation)
+        return false;
+
+    push(uint32_t(container - m_counters));
+    return true;
+}
+
+CounterContainer* CounterPool::fromHandle(JobHandle handle) const
+{
+    uint32_t index = uint32_t(handle) & 0xffff;
+    if (!handle.isValid() || index >= m_maxCounters)
+        return nullptr;
+    CounterContainer* container = &m_counters[index];
+    return container->generation == (uint32_t(handle) >> 16) ? container : nullptr;
+}
+
+JobHandle CounterPool::toHandle(const CounterContainer* container) const
+{
+    return JobHandle((container->generation << 16) | uint32_t(container - m_counters));
+}
+
+JobDeque::JobDeque()
+{
+    m_top = 0;
+    m_bottom = 0;
+    m_items = nullptr;
+    m_mask = 0;
+}
+
+bool JobDeque::create(uint32_t capacity, bx::AllocatorI* alloc)
+{
+    capacity = bx::uint32_nextpow2(capacity);
+    m_items = (std::atomic<Fiber*>*)BX_ALLOC(alloc, sizeof(std::atomic<Fiber*>)*capacity);
+    if (!m_items)
+        return false;
+    for (uint32_t i = 0; i < capacity; i++)
+        BX_PLACEMENT_NEW(&m_items[i], std::atomic<Fiber*>)(nullptr);
+    m_mask = int64_t(capacity - 1);
+    return true;
+}
+
+void JobDeque::destroy(bx::AllocatorI* alloc)
+{
+    if (m_items) {
+        BX_FREE(alloc, m_items);
+        m_items = nullptr;
+    }
+}
+
+bool JobDeque::push(Fiber* fiber)
+{
+    int64_t b = m_bottom.load(std::memory_order_relaxed);
+    int64_t t = m_top.load(std::memory_order_acquire);
+    if (b - t > m_mask)
+        return false;
+
+    m_items[b & m_mask].store(fiber, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Fiber* JobDeque::pop()
+{
+    int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = m_top.load(std::memory_order_relaxed);
+
+    if (t <= b) {
+        Fiber* fiber = m_items[b & m_mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last item in the queue, race against stealers
+            if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                fiber = nullptr;
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return fiber;
+    } else {
+        // Queue is empty
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+}
+
+Fiber* JobDeque::steal()
+{
+    int64_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = m_bottom.load(std::memory_order_acquire);
+
+    if (t < b) {
+        Fiber* fiber = m_items[t & m_mask].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;     // Lost the race to the owner or another stealer
+        return fiber;
+    }
+    return nullptr;
+}
+
+JobInjectQueue::JobInjectQueue()
+{
+    m_items = nullptr;
+    m_mask = 0;
+    m_head = 0;
+    m_count = 0;
+}
+
+bool JobInjectQueue::create(uint32_t capacity, bx::AllocatorI* alloc)
+{
+    capacity = bx::uint32_nextpow2(capacity);
+    m_items = (Fiber**)BX_ALLOC(alloc, sizeof(Fiber*)*capacity);
+    if (!m_items)
+        return false;
+    m_mask = capacity - 1;
+    return true;
+}
+
+void JobInjectQueue::destroy(bx::AllocatorI* alloc)
+{
+    if (m_items) {
+        BX_FREE(alloc, m_items);
+        m_items = nullptr;
+    }
+}
+
+bool JobInjectQueue::push(Fiber* fiber)
+{
+    bx::LockScope lk(m_lock);
+    if (uint32_t(m_count) > m_mask)
+        return false;
+    m_items[(m_head + uint32_t(m_count)) & m_mask] = fiber;
+    bx::atomicFetchAndAdd<int32_t>(&m_count, 1);
+    return true;
+}
+
+Fiber* JobInjectQueue::pop()
+{
+    if (m_count == 0)
+        return nullptr;
+
+    bx::LockScope lk(m_lock);
+    if (m_count == 0)
+        return nullptr;
+    Fiber* fiber = m_items[m_head];
+    m_head = (m_head + 1) & m_mask;
+    bx::atomicFetchAndSub<int32_t>(&m_count, 1);
+    return fiber;
+}
+
+struct CpuInfo
+{
+    uint16_t cpu;
+    uint16_t node;      // NUMA node
+    uint16_t package;
+    uint16_t core;      // Physical core, SMT siblings have the same core
+};
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID
+static bool readSysFile(const char* path, char* buff, int size)
+{
+    FILE* f = fopen(path, "rt");
+    if (!f)
+        return false;
+    bool r = fgets(buff, size, f) != nullptr;
+    fclose(f);
+    return r;
+}
+
+static int readSysInt(const char* path, int defaultValue)
+{
+    char buff[32];
+    return readSysFile(path, buff, sizeof(buff)) ? atoi(buff) : defaultValue;
+}
+
+// Parses lists like "0-3,8,10-11"
+static int parseCpuList(const char* str, uint16_t* cpus, int maxCpus)
+{
+    int count = 0;
+    while (*str && count < maxCpus) {
+        char* end;
+        int first = (int)strtol(str, &end, 10);
+        if (end == str)
+            break;
+        int last = first;
+        if (*end == '-')
+            last = (int)strtol(end + 1, &end, 10);
+        for (int i = first; i <= last && count < maxCpus; i++)
+            cpus[count++] = uint16_t(i);
+        str = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+#endif
+
+// Returns logical cpus in the order that threads should be assigned to them:
+// One logical cpu from each physical core first, grouped by NUMA node and package, then the SMT siblings
+// So consecutive threads share the caches of the same node, and don't compete on the same core until it's unavoidable
+static int getCpuTopology(CpuInfo* cpus, int maxCpus)
+{
+    int numCpus = 0;
+#if BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID
+    char buff[512];
+    uint16_t ids[MAX_CPUS];
+    if (!readSysFile("/sys/devices/system/cpu/online", buff, sizeof(buff)))
+        return 0;
+    numCpus = parseCpuList(buff, ids, bx::min<int>(maxCpus, MAX_CPUS));
+
+    char path[128];
+    for (int i = 0; i < numCpus; i++) {
+        CpuInfo& info = cpus[i];
+        info.cpu = ids[i];
+        info.node = 0;
+        bx::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", info.cpu);
+        info.package = uint16_t(readSysInt(path, 0));
+        bx::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", info.cpu);
+        info.core = uint16_t(readSysInt(path, info.cpu));
+    }
+
+    // NUMA nodes, missing on machines without NUMA support
+    for (int node = 0; node < MAX_CPUS; node++) {
+        bx::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (!readSysFile(path, buff, sizeof(buff)))
+            break;
+        int numNodeCpus = parseCpuList(buff, ids, MAX_CPUS);
+        for (int i = 0; i < numNodeCpus; i++) {
+            for (int k = 0; k < numCpus; k++) {
+                if (cpus[k].cpu == ids[i])
+                    cpus[k].node = uint16_t(node);
+            }
+        }
+    }
+#elif BX_PLATFORM_WINDOWS
+    // No topology info, just take the cpus in order
+    numCpus = bx::min<int>(maxCpus, bx::min<int>(getHardwareInfo().numCores, 64));
+    for (int i = 0; i < numCpus; i++) {
+        cpus[i].cpu = uint16_t(i);
+        cpus[i].node = cpus[i].package = 0;
+        cpus[i].core = uint16_t(i);
+    }
+#else
+    BX_UNUSED(cpus, maxCpus);
+#endif
+
+    // Sort by (SMT sibling index, node, package, core, cpu), sibling index = number of cpus before this one on the same core
+    uint16_t sibling[MAX_CPUS];
+    for (int i = 0; i < numCpus; i++) {
+        sibling[i] = 0;
+        for (int k = 0; k < numCpus; k++) {
+            if (cpus[k].package == cpus[i].package && cpus[k].core == cpus[i].core && cpus[k].cpu < cpus[i].cpu)
+                sibling[i]++;
+        }
+    }
+
+    // Insertion sort, there aren't many of them
+    for (int i = 1; i < numCpus; i++) {
+        CpuInfo info = cpus[i];
+        uint16_t sib = sibling[i];
+        uint64_t key = (uint64_t(sib) << 48) | (uint64_t(info.node) << 32) | (uint64_t(info.package) << 16) | info.core;
+        int k = i - 1;
+        while (k >= 0) {
+            uint64_t kkey = (uint64_t(sibling[k]) << 48) | (uint64_t(cpus[k].node) << 32) |
+                (uint64_t(cpus[k].package) << 16) | cpus[k].core;
+            if (kkey < key || (kkey == key && cpus[k].cpu < info.cpu))
+                break;
+            cpus[k + 1] = cpus[k];
+            sibling[k + 1] = sibling[k];
+            k--;
+        }
+        cpus[k + 1] = info;
+        sibling[k + 1] = sib;
+    }
+
+    return numCpus;
+}
+
+// Locks the calling thread to a logical cpu
+static bool lockThreadToCpu(int cpu)
+{
+#if BX_PLATFORM_LINUX || BX_PLATFORM_ANDROID
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif BX_PLATFORM_WINDOWS
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#else
+    BX_UNUSED(cpu);
+    return false;
+#endif
+}
+
+static ThreadData* createThreadData(bx::AllocatorI* alloc, uint32_t threadId, bool main, uint32_t maxFibers)
 {
     ThreadData* data = BX_NEW(alloc, ThreadData);
     if (!data)
         return nullptr;
     data->main = main;
     data->threadId = threadId;
-    bx::memSet(data->stacks, 0x00, sizeof(fcontext_stack_t)*MAX_WAIT_STACKS);
+    data->rng = bx::RngMwc(12345 + threadId, 65435);
+
+    // Wait stacks are committed on first use, most threads only use a few of them
+    if (!data->stacks.create(MAX_WAIT_STACKS, WAIT_STACK_SIZE, alloc))
+        return nullptr;
 
-    for (int i = 0; i < MAX_WAIT_STACKS; i++) {
-        data->stacks[i] = create_fcontext_stack(WAIT_STACK_SIZE);
-        if (!data->stacks[i].sptr)
+    // Every queue must be able to hold all fibers, so pushes never fail
+    for (int i = 0; i < JobPriority::Count; i++) {
+        if (!data->deques[i].create(maxFibers, alloc))
             return nullptr;
     }
 
@@ -217,25 +984,46 @@ static ThreadData* createThreadData(bx::AllocatorI* alloc, uint32_t threadId, bo
 
 static void destroyThreadData(ThreadData* data, bx::AllocatorI* alloc)
 {
-    for (int i = 0; i < MAX_WAIT_STACKS; i++) {
-        if (data->stacks[i].sptr)
-            destroy_fcontext_stack(&data->stacks[i]);
-    }
+    data->stacks.destroy();
+    for (int i = 0; i < JobPriority::Count; i++)
+        data->deques[i].destroy(alloc);
     BX_DELETE(alloc, data);
 }
 
-static fcontext_stack_t* pushWaitStack(ThreadData* data)
+static bool pushWaitStack(ThreadData* data, fcontext_stack_t* stack)
 {
-    if (data->stackIdx == MAX_WAIT_STACKS)
-        return nullptr;
-    return &data->stacks[data->stackIdx++];
+    if (data->stackIdx == MAX_WAIT_STACKS || !data->stacks.commit(uint16_t(data->stackIdx)))
+        return false;
+    *stack = data->stacks.getStack(uint16_t(data->stackIdx++));
+    data->stats.maxWaitStacks = bx::max<uint32_t>(data->stats.maxWaitStacks, data->stackIdx);
+    return true;
 }
 
-static fcontext_stack_t* popWaitStack(ThreadData* data)
+static void popWaitStack(ThreadData* data)
 {
-    if (data->stackIdx == 0)
-        return nullptr;
-    return &data->stacks[--data->stackIdx];
+    if (data->stackIdx > 0)
+        --data->stackIdx;
+}
+
+// Called by the last finished job of the counter, wakes up all the threads that are waiting on it
+static void runContinuations(Continuation* cont);
+
+static void signalCounter(CounterContainer* container)
+{
+    container->lock.lock();
+    container->signaled = 1;
+    for (WaitNode* node = container->waiters; node; node = node->next)
+        node->semaphore->post();
+    container->waiters = nullptr;
+    Continuation* cont = container->continuations;
+    container->continuations = nullptr;
+    container->lock.unlock();
+
+    // Counters with continuations are owned by the dispatcher, so release it here
+    if (cont) {
+        gDispatcher->counterPool.deleteCounter(container, gDispatcher->counterPool.toHandle(container));
+        runContinuations(cont);
+    }
 }
 
 static void fiberCallback(fcontext_transfer_t transfer)
@@ -246,10 +1034,23 @@ static void fiberCallback(fcontext_transfer_t transfer)
     data->running = fiber;
 
     // Call user task callback
+#if RMT_ENABLED
+    if (gDispatcher->profileJobs) {
+        rmt_BeginCPUSample(Job, 0);
+        fiber->callback(fiber->jobIndex, fiber->userData);
+        rmt_EndCPUSample();
+    } else {
+        fiber->callback(fiber->jobIndex, fiber->userData);
+    }
+#else
     fiber->callback(fiber->jobIndex, fiber->userData);
+#endif
+
+    data->stats.numJobs++;
 
     // Job is finished
-    bx::atomicFetchAndSub(fiber->counter, 1);
+    if (bx::atomicSubAndFetch<int32_t>(fiber->counter, 1) == 0)
+        signalCounter((CounterContainer*)fiber->counter);
 
     data->running = nullptr;
 
@@ -263,18 +1064,30 @@ static void fiberCallback(fcontext_transfer_t transfer)
 Fiber* FiberPool::newFiber(JobCallback callbackFn, void* userData, uint16_t index, JobPriority::Enum priority, 
                            FiberPool* pool, JobCounter* counter)
 {
+    BX_ASSERT(pool == this);
+    BX_UNUSED(pool);
     bx::LockScope lk(m_lock);
-    if (m_index > 0) {
-        Fiber* fiber = BX_PLACEMENT_NEW(m_ptrs[--m_index], Fiber);
-        fiber->ownerThread = 0;
-        fiber->context = make_fcontext(m_stacks[fiber->stackIndex].sptr, m_stacks[fiber->stackIndex].ssize, fiberCallback);
+    return allocFiber(callbackFn, userData, index, priority, counter);
+}
+
+Fiber* FiberPool::allocFiber(JobCallback callbackFn, void* userData, uint16_t index, JobPriority::Enum priority, 
+                             JobCounter* counter)
+{
+    if (m_index > 0 || grow()) {
+        Fiber* fiber = m_ptrs[m_index - 1];
+        if (!m_stacks.commit(fiber->stackIndex))
+            return nullptr;
+
+        fiber = BX_PLACEMENT_NEW(m_ptrs[--m_index], Fiber);
+        m_peakCount = bx::max<uint16_t>(m_peakCount, getCount());
+        fcontext_stack_t stack = m_stacks.getStack(fiber->stackIndex);
+        fiber->context = make_fcontext(stack.sptr, stack.ssize, fiberCallback);
         fiber->callback = callbackFn;
         fiber->userData = userData;
         fiber->jobIndex = index;
-        fiber->waitCounter = &gDispatcher->dummyCounter;
         fiber->counter = counter;
         fiber->priority = priority;
-        fiber->ownerPool = pool;
+        fiber->ownerPool = this;
         return fiber;
     } else {
         return nullptr;
@@ -284,115 +1097,371 @@ Fiber* FiberPool::newFiber(JobCallback callbackFn, void* userData, uint16_t inde
 void FiberPool::deleteFiber(Fiber* fiber)
 {
     bx::LockScope lk(m_lock);
-    BX_ASSERT(m_index != m_maxFibers);
+    BX_ASSERT(m_index != m_numFibers);
     m_ptrs[m_index++] = fiber;
 }
 
+bool FiberPool::deferJob(const JobDesc& job, uint16_t index, JobCounter* counter)
+{
+    bx::LockScope lk(m_lock);
+    PendingJob* pj = m_pending.push();
+    if (!pj)
+        return false;
+    pj->job = job;
+    pj->index = index;
+    pj->counter = counter;
+    bx::atomicFetchAndAdd<int32_t>(&m_numPending, 1);
+    return true;
+}
+
+int FiberPool::newPendingFibers(Fiber** fibers, int maxFibers)
+{
+    bx::LockScope lk(m_lock);
+    int count = 0;
+    while (count < maxFibers && m_pendingHead < m_pending.getCount()) {
+        const PendingJob& pj = m_pending[m_pendingHead];
+        Fiber* fiber = allocFiber(pj.job.callback, pj.job.userParam, pj.index, pj.job.priority, pj.counter);
+        if (!fiber)
+            break;
+        fibers[count++] = fiber;
+        m_pendingHead++;
+    }
+
+    if (count > 0) {
+        bx::atomicFetchAndSub<int32_t>(&m_numPending, count);
+        if (m_pendingHead == m_pending.getCount()) {
+            m_pending.clear();
+            m_pendingHead = 0;
+        }
+    }
+    return count;
+}
+
+// Pulls a fiber from the local queues, or steals one from a random thread if they are empty
+// Higher priority jobs of other threads are always preferred over lower priority local jobs
+static Fiber* fetchFiber(ThreadData* data)
+{
+    uint8_t numVictims = gDispatcher->numThreadDatas;
+
+    for (int i = 0; i < JobPriority::Count; i++) {
+        Fiber* fiber = data->deques[i].pop();
+        if (fiber)
+            return fiber;
+
+        fiber = gDispatcher->injectQueues[i].pop();
+        if (fiber)
+            return fiber;
+
+        uint32_t start = data->rng.gen() % numVictims;
+        for (uint8_t k = 0; k < numVictims; k++) {
+            ThreadData* victim = gDispatcher->threadDatas[(start + k) % numVictims];
+            if (victim == data || victim->deques[i].isEmpty())
+                continue;
+
+            fiber = victim->deques[i].steal();
+            if (fiber) {
+                data->stats.numSteals++;
+                return fiber;
+            }
+            data->stats.numFailedSteals++;
+        }
+    }
+
+    return nullptr;
+}
+
+static bool hasPendingJobs()
+{
+    for (int k = 0; k < JobPriority::Count; k++) {
+        if (!gDispatcher->injectQueues[k].isEmpty())
+            return true;
+    }
+    for (uint8_t i = 0; i < gDispatcher->numThreadDatas; i++) {
+        ThreadData* data = gDispatcher->threadDatas[i];
+        for (int k = 0; k < JobPriority::Count; k++) {
+            if (!data->deques[k].isEmpty())
+                return true;
+        }
+    }
+    return false;
+}
+
+static void setIdle(ThreadData* data)
+{
+    bx::LockScope lk(gDispatcher->idleLock);
+    data->idle = true;
+    data->nextIdle = gDispatcher->idleList;
+    gDispatcher->idleList = data;
+    bx::atomicFetchAndAdd<int32_t>(&gDispatcher->numIdle, 1);
+}
+
+static void clearIdle(ThreadData* data)
+{
+    bx::LockScope lk(gDispatcher->idleLock);
+    if (!data->idle)
+        return;
+
+    ThreadData** pnext = &gDispatcher->idleList;
+    while (*pnext != data)
+        pnext = &(*pnext)->nextIdle;
+    *pnext = data->nextIdle;
+    data->nextIdle = nullptr;
+    data->idle = false;
+    bx::atomicFetchAndSub<int32_t>(&gDispatcher->numIdle, 1);
+}
+
+// Wakes up to 'count' sleeping threads, so they can steal newly pushed jobs
+static void wakeIdleThreads(uint32_t count)
+{
+    if (gDispatcher->numIdle == 0)
+        return;
+
+    ThreadData* wakeList = nullptr;
+    gDispatcher->idleLock.lock();
+    while (count > 0 && gDispatcher->idleList) {
+        ThreadData* data = gDispatcher->idleList;
+        gDispatcher->idleList = data->nextIdle;
+        data->idle = false;
+        data->nextIdle = wakeList;
+        wakeList = data;
+        bx::atomicFetchAndSub<int32_t>(&gDispatcher->numIdle, 1);
+        count--;
+    }
+    gDispatcher->idleLock.unlock();
+
+    while (wakeList) {
+        ThreadData* next = wakeList->nextIdle;
+        wakeList->nextIdle = nullptr;
+        wakeList->semaphore.post();
+        wakeList = next;
+    }
+}
+
+static void addIdleTime(ThreadData* data, int64_t ticks)
+{
+    data->stats.idleTime += ticks;
+
+    // Histogram buckets: 16us, 64us, 256us, 1ms, ...
+    int64_t us = ticks * 1000000 / bx::getHPFrequency();
+    int bucket = 0;
+    for (int64_t edge = 16; us >= edge && bucket < kJobIdleHistogramSize - 1; edge *= 4)
+        bucket++;
+    data->stats.idleHistogram[bucket]++;
+}
+
+static void schedulePendingJobs(FiberPool* pool, ThreadData* data);
+
 static void jobPusherCallback(fcontext_transfer_t transfer)
 {
     ThreadData* data = (ThreadData*)transfer.data;
 
+    // The counter that the 'waitAndDeleteJob' call which created this context is waiting on
+    // Null if this is the root context of a worker thread, which runs until the dispatcher stops
+    CounterContainer* waitCounter = data->waitCounters[data->stackIdx - 1];
+
     while (!gDispatcher->stop) {
-        // Wait for a job to be placed in the job queue
-        if (!data->main)
-            gDispatcher->semaphore.wait();     // Decreases list counter on continue
-
-        Fiber* fiber = nullptr;
-        bool listNotEmpty = false;
-        gDispatcher->jobLock.lock();
-        {
-            for (int i = 0; i < JobPriority::Count && !fiber; i++) {
-                bx::List<Fiber*>& list = gDispatcher->waitList[i];
-                Fiber::LNode* node = list.getFirst();
-                while (node) {
-                    listNotEmpty = true;
-                    Fiber* f = node->data;
-                    if (*f->waitCounter == 0) {     // Fiber is not waiting for any child tasks
-                        if (f->ownerThread == 0 || f->ownerThread == data->threadId) {
-                            // Job is ready to run, pull it from the wait list
-                            fiber = f;
-                            list.remove(node);
-                            break;
-                        }
-                    }
-                    node = node->next;
-                }
-            }
-        }
-        gDispatcher->jobLock.unlock();
+        // If the counter is signaled, get back to the waiting context, which should be the same working thread
+        if (waitCounter && waitCounter->signaled)
+            break;
 
+        // Else just run a new job from beginning
+        Fiber* fiber = fetchFiber(data);
         if (fiber) {
-            // If jobPusher is called within another 'Wait' call, get back to it's context, which should be the same working thread
-            // Else just run the job from beginning
-            if (fiber->ownerThread) {
-                fiber->ownerThread = 0;
-                jump_fcontext(transfer.ctx, transfer.data);
-            } else {
-                jump_fcontext(fiber->context, fiber);
-            }
-        } else if (!data->main && listNotEmpty) {
-            gDispatcher->semaphore.post(); // Increase the list counter because we didn't pull any jobs
+            jump_fcontext(fiber->context, fiber);
+
+            // The fiber may be released, start the jobs that are waiting for one
+            // It's done here, because the released fiber's stack is not in use anymore
+            schedulePendingJobs(&gDispatcher->smallFibers, data);
+            schedulePendingJobs(&gDispatcher->bigFibers, data);
+            continue;
         }
 
-        // In the main thread, we have to quit the loop and get back to the caller
-        if (data->main)
-            break;
+        // Nothing to do, sleep until new jobs are dispatched or the counter is signaled
+        // Check again after registering as idle, so we won't miss any jobs pushed in between
+        setIdle(data);
+        if (!gDispatcher->stop && !(waitCounter && waitCounter->signaled) && !hasPendingJobs()) {
+            int64_t idleStart = bx::getHPCounter();
+            data->semaphore.wait();
+            addIdleTime(data, bx::getHPCounter() - idleStart);
+        }
+        clearIdle(data);
     }
 
-    // Back to main thread func
+    // Back to waiting context or thread func
     jump_fcontext(transfer.ctx, transfer.data);
 }
 
-static JobHandle dispatch(const JobDesc* jobs, uint16_t numJobs, FiberPool* pool) TEE_THREAD_SAFE
+// Pushes fibers to the caller's local queues and wakes up idle threads to steal them
+// Threads that are not owned by the dispatcher don't have local queues, so they use the shared ones
+static void submitFibers(ThreadData* data, Fiber** fibers, uint32_t count)
 {
-    // Get dispatcher counter to assign to jobs
-    ThreadData* data = (ThreadData*)gDispatcher->threadData.get();
-
-    // Get a counter
-    gDispatcher->counterLock.lock();
-    JobCounter* counter = &gDispatcher->counterPool.newInstance()->counter;
-    gDispatcher->counterLock.unlock();
-    if (!counter) {
-        BX_WARN("Exceeded maximum jobCounters (Max = %d)", gDispatcher->counterPool.getMaxItems());
-        return nullptr;
+    for (uint32_t i = 0; i < count; i++) {
+        Fiber* fiber = fibers[i];
+        if (!data || !data->deques[fiber->priority].push(fiber)) {
+            bool r = gDispatcher->injectQueues[fiber->priority].push(fiber);
+            BX_ASSERT(r);
+            BX_UNUSED(r);
+        }
     }
 
+    // Wake up sleeping threads so they can steal them
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wakeIdleThreads(count);
+}
+
+// Starts the jobs that are waiting for free fibers of the pool
+static void schedulePendingJobs(FiberPool* pool, ThreadData* data)
+{
+    Fiber* fibers[32];
+    int count;
+    while (pool->hasPendingJobs() && (count = pool->newPendingFibers(fibers, BX_COUNTOF(fibers))) > 0)
+        submitFibers(data, fibers, uint32_t(count));
+}
+
+// Creates fibers for jobs and pushes them to the caller's queues
+// If the pool is exhausted, jobs wait in the pool and start when fibers are released
+// Returns the number of jobs that are pushed or deferred, the rest (out of memory) are not started
+// Counter must be set before the call, jobs may start and decrement it right away
+static uint32_t pushJobs(const JobDesc* jobs, uint16_t numJobs, FiberPool* pool, JobCounter* counter)
+{
+    ThreadData* data = (ThreadData*)gDispatcher->threadData.get();
+
     // Create N Fibers/Job
     uint32_t count = 0;
     Fiber** fibers = (Fiber**)alloca(sizeof(Fiber*)*numJobs);
     BX_ASSERT(fibers);
 
-    for (uint16_t i = 0; i < numJobs; i++) {
-        Fiber* fiber = pool->newFiber(jobs[i].callback, jobs[i].userParam, i, jobs[i].priority, pool, counter);
+    // Jobs that are already waiting go first, so new jobs are deferred behind them
+    bool deferred = pool->hasPendingJobs();
+    uint16_t i;
+    for (i = 0; i < numJobs; i++) {
+        Fiber* fiber = !deferred ? pool->newFiber(jobs[i].callback, jobs[i].userParam, i, jobs[i].priority, pool, counter) :
+                                   nullptr;
         if (fiber) {
-            fibers[i] = fiber;
-            count++;
+            fibers[count++] = fiber;
+        } else if (pool->deferJob(jobs[i], i, counter)) {
+            deferred = true;
         } else {
-            BX_WARN("Exceeded maximum jobs (Max = %d)", pool->getMax());
+            BX_WARN("Out of memory for pending jobs");
+            break;
         }
     }
 
-    if (count > 0) {
-        *counter = count;
-        BX_ASSERT(data);       // Must be called within main or job_dispatcher threads only
-        if (data->running)
-            data->running->waitCounter = counter;
-
-        gDispatcher->jobLock.lock();
-        for (uint32_t i = 0; i < count; i++)
-            gDispatcher->waitList[fibers[i]->priority].addToEnd(&fibers[i]->lnode);
-        gDispatcher->jobLock.unlock();
-
-        // post to semaphore so worker threads can continue and fetch them
-        gDispatcher->semaphore.post(count);
-    } else {
-        // No job created ...
-        bx::LockScope lock(gDispatcher->counterLock);
-        gDispatcher->counterPool.deleteInstance((CounterContainer*)counter);
-        counter = nullptr;
+    if (count > 0)
+        submitFibers(data, fibers, count);
+
+    // A fiber may be released before the jobs are deferred, in that case no one else starts them
+    if (deferred)
+        schedulePendingJobs(pool, data);
+
+    return i;
+}
+
+// Jobs that can't even be queued (out of memory) are run on the calling thread, so their work and the
+// payloads they own are never lost, and the counter's dependents still run
+static void runJobsInline(const JobDesc* jobs, uint16_t first, uint16_t numJobs, CounterContainer* container)
+{
+    if (first >= numJobs)
+        return;
+
+    BX_WARN("Running %d jobs on the calling thread", numJobs - first);
+    for (uint16_t i = first; i < numJobs; i++)
+        jobs[i].callback(i, jobs[i].userParam);
+
+    if (bx::atomicSubAndFetch<int32_t>(&container->counter, int32_t(numJobs - first)) == 0)
+        signalCounter(container);
+}
+
+static JobHandle dispatch(const JobDesc* jobs, uint16_t numJobs, FiberPool* pool) TEE_THREAD_SAFE
+{
+    // Get a counter
+    CounterContainer* container = gDispatcher->counterPool.newCounter();
+    if (!container) {
+        BX_WARN("Exceeded maximum jobCounters (Max = %d)", gDispatcher->counterPool.getMax());
+        return JobHandle();
     }
+    JobHandle handle = gDispatcher->counterPool.toHandle(container);
+
+    container->counter = numJobs;
+    uint32_t count = pushJobs(jobs, numJobs, pool, &container->counter);
+    runJobsInline(jobs, uint16_t(count), numJobs, container);
 
-    return counter;
+    return handle;
+}
+
+static void runContinuations(Continuation* cont)
+{
+    while (cont) {
+        Continuation* next = cont->next;
+        CounterContainer* target = cont->target;
+
+        // Continuation jobs are never dropped, the ones that can't be queued run right here
+        // When-all continuations just take the finished dependency from the target counter
+        if (cont->pool) {
+            uint32_t count = pushJobs(cont->jobs, cont->numJobs, cont->pool, &target->counter);
+            runJobsInline(cont->jobs, uint16_t(count), cont->numJobs, target);
+        } else if (bx::atomicSubAndFetch<int32_t>(&target->counter, 1) == 0) {
+            signalCounter(target);
+        }
+
+        BX_FREE(gDispatcher->alloc, cont);
+        cont = next;
+    }
+}
+
+// Runs the continuation when the dependency is signaled, or right away if it's already done (or an invalid handle)
+static void addContinuation(JobHandle dep, Continuation* cont)
+{
+    CounterContainer* container = dep.isValid() ? gDispatcher->counterPool.fromHandle(dep) : nullptr;
+    if (container) {
+        // Counter may be released and recycled before we take the lock, so check the generation again
+        container->lock.lock();
+        bool valid = container->generation == (uint32_t(dep) >> 16);
+        bool pending = valid && !container->signaled;
+        if (pending) {
+            cont->next = container->continuations;
+            container->continuations = cont;
+        }
+        container->lock.unlock();
+
+        if (pending)
+            return;
+
+        // Dependency is consumed, even if it's already done
+        if (valid)
+            gDispatcher->counterPool.deleteCounter(container, dep);
+    }
+    runContinuations(cont);
+}
+
+static JobHandle dispatchAfter(JobHandle dep, const JobDesc* jobs, uint16_t numJobs, FiberPool* pool) TEE_THREAD_SAFE
+{
+    if (numJobs == 0)
+        return JobHandle();
+
+    CounterContainer* container = gDispatcher->counterPool.newCounter();
+    if (!container) {
+        BX_WARN("Exceeded maximum jobCounters (Max = %d)", gDispatcher->counterPool.getMax());
+        return JobHandle();
+    }
+    JobHandle handle = gDispatcher->counterPool.toHandle(container);
+
+    // Jobs are copied, fibers are created when the dependency is done
+    Continuation* cont = (Continuation*)BX_ALLOC(gDispatcher->alloc, sizeof(Continuation) + sizeof(JobDesc)*numJobs);
+    if (!cont) {
+        gDispatcher->counterPool.deleteCounter(container, handle);
+        return JobHandle();
+    }
+    cont->target = container;
+    cont->pool = pool;
+    cont->jobs = (JobDesc*)(cont + 1);
+    cont->numJobs = numJobs;
+    cont->next = nullptr;
+    bx::memCopy(cont->jobs, jobs, sizeof(JobDesc)*numJobs);
+
+    container->counter = numJobs;
+    addContinuation(dep, cont);
+    return handle;
 }
 
 JobHandle tee::dispatchSmallJobs(const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE
@@ -405,79 +1474,194 @@ JobHandle tee::dispatchBigJobs(const JobDesc* jobs, uint16_t numJobs) TEE_THREAD
     return dispatch(jobs, numJobs, &gDispatcher->bigFibers);
 }
 
+JobHandle tee::dispatchSmallJobsAfter(JobHandle dep, const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE
+{
+    return dispatchAfter(dep, jobs, numJobs, &gDispatcher->smallFibers);
+}
+
+JobHandle tee::dispatchBigJobsAfter(JobHandle dep, const JobDesc* jobs, uint16_t numJobs) TEE_THREAD_SAFE
+{
+    return dispatchAfter(dep, jobs, numJobs, &gDispatcher->bigFibers);
+}
+
+JobHandle tee::whenAll(const JobHandle* deps, uint16_t numDeps) TEE_THREAD_SAFE
+{
+    CounterContainer* container = gDispatcher->counterPool.newCounter();
+    if (!container) {
+        BX_WARN("Exceeded maximum jobCounters (Max = %d)", gDispatcher->counterPool.getMax());
+        return JobHandle();
+    }
+    JobHandle handle = gDispatcher->counterPool.toHandle(container);
+
+    if (numDeps == 0) {
+        container->signaled = 1;
+        return handle;
+    }
+
+    // Counter is the number of remaining dependencies, Plus one so it's not signaled before all of them are added
+    container->counter = numDeps + 1;
+    for (uint16_t i = 0; i < numDeps; i++) {
+        Continuation* cont = (Continuation*)BX_ALLOC(gDispatcher->alloc, sizeof(Continuation));
+        if (!cont) {
+            if (bx::atomicSubAndFetch<int32_t>(&container->counter, 1) == 0)
+                signalCounter(container);
+            continue;
+        }
+        cont->target = container;
+        cont->pool = nullptr;
+        cont->jobs = nullptr;
+        cont->numJobs = 0;
+        cont->next = nullptr;
+        addContinuation(deps[i], cont);
+    }
+
+    if (bx::atomicSubAndFetch<int32_t>(&container->counter, 1) == 0)
+        signalCounter(container);
+    return handle;
+}
+
+// Blocks the thread until the counter is signaled, used where the thread can't run other jobs in the meantime
+// After it returns, the signaling thread is done with the counter's waiters, so the counter can be released
+static void waitForSignal(CounterContainer* container)
+{
+    bx::Semaphore semaphore;
+    WaitNode node;
+    node.semaphore = &semaphore;
+
+    container->lock.lock();
+    bool parked = !container->signaled;
+    if (parked) {
+        node.next = container->waiters;
+        container->waiters = &node;
+    }
+    container->lock.unlock();
+
+    if (parked) {
+        while (!container->signaled)
+            semaphore.wait();
+    }
+
+    // signalCounter posts the waiters with the lock held, wait for it to finish before the semaphore goes away
+    container->lock.lock();
+    container->lock.unlock();
+}
+
+static CounterContainer* getCounter(JobHandle handle)
+{
+    CounterContainer* container = gDispatcher->counterPool.fromHandle(handle);
+    if (!container)
+        BX_WARN("Invalid or stale JobHandle (0x%x)", uint32_t(handle));
+    return container;
+}
+
+static void deleteCounter(CounterContainer* container, JobHandle handle)
+{
+    if (!gDispatcher->counterPool.deleteCounter(container, handle))
+        BX_WARN("JobHandle (0x%x) is already deleted", uint32_t(handle));
+}
+
 void tee::waitAndDeleteJob(JobHandle handle) TEE_THREAD_SAFE
 {
     ThreadData* data = (ThreadData*)gDispatcher->threadData.get();
+    CounterContainer* container = getCounter(handle);
+    if (!container)
+        return;
 
-    while (*handle > 0) {
-        // Jump back to worker thread (current job is not finished)
-        fcontext_stack_t* stack = pushWaitStack(data);
-        if (!stack) {
+    if (!container->signaled && !data) {
+        // Threads that are not owned by the dispatcher can't run jobs, just wait for the workers
+        waitForSignal(container);
+    } else if (!container->signaled) {
+        fcontext_stack_t stack;
+        if (!pushWaitStack(data, &stack)) {
             BX_WARN("Maximum wait stacks '%d' exceeded. Cannot wait", MAX_WAIT_STACKS);
             return;
         }
 
-        fcontext_t jobPusherCtx = make_fcontext(stack->sptr, stack->ssize, jobPusherCallback);
+        // Park this thread on the counter, the last finished job wakes it up
+        WaitNode node;
+        node.semaphore = &data->semaphore;
+        container->lock.lock();
+        bool parked = !container->signaled;
+        if (parked) {
+            node.next = container->waiters;
+            container->waiters = &node;
+        }
+        container->lock.unlock();
 
-        // This means that user has called 'waitJobs' inside another running task
-        // So the task is WIP, we have to re-add it to the pending jobs so it can continue later on
-        if (data->running) {
+        if (parked) {
+            // This means that user has called 'waitJobs' inside another running task
+            // So the task is WIP, it's suspended and the job-pusher of this thread gets back to it when the counter is signaled
             Fiber* fiber = data->running;
             data->running = nullptr;
-            fiber->ownerThread = data->threadId;
-
-            gDispatcher->jobLock.lock();
-            gDispatcher->waitList[fiber->priority].addToEnd(&fiber->lnode);
-            gDispatcher->jobLock.unlock();
-
-            gDispatcher->semaphore.post();
+            data->waitCounters[data->stackIdx - 1] = container;
+            if (fiber)
+                data->stats.numBlocked++;
+
+            // Switch to job-pusher To process remaining jobs until the counter is signaled
+            fcontext_t jobPusherCtx = make_fcontext(stack.sptr, stack.ssize, jobPusherCallback);
+            jump_fcontext(jobPusherCtx, data);
+
+            data->waitCounters[data->stackIdx - 1] = nullptr;
+            data->running = fiber;
+            if (fiber)
+                data->stats.numBlocked--;
         }
-
-        // Switch to job-pusher To see if we can process any remaining jobs
-        jump_fcontext(jobPusherCtx, data);
         popWaitStack(data);
 
-        bx::yield();
+        // Dispatcher is stopped, leave the counter alive
+        if (!container->signaled)
+            return;
     }
 
     // Delete the counter
-    gDispatcher->counterLock.lock();
-    gDispatcher->counterPool.deleteInstance((CounterContainer*)handle);
-    gDispatcher->counterLock.unlock();
+    waitForSignal(container);
+    deleteCounter(container, handle);
 }
 
 bool tee::isJobDone(JobHandle handle) TEE_THREAD_SAFE
 {
-    return *handle == 0;
+    // Stale handles are reported as done, the job they refer to is finished and deleted long ago
+    CounterContainer* container = getCounter(handle);
+    return container ? container->signaled != 0 : true;
 }
 
 void tee::deleteJob(JobHandle handle) TEE_THREAD_SAFE
 {
-    gDispatcher->counterLock.lock();
-    gDispatcher->counterPool.deleteInstance((CounterContainer*)handle);
-    gDispatcher->counterLock.unlock();
+    CounterContainer* container = getCounter(handle);
+    if (!container)
+        return;
+    if (container->counter == 0)
+        waitForSignal(container);
+    deleteCounter(container, handle);
 }
 
 static int32_t threadFunc(bx::Thread* self, void* userData)
 {
-    // Initialize thread data
-    ThreadData* data = createThreadData(gDispatcher->alloc, bx::getTid(), false);
-    if (!data)
-        return -1;
+    // Thread data is created by the dispatcher, so other threads can steal from it's queues right away
+    ThreadData* data = (ThreadData*)userData;
+    data->threadId = bx::getTid();
     gDispatcher->threadData.set(data);     
 
-    fcontext_stack_t* stack = pushWaitStack(data);
-    fcontext_t threadCtx = make_fcontext(stack->sptr, stack->ssize, jobPusherCallback);
+    if (data->cpu >= 0 && !lockThreadToCpu(data->cpu)) {
+        BX_WARN("Could not lock job thread to cpu %d", data->cpu);
+        data->cpu = -1;
+    }
+
+    fcontext_stack_t stack;
+    if (!pushWaitStack(data, &stack)) {
+        BX_WARN("Could not commit wait stack for job thread");
+        return -1;
+    }
+    fcontext_t threadCtx = make_fcontext(stack.sptr, stack.ssize, jobPusherCallback);
     jump_fcontext(threadCtx, data);
 
-    destroyThreadData(data, gDispatcher->alloc);
     return 0;
 }
 
 bool tee::initJobDispatcher(bx::AllocatorI* alloc, 
                             uint16_t maxSmallFibers, uint32_t smallFiberStackSize, 
                             uint16_t maxBigFibers, uint32_t bigFiberStackSize, 
-                            bool lockThreadsToCores, uint8_t numThreads)
+                            bool lockThreadsToCores, uint8_t numThreads, uint8_t numReservedCores)
 {
     if (gDispatcher) {
         BX_ASSERT(false);
@@ -494,20 +1678,28 @@ bool tee::initJobDispatcher(bx::AllocatorI* alloc,
         return false;
     }
 
-    ThreadData* mainData = createThreadData(alloc, bx::getTid(), true);
-    if (!mainData)
-        return false;
-    gDispatcher->threadData.set(mainData);
-
     // Create fibers with stack memories
     maxSmallFibers = maxSmallFibers ? maxSmallFibers : DEFAULT_MAX_SMALL_FIBERS;
     maxBigFibers = maxBigFibers ? maxBigFibers : DEFAULT_MAX_BIG_FIBERS;
     smallFiberStackSize = smallFiberStackSize ? smallFiberStackSize : DEFAULT_SMALL_STACKSIZE;
     bigFiberStackSize = bigFiberStackSize ? bigFiberStackSize : DEFAULT_BIG_STACKSIZE;
 
-    if (!gDispatcher->counterPool.create(maxSmallFibers + maxBigFibers, alloc) ||
-        !gDispatcher->bigFibers.create(maxBigFibers, bigFiberStackSize, alloc) ||
-        !gDispatcher->smallFibers.create(maxSmallFibers, smallFiberStackSize, alloc)) 
+    // Pools start with the requested number of fibers and grow on demand up to the reserved size
+    // Only address space is reserved for the extra fibers, stacks are committed on first use
+    uint16_t reservedSmallFibers = (uint16_t)bx::min<uint32_t>(maxSmallFibers*FIBER_POOL_RESERVE_FACTOR, UINT16_MAX);
+    uint16_t reservedBigFibers = (uint16_t)bx::min<uint32_t>(maxBigFibers*FIBER_POOL_RESERVE_FACTOR, UINT16_MAX);
+
+    // Every dispatch takes one counter, so there can't be more counters than fibers
+    uint16_t maxCounters = (uint16_t)bx::min<uint32_t>(reservedSmallFibers + reservedBigFibers, UINT16_MAX);
+
+    for (int i = 0; i < JobPriority::Count; i++) {
+        if (!gDispatcher->injectQueues[i].create(uint32_t(reservedSmallFibers) + reservedBigFibers, alloc))
+            return false;
+    }
+
+    if (!gDispatcher->counterPool.create(maxCounters, alloc) ||
+        !gDispatcher->bigFibers.create(maxBigFibers, reservedBigFibers, bigFiberStackSize, alloc) ||
+        !gDispatcher->smallFibers.create(maxSmallFibers, reservedSmallFibers, smallFiberStackSize, alloc)) 
     {
         return false;
     }
@@ -515,11 +1707,53 @@ bool tee::initJobDispatcher(bx::AllocatorI* alloc,
     // Create threads
     uint16_t numCores = numThreads;
     if (numThreads == UINT8_MAX) {
+        // Reserved cores are left for main thread (and render thread, etc.)
         numCores = bx::min<uint16_t>(getHardwareInfo().numCores, UINT8_MAX);
-        numCores = numCores ? (numCores - 1) : 0;   // NumThreads is always one less than number of cores
+        numCores = numCores > numReservedCores ? (numCores - numReservedCores) : 0;
     }
     numThreads = (uint8_t)bx::min<uint16_t>(numCores, numThreads);
 
+    // Thread data for main thread and all worker threads
+    uint32_t maxFibers = reservedSmallFibers + reservedBigFibers;
+    gDispatcher->threadDatas = (ThreadData**)BX_ALLOC(alloc, sizeof(ThreadData*)*(numThreads + 1));
+    if (!gDispatcher->threadDatas)
+        return false;
+    bx::memSet(gDispatcher->threadDatas, 0x00, sizeof(ThreadData*)*(numThreads + 1));
+
+    for (uint16_t i = 0; i <= numThreads; i++) {
+        ThreadData* data = createThreadData(alloc, i == 0 ? bx::getTid() : i, i == 0, maxFibers);
+        if (!data)
+            return false;
+        gDispatcher->threadDatas[i] = data;
+        gDispatcher->numThreadDatas++;
+    }
+    gDispatcher->threadData.set(gDispatcher->threadDatas[0]);
+
+    // Main thread takes the first cpu, workers start after the reserved ones
+    // Worker threads lock themselves when they start
+    if (lockThreadsToCores) {
+        CpuInfo cpus[MAX_CPUS];
+        int numCpus = getCpuTopology(cpus, MAX_CPUS);
+        if (numCpus > 0) {
+            ThreadData* mainData = gDispatcher->threadDatas[0];
+            if (lockThreadToCpu(cpus[0].cpu))
+                mainData->cpu = int16_t(cpus[0].cpu);
+            else
+                BX_WARN("Could not lock main thread to cpu %d", cpus[0].cpu);
+
+            int first = numReservedCores < numCpus ? numReservedCores : 0;
+            for (uint16_t i = 1; i <= numThreads; i++)
+                gDispatcher->threadDatas[i]->cpu = int16_t(cpus[(first + i - 1) % numCpus].cpu);
+        } else {
+            BX_WARN("Cpu topology is not available, job threads are not locked to cores");
+        }
+    }
+
+    gDispatcher->threadStats = (JobThreadStats*)BX_ALLOC(alloc, sizeof(JobThreadStats)*gDispatcher->numThreadDatas);
+    if (!gDispatcher->threadStats)
+        return false;
+    gDispatcher->statsResetTime = bx::getHPCounter();
+
     if (numThreads > 0) {
         gDispatcher->threads = (bx::Thread**)BX_ALLOC(alloc, sizeof(bx::Thread*)*numThreads);
         BX_ASSERT(gDispatcher->threads);
@@ -529,7 +1763,7 @@ bool tee::initJobDispatcher(bx::AllocatorI* alloc,
             gDispatcher->threads[i] = BX_NEW(alloc, bx::Thread);
             char name[32];
             bx::snprintf(name, sizeof(name), "TJobThread #%d", i + 1);
-            gDispatcher->threads[i]->init(threadFunc, nullptr, 32 * 1024, name);
+            gDispatcher->threads[i]->init(threadFunc, gDispatcher->threadDatas[i + 1], 32 * 1024, name);
         }
     }
     return true;
@@ -542,21 +1776,28 @@ void tee::shutdownJobDispatcher()
 
     // Command all worker threads to stop
     gDispatcher->stop = 1;
-    gDispatcher->semaphore.post(gDispatcher->numThreads + 1);
+    for (uint8_t i = 0; i < gDispatcher->numThreadDatas; i++)
+        gDispatcher->threadDatas[i]->semaphore.post();
     for (uint8_t i = 0; i < gDispatcher->numThreads; i++) {
         gDispatcher->threads[i]->shutdown();
         BX_DELETE(gDispatcher->alloc, gDispatcher->threads[i]);
     }
     BX_FREE(gDispatcher->alloc, gDispatcher->threads);
 
-    ThreadData* data = (ThreadData*)gDispatcher->threadData.get();
-    destroyThreadData(data, gDispatcher->alloc);
+    for (uint8_t i = 0; i < gDispatcher->numThreadDatas; i++)
+        destroyThreadData(gDispatcher->threadDatas[i], gDispatcher->alloc);
+    if (gDispatcher->threadDatas)
+        BX_FREE(gDispatcher->alloc, gDispatcher->threadDatas);
+    if (gDispatcher->threadStats)
+        BX_FREE(gDispatcher->alloc, gDispatcher->threadStats);
 
     gDispatcher->bigFibers.destroy();
     gDispatcher->smallFibers.destroy();
     destroy_fcontext_stack(&gDispatcher->mainStack);
 
     gDispatcher->counterPool.destroy();
+    for (int i = 0; i < JobPriority::Count; i++)
+        gDispatcher->injectQueues[i].destroy(gDispatcher->alloc);
 
     BX_DELETE(gDispatcher->alloc, gDispatcher);
     gDispatcher = nullptr;
@@ -566,3 +1807,60 @@ uint8_t tee::getNumWorkerThreads()
 {
 	return gDispatcher->numThreads;
 }
+
+const JobDispatcherStats& tee::getJobDispatcherStats()
+{
+    JobDispatcherStats& stats = gDispatcher->stats;
+    stats.elapsedTime = bx::getHPCounter() - gDispatcher->statsResetTime;
+    stats.timerFreq = bx::getHPFrequency();
+
+    stats.numSmallFibers = gDispatcher->smallFibers.getCount();
+    stats.peakSmallFibers = gDispatcher->smallFibers.getPeak();
+    stats.maxSmallFibers = gDispatcher->smallFibers.getMax();
+    stats.poolSmallFibers = gDispatcher->smallFibers.getSize();
+    stats.committedSmallStacks = gDispatcher->smallFibers.getNumCommittedStacks();
+    stats.numBigFibers = gDispatcher->bigFibers.getCount();
+    stats.peakBigFibers = gDispatcher->bigFibers.getPeak();
+    stats.maxBigFibers = gDispatcher->bigFibers.getMax();
+    stats.poolBigFibers = gDispatcher->bigFibers.getSize();
+    stats.committedBigStacks = gDispatcher->bigFibers.getNumCommittedStacks();
+    stats.maxWaitStacks = MAX_WAIT_STACKS;
+
+    for (uint8_t i = 0; i < gDispatcher->numThreadDatas; i++) {
+        ThreadData* data = gDispatcher->threadDatas[i];
+        JobThreadStats& tstats = gDispatcher->threadStats[i];
+        bx::memCopy(&tstats, &data->stats, sizeof(tstats));
+        tstats.threadId = data->threadId;
+        tstats.cpu = data->cpu;
+        for (int k = 0; k < JobPriority::Count; k++)
+            tstats.queueDepth[k] = (uint32_t)data->deques[k].getCount();
+    }
+    stats.numThreads = gDispatcher->numThreadDatas;
+    stats.threads = gDispatcher->threadStats;
+
+    return stats;
+}
+
+void tee::resetJobDispatcherStats()
+{
+    for (uint8_t i = 0; i < gDispatcher->numThreadDatas; i++) {
+        JobThreadStats& tstats = gDispatcher->threadDatas[i]->stats;
+        uint32_t numBlocked = tstats.numBlocked;
+        bx::memSet(&tstats, 0x00, sizeof(tstats));
+        tstats.numBlocked = numBlocked;     // Not a cumulative value
+    }
+    gDispatcher->smallFibers.resetPeak();
+    gDispatcher->bigFibers.resetPeak();
+    gDispatcher->statsResetTime = bx::getHPCounter();
+}
+
+void tee::setJobProfiling(bool enable)
+{
+    gDispatcher->profileJobs = enable ? 1 : 0;
+}
+
+void tee::releaseIdleFiberStacks()
+{
+    gDispatcher->smallFibers.releaseIdleStacks();
+    gDispatcher->bigFibers.releaseIdleStacks();
+}
@@ -20,6 +20,19 @@ namespace tee
         bool loadObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override;
         void unloadObj(uintptr_t obj, bx::AllocatorI* alloc) override;
         void onReload(AssetHandle handle, bx::AllocatorI* alloc) override {}
+
+        // Whole load is thread-safe (heap memory only), so decode does it all and finalize just passes the object
+        bool canDecode(const AssetParams& params, bx::AllocatorI* alloc) override { return alloc == nullptr; }
+        bool decodeObj(const MemoryBlock* mem, const AssetParams& params, uintptr_t* decoded, bx::AllocatorI* alloc) override
+        {
+            return loadObj(mem, params, decoded, alloc);
+        }
+        bool finalizeObj(uintptr_t decoded, const AssetParams& params, uintptr_t* obj, bx::AllocatorI* alloc) override
+        {
+            *obj = decoded;
+            return true;
+        }
+        void releaseDecoded(uintptr_t decoded, bx::AllocatorI* alloc) override { unloadObj(decoded, alloc); }
     };
 
     //
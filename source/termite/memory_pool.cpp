@@ -4,36 +4,39 @@
 #include <inttypes.h>
 
 #include "bx/cpu.h"
+#include "bx/thread.h"
 #include "bxx/lock.h"
 #include "bxx/linked_list.h"
-#include "bxx/pool.h"
 #include "bxx/linear_allocator.h"
 #include "bx/string.h"
 
 #define TEE_IMGUI_API
 #include "plugin_api.h"
 
+#include <atomic>
+
 using namespace tee;
 
 #define DEFAULT_MAX_PAGES_PER_POOL 32     // 32 pages per pool
 #define DEFAULT_PAGE_SIZE 2*1024*1024     // 2MB
+#define MAX_MEM_TAGS 1024                 // Must be power of two
+#define PAGE_CACHE_BATCH 4                // Pages that are moved between thread caches and buckets at once
+#define PAGE_CACHE_MAX 8                  // Thread cache returns a batch to buckets when it has more than this
 
 struct PageBucket;
 
 struct MemoryPage
 {
-    typedef bx::List<MemoryPage*>::Node LNode;
-
     uint64_t tag;
     PageBucket* owner;
     bx::LinearAllocator linAlloc;
-    LNode lnode;
+    MemoryPage* next;       // Next page with the same tag, or next free page in thread cache
 
     MemoryPage(void* buff, size_t size) :
         tag(0),
         owner(nullptr),
         linAlloc(buff, size),
-        lnode(this)
+        next(nullptr)
     {
     }
 };
@@ -56,6 +59,23 @@ struct PageBucket
     }
 };
 
+// Open addressing hash table (tag -> pages), slots are never removed, so lookups and inserts are lock-free
+// Tags are few and reused (per frame, per level, ...), so the table doesn't fill up in practice
+struct TagSlot
+{
+    std::atomic<uint64_t> tag;      // 0 means empty
+    std::atomic<MemoryPage*> pages;
+};
+
+// Free pages owned by a thread, allocations are served from here without touching the global lock
+// Caches live until shutdown, engine threads are not recreated
+struct PageCache
+{
+    MemoryPage* pages[PAGE_CACHE_MAX + PAGE_CACHE_BATCH];
+    int count;
+    PageCache* next;
+};
+
 struct MemoryPool
 {
     bx::AllocatorI* alloc;
@@ -63,8 +83,10 @@ struct MemoryPool
     volatile int32_t numPages;
     size_t pageSize;
     bx::List<PageBucket*> bucketList;
-    bx::List<MemoryPage*> pageList;
-    bx::Lock lock;
+    bx::Lock lock;          // Protects buckets and cache list
+    TagSlot tags[MAX_MEM_TAGS];
+    PageCache* caches;
+    bx::TlsData cache;
 
     MemoryPool()
     {
@@ -72,6 +94,11 @@ struct MemoryPool
         maxPagesPerBucket = 0;
         numPages = 0;
         pageSize = 0;
+        caches = nullptr;
+        for (int i = 0; i < MAX_MEM_TAGS; i++) {
+            tags[i].tag.store(0, std::memory_order_relaxed);
+            tags[i].pages.store(nullptr, std::memory_order_relaxed);
+        }
     }
 };
 
@@ -141,6 +168,14 @@ void tee::shutdownMemoryPool()
         return;
     }
 
+    // Destroy thread caches, their pages belong to buckets
+    PageCache* cache = g_mempool->caches;
+    while (cache) {
+        PageCache* next = cache->next;
+        BX_FREE(g_mempool->alloc, cache);
+        cache = next;
+    }
+
     // Destroy buckets
     PageBucket::LNode* bucket = g_mempool->bucketList.getFirst();
     while (bucket) {
@@ -153,61 +188,132 @@ void tee::shutdownMemoryPool()
     g_mempool = nullptr;
 }
 
-static bx::AllocatorI* newPage(PageBucket* bucket, uint64_t tag)
+static PageCache* getPageCache()
 {
-    MemoryPage* page = bucket->pagePtrs[--bucket->index];
-    page->tag = tag;
-    g_mempool->pageList.add(&page->lnode);
-    bx::atomicFetchAndAdd(&g_mempool->numPages, 1);
-    page->linAlloc.reset();
+    PageCache* cache = (PageCache*)g_mempool->cache.get();
+    if (!cache) {
+        cache = (PageCache*)BX_ALLOC(g_mempool->alloc, sizeof(PageCache));
+        if (!cache)
+            return nullptr;
+        cache->count = 0;
+
+        bx::LockScope lk(g_mempool->lock);
+        cache->next = g_mempool->caches;
+        g_mempool->caches = cache;
+        g_mempool->cache.set(cache);
+    }
+    return cache;
+}
 
-    return &page->linAlloc;
+// Moves a batch of free pages from buckets to thread cache, creates a new bucket if all are full
+static bool fillPageCache(PageCache* cache)
+{
+    bx::LockScope lk(g_mempool->lock);
+    PageBucket::LNode* node = g_mempool->bucketList.getFirst();
+    while (node && cache->count < PAGE_CACHE_BATCH) {
+        PageBucket* bucket = node->data;
+        while (bucket->index > 0 && cache->count < PAGE_CACHE_BATCH)
+            cache->pages[cache->count++] = bucket->pagePtrs[--bucket->index];
+        node = node->next;
+    }
+
+    if (cache->count == 0) {
+        PageBucket* bucket = createBucket(g_mempool->pageSize, g_mempool->maxPagesPerBucket, g_mempool->alloc);
+        if (!bucket)
+            return false;
+        while (bucket->index > 0 && cache->count < PAGE_CACHE_BATCH)
+            cache->pages[cache->count++] = bucket->pagePtrs[--bucket->index];
+    }
+    return true;
+}
+
+// Returns a batch of pages from thread cache to their buckets
+static void flushPageCache(PageCache* cache, int count)
+{
+    bx::LockScope lk(g_mempool->lock);
+    for (int i = 0; i < count; i++) {
+        MemoryPage* page = cache->pages[--cache->count];
+        PageBucket* bucket = page->owner;
+        BX_ASSERT(page >= &bucket->pages[0] && page <= &bucket->pages[g_mempool->maxPagesPerBucket - 1]);
+        BX_ASSERT(bucket->index != g_mempool->maxPagesPerBucket);
+        bucket->pagePtrs[bucket->index++] = page;
+    }
+}
+
+static TagSlot* findTagSlot(uint64_t tag, bool create)
+{
+    uint32_t index = uint32_t((tag * 0x9E3779B97F4A7C15ull) >> 32) & (MAX_MEM_TAGS - 1);
+    for (int i = 0; i < MAX_MEM_TAGS; i++) {
+        TagSlot* slot = &g_mempool->tags[(index + i) & (MAX_MEM_TAGS - 1)];
+        uint64_t slotTag = slot->tag.load(std::memory_order_acquire);
+        if (slotTag == tag)
+            return slot;
+        if (slotTag == 0) {
+            if (!create)
+                return nullptr;
+            // Claim the empty slot, if someone else took it, it may be for the same tag
+            if (slot->tag.compare_exchange_strong(slotTag, tag, std::memory_order_acq_rel) || slotTag == tag)
+                return slot;
+        }
+    }
+    return nullptr;
 }
 
 bx::AllocatorI* tee::allocMemPage(uint64_t tag) TEE_THREAD_SAFE
 {
     BX_ASSERT(g_mempool);
+    BX_ASSERT(tag != 0);    // Zero marks empty slots in the tag table
 
-    PageBucket::LNode* node = g_mempool->bucketList.getFirst();
-    while (node) {
-        PageBucket* bucket = node->data;
-        if (bucket->index > 0)
-            return ::newPage(bucket, tag);
-        node = node->next;
+    TagSlot* slot = findTagSlot(tag, true);
+    if (!slot) {
+        BX_WARN("Too many memory tags (Max = %d)", MAX_MEM_TAGS);
+        return nullptr;
     }
-    
-    // Create a new bucket
-    PageBucket* bucket = createBucket(g_mempool->pageSize, g_mempool->maxPagesPerBucket, g_mempool->alloc);
-    if (!bucket) {
+
+    PageCache* cache = getPageCache();
+    if (!cache || (cache->count == 0 && !fillPageCache(cache))) {
         BX_WARN("Out of memory for Tag '%d'", tag);
         return nullptr;
     }
 
-    return ::newPage(bucket, tag);
+    MemoryPage* page = cache->pages[--cache->count];
+    page->tag = tag;
+    page->linAlloc.reset();
+
+    // Push to the tag's page list
+    MemoryPage* head = slot->pages.load(std::memory_order_relaxed);
+    do {
+        page->next = head;
+    } while (!slot->pages.compare_exchange_weak(head, page, std::memory_order_release, std::memory_order_relaxed));
+
+    bx::atomicFetchAndAdd(&g_mempool->numPages, 1);
+    return &page->linAlloc;
 }
 
 void tee::freeMemTag(uint64_t tag) TEE_THREAD_SAFE
 {
     BX_ASSERT(g_mempool);
 
-    // Search all pages for the tag
-    MemoryPage::LNode* node = g_mempool->pageList.getFirst();
-    while (node) {
-        MemoryPage::LNode* next = node->next;
-        MemoryPage* page = node->data;
-        if (page->tag == tag) {
-            // Remove the page from bucket pool
-            PageBucket* bucket = page->owner;
-            BX_ASSERT(page >= &bucket->pages[0] && page <= &bucket->pages[g_mempool->maxPagesPerBucket - 1]);
-            BX_ASSERT(bucket->index != g_mempool->maxPagesPerBucket);
-
-            bucket->pagePtrs[bucket->index++] = page;
-            
-            bx::atomicFetchAndSub(&g_mempool->numPages, 1);
-            g_mempool->pageList.remove(node);
-        }
+    TagSlot* slot = findTagSlot(tag, false);
+    if (!slot)
+        return;
 
-        node = next;
+    // Take all pages of the tag at once, and put them in the caller's cache
+    MemoryPage* page = slot->pages.exchange(nullptr, std::memory_order_acquire);
+    PageCache* cache = getPageCache();
+    while (page) {
+        MemoryPage* next = page->next;
+        page->next = nullptr;
+        if (cache) {
+            cache->pages[cache->count++] = page;
+            if (cache->count > PAGE_CACHE_MAX)
+                flushPageCache(cache, PAGE_CACHE_BATCH);
+        } else {
+            bx::LockScope lk(g_mempool->lock);
+            page->owner->pagePtrs[page->owner->index++] = page;
+        }
+        bx::atomicFetchAndSub(&g_mempool->numPages, 1);
+        page = next;
     }
 }
 
@@ -219,11 +325,9 @@ size_t tee::getNumMemPages() TEE_THREAD_SAFE
 size_t tee::getMemPoolAllocSize() TEE_THREAD_SAFE
 {
     size_t sz = 0;
-    MemoryPage::LNode* node = g_mempool->pageList.getFirst();
-    while (node) {
-        MemoryPage* page = node->data;
-        sz += page->linAlloc.getOffset();
-        node = node->next;
+    for (int i = 0; i < MAX_MEM_TAGS; i++) {
+        for (MemoryPage* page = g_mempool->tags[i].pages.load(std::memory_order_acquire); page; page = page->next)
+            sz += page->linAlloc.getOffset();
     }
 
     return sz;
@@ -233,12 +337,10 @@ size_t tee::getMemPoolAllocSize() TEE_THREAD_SAFE
 size_t tee::getMemTagAllocSize(uint64_t tag) TEE_THREAD_SAFE
 {
     size_t sz = 0;
-    MemoryPage::LNode* node = g_mempool->pageList.getFirst();
-    while (node) {
-        MemoryPage* page = node->data;
-        if (page->tag == tag)
+    TagSlot* slot = findTagSlot(tag, false);
+    if (slot) {
+        for (MemoryPage* page = slot->pages.load(std::memory_order_acquire); page; page = page->next)
             sz += page->linAlloc.getOffset();
-        node = node->next;
     }
 
     return sz;
@@ -247,13 +349,14 @@ size_t tee::getMemTagAllocSize(uint64_t tag) TEE_THREAD_SAFE
 int tee::getMemTags(uint64_t* tags, int maxTags, size_t* pageSizes) TEE_THREAD_SAFE
 {
     int count = 0;
-    MemoryPage::LNode* node = g_mempool->pageList.getFirst();
-    while (node && count < maxTags) {
-        MemoryPage* page = node->data;
-        if (pageSizes)
-            pageSizes[count] = page->linAlloc.getOffset();
-        tags[count++] = page->tag;
-        node = node->next;
+    for (int i = 0; i < MAX_MEM_TAGS && count < maxTags; i++) {
+        MemoryPage* page = g_mempool->tags[i].pages.load(std::memory_order_acquire);
+        while (page && count < maxTags) {
+            if (pageSizes)
+                pageSizes[count] = page->linAlloc.getOffset();
+            tags[count++] = page->tag;
+            page = page->next;
+        }
     }
 
     return count;
@@ -10,6 +10,7 @@
 
 #include "gfx_utils.h"
 #include "gfx_driver.h"
+#include "internal.h"
 
 #include "remotery/Remotery.h"
 
@@ -273,6 +274,11 @@ static void* getAssetApi(uint32_t version) {
     return &assetApi;
 }
 
+static void ecsGarbageCollect(EntityManager* emgr)
+{
+    ecs::garbageCollect(emgr);
+}
+
 static void* getEcsApi(uint32_t version)
 {
 	static EcsApi ecsApi;
@@ -280,12 +286,13 @@ static void* getEcsApi(uint32_t version)
 
 	switch (version) {
 	case 0:
+	case 1:
 		ecsApi.createEntityManager = ecs::createEntityManager;
 		ecsApi.destroyEntityManager = ecs::destroyEntityManager;
 		ecsApi.create = ecs::create;
 		ecsApi.destroy = ecs::destroy;
 		ecsApi.isAlive = ecs::isAlive;
-		ecsApi.registerComponent = ecs::registerComponent;
+		ecsApi.registerComponent = version == 0 ? ecs::registerComponentV0 : ecs::registerComponent;
 		ecsApi.createComponent = ecs::createComponent;
 		ecsApi.findTypeByHash = ecs::findType;
 		ecsApi.get = ecs::get;
@@ -293,6 +300,9 @@ static void* getEcsApi(uint32_t version)
         ecsApi.createGroup = ecs::createGroup;
         ecsApi.destroyGroup = ecs::destroyGroup;
         ecsApi.updateGroup = ecs::updateGroup;
+        ecsApi.updateType = ecs::updateType;
+        ecsApi.garbageCollect = ecsGarbageCollect;
+        ecsApi.garbageCollectBudget = ecs::garbageCollect;
 		return &ecsApi;
 	default:
 		return nullptr;
@@ -304,6 +314,9 @@ static void* getCoreApi(uint32_t version)
     static CoreApi coreApi;
     bx::memSet(&coreApi, 0x00, sizeof(coreApi));
 
+    if (version != 1)
+        return nullptr;
+
     coreApi.copyMemoryBlock = copyMemoryBlock;
     coreApi.createMemoryBlock = createMemoryBlock;
     coreApi.readTextFile = readTextFile;
@@ -333,6 +346,10 @@ static void* getCoreApi(uint32_t version)
     coreApi.waitAndDeleteJob = waitAndDeleteJob;
     coreApi.isJobDone = isJobDone;
     coreApi.deleteJob = deleteJob;
+    coreApi.dispatchSmallJobsAfter = dispatchSmallJobsAfter;
+    coreApi.dispatchBigJobsAfter = dispatchBigJobsAfter;
+    coreApi.whenAll = whenAll;
+    coreApi.refMemoryBlockPtrOwned = refMemoryBlockPtrOwned;
 
     return &coreApi;
 }
@@ -11,6 +11,7 @@
 #include "bxx/array.h"
 #include "bxx/string.h"
 #include "bxx/trace_allocator.h"
+#include "bx/thread.h"
 
 #include "gfx_driver.h"
 #include "gfx_font.h"
@@ -193,6 +194,46 @@ struct ConsoleCommand
     ConsoleCommand() : cmdHash(0) {}
 };
 
+// Per-thread double-buffered frame allocators, each thread allocates from the current frame's buffer
+// Buffer of frame N is reset at the beginning of frame N+2, so temp memory is valid until the end of the next frame
+struct ThreadTempAlloc;
+
+// Jobs can keep the temp allocator while they wait, then resume on another thread
+// Allocations from other threads go to the calling thread's own arena, so the owner's pages are never shared
+class TempPageAllocator : public PageAllocator
+{
+public:
+    TempPageAllocator(uint64_t tag) :
+        PageAllocator(tag),
+        owner(nullptr)
+    {
+    }
+
+    void* realloc(void* _ptr, size_t _size, size_t _align, const char* _file, uint32_t _line) override;
+
+    ThreadTempAlloc* owner;
+};
+
+struct ThreadTempAlloc
+{
+    TempPageAllocator allocs[2];
+    uint32_t threadId;
+    size_t frameSize;   // Memory used in the last finished frame
+    size_t peakSize;
+    ThreadTempAlloc* next;
+
+    explicit ThreadTempAlloc(uint64_t tag) :
+        allocs{ {tag}, {tag + 1} }
+    {
+        threadId = 0;
+        frameSize = 0;
+        peakSize = 0;
+        next = nullptr;
+        allocs[0].owner = this;
+        allocs[1].owner = this;
+    }
+};
+
 struct Tee
 {
     UpdateCallback updateFn;
@@ -207,7 +248,11 @@ struct Tee
     IoDriverDual* ioDriver;
     PhysDriver2D* phys2dDriver;
     SimpleSoundDriver* sndDriver;
-    PageAllocator tempAlloc;
+    bx::TlsData tempAllocTls;
+    ThreadTempAlloc* tempAllocs;    // All threads that have used temp allocators
+    int numTempAllocs;
+    bx::Lock tempAllocLock;
+    volatile uint32_t tempFrame;    // Selects the buffer of temp allocators
     GfxDriverEvents gfxDriverEvents;
     LogCache* gfxLogCache;
     int numGfxLogCache;
@@ -226,9 +271,11 @@ struct Tee
     bool gfxReset;
 
     Tee() :
-        tempAlloc(TEE_MEMID_TEMP),
         randEngine(randDevice())
     {
+        tempAllocs = nullptr;
+        numTempAllocs = 0;
+        tempFrame = 0;
         gfxDriver = nullptr;
         phys2dDriver = nullptr;
         sndDriver = nullptr;
@@ -441,6 +488,8 @@ bool init(const Config& conf, UpdateCallback updateFn, const GfxPlatformData* pl
             TEE_ERROR("Engine init failed: Initializing IoDriver failed");
             return false;
         }
+        if (conf.ioMaxRequests > 0 && gTee->ioDriver->async->setMaxRequests)
+            gTee->ioDriver->async->setMaxRequests(conf.ioMaxRequests);
         BX_END_OK();
     }
 
@@ -609,7 +658,8 @@ bool init(const Config& conf, UpdateCallback updateFn, const GfxPlatformData* pl
         BX_BEGINP("Initializing Job Dispatcher");
         if (!initJobDispatcher(gAlloc, conf.maxSmallFibers, conf.smallFiberSize*1024, conf.maxBigFibers, 
                               conf.bigFiberSize*1024, 
-                              (conf.engineFlags & InitEngineFlags::LockThreadsToCores) == InitEngineFlags::LockThreadsToCores)) 
+                              (conf.engineFlags & InitEngineFlags::LockThreadsToCores) == InitEngineFlags::LockThreadsToCores,
+                              conf.numWorkerThreads, conf.numReservedCores)) 
         {
             TEE_ERROR("Core init failed: Job Dispatcher init failed");
             BX_END_FATAL();
@@ -735,6 +785,7 @@ void shutdown(ShutdownCallback callback, void* userData)
 	BX_END_OK();
 
 	BX_BEGINP("Shutting down Job Dispatcher");
+    asset::cancelDecodes();
     shutdownJobDispatcher();
 	BX_END_OK();
 
@@ -790,8 +841,9 @@ void shutdown(ShutdownCallback callback, void* userData)
 
     if (gTee->ioDriver) {
         BX_BEGINP("Shutting down IO Driver");
-        gTee->ioDriver->blocking->shutdown();
+        // Async driver may still have jobs that depend on the blocking driver
         gTee->ioDriver->async->shutdown();
+        gTee->ioDriver->blocking->shutdown();
         gTee->ioDriver = nullptr;
         BX_END_OK();
     }
@@ -807,6 +859,13 @@ void shutdown(ShutdownCallback callback, void* userData)
     }
 
     BX_BEGINP("Destroying Memory pools");
+    ThreadTempAlloc* talloc = gTee->tempAllocs;
+    while (talloc) {
+        ThreadTempAlloc* next = talloc->next;
+        BX_DELETE(gAlloc, talloc);
+        talloc = next;
+    }
+    gTee->tempAllocs = nullptr;
     gTee->memPool.destroy();
     shutdownMemoryPool();
     BX_END_OK();
@@ -849,10 +908,24 @@ static double calcAvgFrameTime(const FrameData& fd)
     return sum;
 }
 
+static void swapTempAllocs()
+{
+    // Reset the buffers of two frames ago, then switch threads to them
+    uint32_t frame = gTee->tempFrame + 1;
+    bx::LockScope lk(gTee->tempAllocLock);
+    for (ThreadTempAlloc* talloc = gTee->tempAllocs; talloc; talloc = talloc->next) {
+        PageAllocator& alloc = talloc->allocs[frame & 1];
+        talloc->frameSize = getMemTagAllocSize(alloc.getTag());
+        talloc->peakSize = bx::max<size_t>(talloc->peakSize, talloc->frameSize);
+        alloc.free();
+    }
+    bx::atomicExchange<uint32_t>(&gTee->tempFrame, frame);
+}
+
 void doFrame()
 {
     rmt_BeginCPUSample(DoFrame, 0);
-    gTee->tempAlloc.free();
+    swapTempAllocs();
 
     FrameData& fd = gTee->frameData;
     if (fd.frame == 0)
@@ -889,6 +962,7 @@ void doFrame()
     rmt_BeginCPUSample(Async_Loop, 0);
     if (gTee->ioDriver->async)
         gTee->ioDriver->async->runAsyncLoop();
+    asset::update();
     rmt_EndCPUSample(); // Async_Loop
 
     rmt_BeginCPUSample(Gfx_DrawFrame, 0);
@@ -933,7 +1007,11 @@ bool isPaused()
 
 void resetTempAlloc()
 {
-    gTee->tempAlloc.free();
+    bx::LockScope lk(gTee->tempAllocLock);
+    for (ThreadTempAlloc* talloc = gTee->tempAllocs; talloc; talloc = talloc->next) {
+        talloc->allocs[0].free();
+        talloc->allocs[1].free();
+    }
 }
 
 void resetBackbuffer(uint16_t width, uint16_t height)
@@ -1014,6 +1092,19 @@ MemoryBlock* refMemoryBlockPtr(const void* data, uint32_t size)
     return (MemoryBlock*)mem;
 }
 
+MemoryBlock* refMemoryBlockPtrOwned(const void* data, uint32_t size, bx::AllocatorI* ownerAlloc)
+{
+    ScopedLock l(gTee->memPoolLock);
+    HeapMemoryImpl* mem = gTee->memPool.newInstance();
+    if (!mem)
+        return nullptr;
+    mem->m.data = (uint8_t*)const_cast<void*>(data);
+    mem->m.size = size;
+    mem->alloc = ownerAlloc;
+
+    return (MemoryBlock*)mem;
+}
+
 MemoryBlock* copyMemoryBlock(const void* data, uint32_t size, bx::AllocatorI* alloc)
 {
     ScopedLock l(gTee->memPoolLock);
@@ -1308,9 +1399,53 @@ bx::AllocatorI* getHeapAlloc() TEE_THREAD_SAFE
     return gAlloc;
 }
 
+static ThreadTempAlloc* createThreadTempAlloc()
+{
+    bx::LockScope lk(gTee->tempAllocLock);
+    // Each thread takes two tags after TEE_MEMID_TEMP, main thread is usually the first one
+    ThreadTempAlloc* talloc = BX_NEW(gAlloc, ThreadTempAlloc)(TEE_MEMID_TEMP + 2*gTee->numTempAllocs);
+    if (!talloc)
+        return nullptr;
+    talloc->threadId = bx::getTid();
+    talloc->next = gTee->tempAllocs;
+    gTee->tempAllocs = talloc;
+    gTee->numTempAllocs++;
+    gTee->tempAllocTls.set(talloc);
+    return talloc;
+}
+
+void* TempPageAllocator::realloc(void* _ptr, size_t _size, size_t _align, const char* _file, uint32_t _line)
+{
+    if ((ThreadTempAlloc*)gTee->tempAllocTls.get() != owner) {
+        // Linear allocators copy the old block by it's header, so blocks can move between arenas
+        bx::AllocatorI* alloc = getTempAlloc();
+        return alloc ? alloc->realloc(_ptr, _size, _align, _file, _line) : nullptr;
+    }
+    return PageAllocator::realloc(_ptr, _size, _align, _file, _line);
+}
+
 bx::AllocatorI* getTempAlloc() TEE_THREAD_SAFE
 {
-    return &gTee->tempAlloc;
+    ThreadTempAlloc* talloc = (ThreadTempAlloc*)gTee->tempAllocTls.get();
+    if (!talloc) {
+        talloc = createThreadTempAlloc();
+        if (!talloc)
+            return nullptr;
+    }
+    return &talloc->allocs[gTee->tempFrame & 1];
+}
+
+int getTempAllocStats(TempAllocStats* stats, int maxStats) TEE_THREAD_SAFE
+{
+    bx::LockScope lk(gTee->tempAllocLock);
+    int count = 0;
+    for (ThreadTempAlloc* talloc = gTee->tempAllocs; talloc && count < maxStats; talloc = talloc->next) {
+        TempAllocStats& s = stats[count++];
+        s.threadId = talloc->threadId;
+        s.frameSize = talloc->frameSize;
+        s.peakSize = talloc->peakSize;
+    }
+    return count;
 }
 
 const Config& getConfig() TEE_THREAD_SAFE
@@ -0,0 +1,284 @@
+#include "bx/bx.h"
+#include "bx/commandline.h"
+#include "bx/allocator.h"
+#include "bx/file.h"
+#include "bx/string.h"
+#include "bxx/path.h"
+#include "bxx/array.h"
+
+#include "termite/types.h"
+
+#include "lz4/lz4.h"
+
+#include "../include_common/tpak_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+
+#ifdef _DEBUG
+#define STB_LEAKCHECK_IMPLEMENTATION
+#include "bxx/leakcheck_allocator.h"
+static bx::LeakCheckAllocator gAllocStub;
+#else
+static bx::DefaultAllocator gAllocStub;
+#endif
+static bx::AllocatorI* gAlloc = &gAllocStub;
+
+using namespace tee;
+
+struct PackFile
+{
+    bx::Path uri;       // Relative to input directory, unix slashes
+    uint32_t hash;
+};
+
+// Files with these extensions are already compressed, so we keep them as they are
+static const char* kNoCompressExts[] = {
+    "png", "jpg", "jpeg", "ktx", "dds", "pvr", "ogg", "mp3", "lz4", "zip"
+};
+
+static void collectFiles(bx::Array<PackFile>* files, const char* baseDir, const char* dir)
+{
+    bx::Path dirpath(baseDir);
+    if (dir[0])
+        dirpath.join(dir);
+    dirpath.normalizeSelf();
+
+    DIR* d = opendir(dirpath.cstr());
+    if (!d)
+        return;
+
+    dirent* ent;
+    while ((ent = readdir(d)) != nullptr) {
+        bx::Path uri(dir);
+        if (ent->d_type == DT_REG) {
+            uri.joinUnix(ent->d_name);
+            PackFile* file = files->push();
+            file->uri = uri.cstr()[0] == '/' ? uri.cstr() + 1 : uri.cstr();
+            file->hash = tpHashUri(file->uri.cstr(), file->uri.getLength());
+        } else if (ent->d_type == DT_DIR && strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+            uri.joinUnix(ent->d_name);
+            collectFiles(files, baseDir, uri.cstr()[0] == '/' ? uri.cstr() + 1 : uri.cstr());
+        }
+    }
+    closedir(d);
+}
+
+static bool canCompress(const bx::Path& uri)
+{
+    bx::Path ext = uri.getFileExt();
+    for (uint32_t i = 0; i < BX_COUNTOF(kNoCompressExts); i++) {
+        if (bx::strCmpI(ext.cstr(), kNoCompressExts[i]) == 0)
+            return false;
+    }
+    return true;
+}
+
+static bool writePadding(bx::FileWriter* file, uint64_t* offset, uint32_t alignment, bx::Error* err)
+{
+    static const uint8_t zeros[256] = {0};
+    uint64_t aligned = (*offset + alignment - 1) & ~uint64_t(alignment - 1);
+    while (*offset < aligned) {
+        int32_t sz = int32_t(bx::min<uint64_t>(aligned - *offset, sizeof(zeros)));
+        if (file->write(zeros, sz, err) != sz)
+            return false;
+        *offset += sz;
+    }
+    return true;
+}
+
+static void* readFile(const char* filepath, uint32_t* size)
+{
+    bx::FileReader file;
+    bx::Error err;
+    if (!file.open(filepath, &err))
+        return nullptr;
+    int64_t fsize = file.seek(0, bx::Whence::End);
+    file.seek(0, bx::Whence::Begin);
+    if (fsize < 0 || fsize > INT32_MAX) {
+        file.close();
+        return nullptr;
+    }
+
+    void* mem = BX_ALLOC(gAlloc, fsize > 0 ? size_t(fsize) : 1);
+    if (mem && fsize > 0 && file.read(mem, int32_t(fsize), &err) != int32_t(fsize)) {
+        BX_FREE(gAlloc, mem);
+        mem = nullptr;
+    }
+    file.close();
+    *size = uint32_t(fsize);
+    return mem;
+}
+
+static void printHelp()
+{
+    puts("tpak - Packs assets directory into a single memory-mappable file\n"
+         "Usage: tpak -i <assets-dir> -o <output.tpak> [-c] [-a <alignment>]\n"
+         "  -i --input: Input directory (usually the 'assets' directory)\n"
+         "  -o --output: Output pack file, put 'assets.tpak' next to the assets directory for DiskIO to pick it up\n"
+         "  -c --compress: LZ4 compress entries (compressed entries are decompressed on load, not zero-copy)\n"
+         "  -a --align: Alignment of the entries in bytes, power of two (default=16)");
+}
+
+int main(int argc, char* argv[])
+{
+    bx::CommandLine cmdline(argc, argv);
+    if (cmdline.hasArg('h', "help")) {
+        printHelp();
+        return 0;
+    }
+
+    const char* inputDir = cmdline.findOption('i', "input");
+    const char* outputFilepath = cmdline.findOption('o', "output");
+    if (!inputDir || !outputFilepath) {
+        printf("-i and -o Parameters must be set\n");
+        printHelp();
+        return -1;
+    }
+    bool compress = cmdline.hasArg('c', "compress");
+    const char* salign = cmdline.findOption('a', "align");
+    uint32_t alignment = salign ? (uint32_t)atoi(salign) : TPAK_DEFAULT_ALIGNMENT;
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > UINT16_MAX) {
+        printf("Invalid alignment '%s'\n", salign);
+        return -1;
+    }
+
+    bx::Path baseDir(inputDir);
+    baseDir.normalizeSelf();
+    bx::FileInfo finfo;
+    if (!bx::stat(baseDir.cstr(), finfo) || finfo.m_type != bx::FileInfo::Directory) {
+        printf("'%s' is an invalid directory\n", baseDir.cstr());
+        return -1;
+    }
+
+    bx::Array<PackFile> files;
+    files.create(256, 256, gAlloc);
+    collectFiles(&files, baseDir.cstr(), "");
+    int numFiles = files.getCount();
+
+    // Sort files by hash, DiskIO does a binary search on them
+    qsort(files.getBuffer(), numFiles, sizeof(PackFile), [](const void* a, const void* b)->int {
+        uint32_t ha = ((const PackFile*)a)->hash;
+        uint32_t hb = ((const PackFile*)b)->hash;
+        if (ha != hb)
+            return ha < hb ? -1 : 1;
+        return strcmp(((const PackFile*)a)->uri.cstr(), ((const PackFile*)b)->uri.cstr());
+    });
+
+    tpEntry* entries = numFiles > 0 ? (tpEntry*)BX_ALLOC(gAlloc, sizeof(tpEntry)*numFiles) : nullptr;
+    if (numFiles > 0 && !entries) {
+        printf("Out of memory\n");
+        files.destroy();
+        return -1;
+    }
+
+    bx::FileWriter outFile;
+    bx::Error err;
+    if (!outFile.open(outputFilepath, false, &err)) {
+        printf("Could not write to file '%s'\n", outputFilepath);
+        BX_FREE(gAlloc, entries);
+        files.destroy();
+        return -1;
+    }
+
+    // Header is written again at the end, when we have the offsets
+    tpHeader header;
+    bx::memSet(&header, 0x00, sizeof(header));
+    header.sign = TPAK_SIGN;
+    header.version = TPAK_VERSION;
+    header.numEntries = uint32_t(numFiles);
+    outFile.write(&header, sizeof(header), &err);
+    uint64_t offset = sizeof(header);
+
+    uint64_t totalSize = 0;
+    uint32_t strOffset = 0;
+    bool ok = true;
+    for (int i = 0; i < numFiles && ok; i++) {
+        const PackFile& pf = files[i];
+        bx::Path filepath(baseDir.cstr());
+        filepath.join(pf.uri.cstr());
+
+        uint32_t size;
+        void* data = readFile(filepath.cstr(), &size);
+        if (!data) {
+            printf("Could not read file '%s'\n", filepath.cstr());
+            ok = false;
+            break;
+        }
+        totalSize += size;
+
+        tpEntry& entry = entries[i];
+        entry.uriHash = pf.hash;
+        entry.uriOffset = strOffset;
+        entry.uncompSize = size;
+        entry.size = size;
+        entry.alignment = uint16_t(alignment);
+        entry.flags = tpEntryFlags::None;
+        strOffset += pf.uri.getLength() + 1;
+
+        // Keep compressed data only if it saves at least 1/8 of the size
+        void* compressed = nullptr;
+        if (compress && size > 0 && canCompress(pf.uri)) {
+            int maxSize = LZ4_compressBound(int(size));
+            compressed = BX_ALLOC(gAlloc, maxSize);
+            if (compressed) {
+                int compSize = LZ4_compress_default((const char*)data, (char*)compressed, int(size), maxSize);
+                if (compSize > 0 && uint32_t(compSize) < size - size/8) {
+                    entry.size = uint32_t(compSize);
+                    entry.flags |= tpEntryFlags::LZ4;
+                } else {
+                    BX_FREE(gAlloc, compressed);
+                    compressed = nullptr;
+                }
+            }
+        }
+
+        ok = writePadding(&outFile, &offset, alignment, &err);
+        entry.offset = offset;
+        if (ok && entry.size > 0)
+            ok = outFile.write(compressed ? compressed : data, int32_t(entry.size), &err) == int32_t(entry.size);
+        offset += entry.size;
+
+        if (compressed)
+            BX_FREE(gAlloc, compressed);
+        BX_FREE(gAlloc, data);
+    }
+
+    // TOC and string table
+    if (ok) {
+        ok = writePadding(&outFile, &offset, 8, &err);
+        header.tocOffset = offset;
+        if (ok && numFiles > 0)
+            ok = outFile.write(entries, int32_t(sizeof(tpEntry)*numFiles), &err) == int32_t(sizeof(tpEntry)*numFiles);
+        offset += sizeof(tpEntry)*numFiles;
+
+        header.strTableOffset = offset;
+        header.strTableSize = strOffset;
+        for (int i = 0; i < numFiles && ok; i++) {
+            int32_t len = files[i].uri.getLength() + 1;
+            ok = outFile.write(files[i].uri.cstr(), len, &err) == len;
+        }
+
+        outFile.seek(0, bx::Whence::Begin);
+        ok = ok && outFile.write(&header, sizeof(header), &err) == int32_t(sizeof(header));
+    }
+    outFile.close();
+
+    if (ok) {
+        printf("Pack written to: %s (%d files, %.1fkb -> %.1fkb)\n", outputFilepath, numFiles,
+               float(totalSize)/1024.0f, float(offset + strOffset)/1024.0f);
+    } else {
+        printf("Writing pack '%s' failed\n", outputFilepath);
+    }
+
+    if (entries)
+        BX_FREE(gAlloc, entries);
+    files.destroy();
+
+#if _DEBUG
+    stb_leakcheck_dumpmem();
+#endif
+
+    return ok ? 0 : -1;
+}
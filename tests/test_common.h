@@ -0,0 +1,51 @@
+#pragma once
+
+// Shared helpers for the engine tests: headless engine init and a minimal check macro
+// Tests return the number of failed checks from main, so 0 means success
+
+#include "termite/tee.h"
+#include "bxx/path.h"
+
+#include <stdio.h>
+
+static int gNumFailed = 0;
+
+#define TEST_CHECK(_Cond) \
+    do { \
+        if (!(_Cond)) { \
+            printf("FAILED: %s (%s:%d)\n", #_Cond, __FILE__, __LINE__); \
+            gNumFailed++; \
+        } \
+    } while (0)
+
+// Initializes the engine without graphics, sound and physics drivers
+// Plugins are loaded from the executable's directory. 'dataUri' = nullptr uses the current directory
+static bool initTestEngine(const char* argv0, const char* dataUri = nullptr, uint16_t maxSmallFibers = 0)
+{
+    tee::Config conf;
+    conf.pluginPath = bx::Path(argv0).getDirectory();
+    if (dataUri)
+        conf.dataUri = dataUri;
+    conf.gfxName = "";
+    conf.soundName = "";
+    conf.phys2dName = "";
+    conf.maxSmallFibers = maxSmallFibers;
+    conf.engineFlags = tee::InitEngineFlags::EnableJobDispatcher;
+
+    if (!tee::init(conf)) {
+        printf("Engine init failed: %s\n", tee::err::getString());
+        tee::shutdown();
+        return false;
+    }
+    return true;
+}
+
+static int finishTest(const char* name)
+{
+    tee::shutdown();
+    if (gNumFailed == 0)
+        printf("%s: OK\n", name);
+    else
+        printf("%s: %d checks FAILED\n", name, gNumFailed);
+    return gNumFailed;
+}
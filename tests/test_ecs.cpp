@@ -0,0 +1,213 @@
+#include "test_common.h"
+
+#include "termite/ecs.h"
+
+using namespace tee;
+
+struct TestData
+{
+    int value;
+    uint32_t entId;
+};
+
+static int gNumCreated = 0;
+static int gNumDestroyed = 0;
+static int gNumPackedUpdated = 0;
+static bool gPackedUpdateOk = true;
+
+static bool createTestData(Entity ent, ComponentHandle handle, void* data)
+{
+    TestData* d = (TestData*)data;
+    d->value = 0;
+    d->entId = ent.id;
+    gNumCreated++;
+    return true;
+}
+
+static void destroyTestData(Entity ent, ComponentHandle handle, void* data)
+{
+    gNumDestroyed++;
+}
+
+static void updateTestDataPacked(const Entity* ents, void* data, uint16_t count, float dt)
+{
+    TestData* items = (TestData*)data;
+    for (uint16_t i = 0; i < count; i++) {
+        gPackedUpdateOk &= items[i].entId == ents[i].id;
+        items[i].value++;
+    }
+    gNumPackedUpdated += count;
+}
+
+// Dense storage of packed types: active components come first and updates only get the active ones
+static void testPackedStorage(EntityManager* emgr)
+{
+    ComponentCallbacks callbacks;
+    callbacks.createInstance = createTestData;
+    callbacks.destroyInstance = destroyTestData;
+    callbacks.updateStagePacked[ComponentUpdateStage::Update] = updateTestDataPacked;
+    ComponentTypeHandle type = ecs::registerComponent("TestPacked", &callbacks, ComponentFlag::Packed,
+                                                      sizeof(TestData), 16, 16);
+    TEST_CHECK(type.isValid());
+
+    const int numEnts = 100;
+    Entity ents[numEnts];
+    for (int i = 0; i < numEnts; i++) {
+        ents[i] = ecs::create(emgr);
+        TEST_CHECK(ecs::createComponent(emgr, ents[i], type).isValid());
+    }
+    TEST_CHECK(gNumCreated == numEnts);
+
+    // Deactivate every other entity
+    for (int i = 0; i < numEnts; i += 2)
+        ecs::setActive(ents[i], false);
+
+    const Entity* packedEnts;
+    uint16_t count, numActive;
+    TestData* items = (TestData*)ecs::getPackedData(type, &packedEnts, &count, &numActive);
+    TEST_CHECK(items != nullptr);
+    TEST_CHECK(count == numEnts);
+    TEST_CHECK(numActive == numEnts/2);
+    for (uint16_t i = 0; i < count; i++) {
+        TEST_CHECK(items[i].entId == packedEnts[i].id);
+        TEST_CHECK(ecs::isActive(packedEnts[i]) == (i < numActive));
+    }
+
+    gNumPackedUpdated = 0;
+    ecs::updateType(ComponentUpdateStage::Update, type, 0.0f);
+    TEST_CHECK(gNumPackedUpdated == numEnts/2);
+    TEST_CHECK(gPackedUpdateOk);
+
+    // Data follows the component when it's moved within the dense array
+    for (int i = 0; i < numEnts; i++) {
+        ComponentHandle handle = ecs::get(type, ents[i]);
+        TEST_CHECK(handle.isValid());
+        TestData* d = (TestData*)ecs::getData(handle);
+        TEST_CHECK(d->entId == ents[i].id);
+        TEST_CHECK(d->value == ((i % 2) ? 1 : 0));
+    }
+
+    // Remove some from the middle, the rest stay dense
+    for (int i = 0; i < numEnts; i += 4)
+        ecs::destroyComponent(emgr, ents[i], ecs::get(type, ents[i]));
+    items = (TestData*)ecs::getPackedData(type, &packedEnts, &count, &numActive);
+    TEST_CHECK(count == numEnts - numEnts/4);
+    TEST_CHECK(numActive == numEnts/2);
+    for (uint16_t i = 0; i < count; i++)
+        TEST_CHECK(items[i].entId == packedEnts[i].id);
+
+    for (int i = 0; i < numEnts; i++)
+        ecs::destroy(emgr, ents[i]);
+    TEST_CHECK(ecs::garbageCollect(emgr) == 0);
+    ecs::getPackedData(type, &packedEnts, &count, &numActive);
+    TEST_CHECK(count == 0 && numActive == 0);
+    TEST_CHECK(gNumDestroyed == numEnts);
+}
+
+// Entity -> component lookups, and that dead entities lose their components
+static void testLookup(EntityManager* emgr)
+{
+    ComponentTypeHandle typeA = ecs::registerComponent("TestA", nullptr, 0, sizeof(int), 16, 16);
+    ComponentTypeHandle typeB = ecs::registerComponent("TestB", nullptr, 0, sizeof(int), 16, 16);
+    TEST_CHECK(typeA.isValid() && typeB.isValid());
+    TEST_CHECK(ecs::findType("TestA") == typeA);
+
+    const int numEnts = 300;
+    Entity ents[numEnts];
+    for (int i = 0; i < numEnts; i++) {
+        ents[i] = ecs::create(emgr);
+        *(int*)ecs::getData(ecs::createComponent(emgr, ents[i], typeA)) = i;
+        if (i % 3 == 0)
+            *(int*)ecs::getData(ecs::createComponent(emgr, ents[i], typeB)) = -i;
+    }
+
+    for (int i = 0; i < numEnts; i++) {
+        TEST_CHECK(ecs::isAlive(emgr, ents[i]));
+        ComponentHandle a = ecs::get(typeA, ents[i]);
+        ComponentHandle b = ecs::get(typeB, ents[i]);
+        TEST_CHECK(a.isValid() && *(int*)ecs::getData(a) == i);
+        TEST_CHECK(ecs::getEntity(a) == ents[i]);
+        if (i % 3 == 0)
+            TEST_CHECK(b.isValid() && *(int*)ecs::getData(b) == -i);
+        else
+            TEST_CHECK(!b.isValid());
+
+        ComponentHandle handles[4];
+        TEST_CHECK(ecs::getEntityComponents(ents[i], handles, 4) == ((i % 3 == 0) ? 2 : 1));
+    }
+
+    Entity dead = ents[10];
+    ecs::destroy(emgr, dead);
+    TEST_CHECK(!ecs::isAlive(emgr, dead));
+    ecs::garbageCollect(emgr);
+    TEST_CHECK(!ecs::get(typeA, dead).isValid());
+    TEST_CHECK(ecs::get(typeA, ents[11]).isValid());
+
+    // New entities don't match stale ones
+    Entity ent = ecs::create(emgr);
+    TEST_CHECK(ent != dead);
+    TEST_CHECK(!ecs::get(typeA, ent).isValid());
+    ecs::destroy(emgr, ent);
+
+    for (int i = 0; i < numEnts; i++) {
+        if (i != 10)
+            ecs::destroy(emgr, ents[i]);
+    }
+    TEST_CHECK(ecs::garbageCollect(emgr) == 0);
+    TEST_CHECK(!ecs::get(typeA, ents[0]).isValid());
+}
+
+// garbageCollect with limits leaves the rest for the next calls
+static void testGarbageCollectBudget(EntityManager* emgr)
+{
+    ComponentCallbacks callbacks;
+    callbacks.destroyInstance = destroyTestData;
+    ComponentTypeHandle type = ecs::registerComponent("TestGC", &callbacks, 0, sizeof(TestData), 16, 16);
+
+    const int numEnts = 50;
+    Entity ents[numEnts];
+    for (int i = 0; i < numEnts; i++) {
+        ents[i] = ecs::create(emgr);
+        ecs::createComponent(emgr, ents[i], type);
+    }
+    for (int i = 0; i < numEnts; i++)
+        ecs::destroy(emgr, ents[i]);
+
+    gNumDestroyed = 0;
+    TEST_CHECK(ecs::garbageCollect(emgr, 0, 10) == numEnts - 10);
+    TEST_CHECK(gNumDestroyed == 10);
+    // Dead entities are collected in the order they are destroyed
+    TEST_CHECK(!ecs::get(type, ents[9]).isValid());
+    TEST_CHECK(ecs::get(type, ents[10]).isValid());
+
+    int pending = numEnts - 10;
+    while (pending > 0) {
+        int newPending = ecs::garbageCollect(emgr, 0, 7);
+        TEST_CHECK(newPending < pending);
+        if (newPending >= pending)
+            break;
+        pending = newPending;
+    }
+    TEST_CHECK(gNumDestroyed == numEnts);
+    TEST_CHECK(ecs::garbageCollect(emgr) == 0);
+}
+
+int main(int argc, char* argv[])
+{
+    if (!initTestEngine(argv[0]))
+        return -1;
+
+    EntityManager* emgr = ecs::createEntityManager(getHeapAlloc());
+    if (!emgr) {
+        printf("Creating entity manager failed\n");
+        tee::shutdown();
+        return -1;
+    }
+
+    testPackedStorage(emgr);
+    testLookup(emgr);
+    testGarbageCollectBudget(emgr);
+
+    ecs::destroyEntityManager(emgr);
+    return finishTest("test_ecs");
+}
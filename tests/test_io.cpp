@@ -0,0 +1,182 @@
+#include "test_common.h"
+
+#include "termite/io_driver.h"
+#include "../source/include_common/tpak_format.h"
+
+#include <string.h>
+#if BX_PLATFORM_WINDOWS
+#   include <direct.h>
+#   define makeDir(_Path) _mkdir(_Path)
+#else
+#   include <sys/stat.h>
+#   define makeDir(_Path) mkdir(_Path, 0755)
+#endif
+
+using namespace tee;
+
+static const char* kPackedUri = "data/packed.bin";
+static const char* kLooseUri = "loose.bin";
+static const uint32_t kPackedSize = 10000;
+static const uint32_t kLooseSize = 3000;
+
+static void fillData(uint8_t* data, uint32_t size, uint32_t seed)
+{
+    for (uint32_t i = 0; i < size; i++)
+        data[i] = uint8_t((i*31 + seed) & 0xff);
+}
+
+static bool writeFile(const char* filepath, const void* data, size_t size)
+{
+    FILE* f = fopen(filepath, "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    fclose(f);
+    return ok;
+}
+
+// Writes an uncompressed pack with a single entry, same layout as the tpak tool
+static bool writePack(const char* filepath, const uint8_t* data, uint32_t size)
+{
+    const uint32_t uriLen = (uint32_t)strlen(kPackedUri);
+    const uint64_t dataOffset = BX_ALIGN_MASK(uint64_t(sizeof(tpHeader)), uint64_t(TPAK_DEFAULT_ALIGNMENT - 1));
+    const uint64_t tocOffset = BX_ALIGN_MASK(dataOffset + size, uint64_t(7));
+
+    tpHeader header;
+    bx::memSet(&header, 0x00, sizeof(header));
+    header.sign = TPAK_SIGN;
+    header.version = TPAK_VERSION;
+    header.numEntries = 1;
+    header.tocOffset = tocOffset;
+    header.strTableOffset = tocOffset + sizeof(tpEntry);
+    header.strTableSize = uriLen + 1;
+
+    tpEntry entry;
+    entry.uriHash = tpHashUri(kPackedUri, uriLen);
+    entry.uriOffset = 0;
+    entry.offset = dataOffset;
+    entry.size = size;
+    entry.uncompSize = size;
+    entry.alignment = TPAK_DEFAULT_ALIGNMENT;
+    entry.flags = tpEntryFlags::None;
+
+    size_t packSize = size_t(header.strTableOffset + header.strTableSize);
+    uint8_t* pack = new uint8_t[packSize];
+    bx::memSet(pack, 0x00, packSize);
+    memcpy(pack, &header, sizeof(header));
+    memcpy(pack + dataOffset, data, size);
+    memcpy(pack + tocOffset, &entry, sizeof(entry));
+    memcpy(pack + header.strTableOffset, kPackedUri, uriLen + 1);
+
+    bool ok = writeFile(filepath, pack, packSize);
+    delete [] pack;
+    return ok;
+}
+
+static bool sameData(const MemoryBlock* mem, const uint8_t* data, uint32_t size)
+{
+    return mem && mem->size == size && memcmp(mem->data, data, size) == 0;
+}
+
+// Pack entries are found before loose files, and both read the same through the driver
+static void testRead(IoDriver* io, const uint8_t* packedData, const uint8_t* looseData)
+{
+    MemoryBlock* mem = io->read(kPackedUri, IoPathType::Assets, 0);
+    TEST_CHECK(sameData(mem, packedData, kPackedSize));
+    if (mem)
+        releaseMemoryBlock(mem);
+
+    mem = io->read(kLooseUri, IoPathType::Assets, 0);
+    TEST_CHECK(sameData(mem, looseData, kLooseSize));
+    if (mem)
+        releaseMemoryBlock(mem);
+
+    TEST_CHECK(io->read("does_not_exist.bin", IoPathType::Assets, 0) == nullptr);
+}
+
+static bool readStreamed(IoDriver* io, const char* uri, IoPathType::Enum pathType, uint32_t chunkSize,
+                         const uint8_t* data, uint32_t size)
+{
+    IoStreamParams params;
+    params.chunkSize = chunkSize;
+    IoStream* stream = io->openStream(uri, IoStreamFlag::READ, pathType, &params);
+    if (!stream)
+        return false;
+
+    bool ok = true;
+    uint32_t offset = 0;
+    MemoryBlock* chunk;
+    while ((chunk = io->readStream(stream)) != nullptr) {
+        ok &= chunk->size <= chunkSize && offset + chunk->size <= size &&
+              memcmp(chunk->data, data + offset, chunk->size) == 0;
+        offset += chunk->size;
+        releaseMemoryBlock(chunk);
+    }
+    io->closeStream(stream);
+    return ok && offset == size;
+}
+
+// Streams split the file into chunks, chunks of pack entries reference the mapped pack
+static void testStreams(IoDriver* io, const uint8_t* packedData, const uint8_t* looseData)
+{
+    TEST_CHECK(readStreamed(io, kPackedUri, IoPathType::Assets, 1024, packedData, kPackedSize));
+    TEST_CHECK(readStreamed(io, kLooseUri, IoPathType::Assets, 1000, looseData, kLooseSize));
+    TEST_CHECK(readStreamed(io, kLooseUri, IoPathType::Assets, 64*1024, looseData, kLooseSize));
+
+    // Write in a few blocks and read it back
+    const char* outUri = "stream_out.bin";
+    IoStream* stream = io->openStream(outUri, IoStreamFlag::WRITE, IoPathType::Relative, nullptr);
+    TEST_CHECK(stream != nullptr);
+    if (stream) {
+        const uint32_t blockSize = 1000;
+        for (uint32_t offset = 0; offset < kPackedSize; offset += blockSize) {
+            MemoryBlock* block = refMemoryBlockPtr(packedData + offset, bx::min(blockSize, kPackedSize - offset));
+            TEST_CHECK(io->writeStream(stream, block) == block->size);
+            releaseMemoryBlock(block);
+        }
+        io->closeStream(stream);
+
+        MemoryBlock* mem = io->read(outUri, IoPathType::Relative, 0);
+        TEST_CHECK(sameData(mem, packedData, kPackedSize));
+        if (mem)
+            releaseMemoryBlock(mem);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // Data directory next to the executable: assets.tpak and assets/loose.bin
+    bx::Path dataDir = bx::Path(argv[0]).getDirectory();
+    dataDir.join("test_io_data");
+    bx::Path assetsDir(dataDir.cstr());
+    assetsDir.join("assets");
+    makeDir(dataDir.cstr());
+    makeDir(assetsDir.cstr());
+
+    uint8_t* packedData = new uint8_t[kPackedSize];
+    uint8_t* looseData = new uint8_t[kLooseSize];
+    fillData(packedData, kPackedSize, 1);
+    fillData(looseData, kLooseSize, 7);
+
+    bx::Path packFilepath(dataDir.cstr());
+    packFilepath.join("assets.tpak");
+    bx::Path looseFilepath(assetsDir.cstr());
+    looseFilepath.join(kLooseUri);
+    if (!writePack(packFilepath.cstr(), packedData, kPackedSize) ||
+        !writeFile(looseFilepath.cstr(), looseData, kLooseSize))
+    {
+        printf("Writing test data to '%s' failed\n", dataDir.cstr());
+        return -1;
+    }
+
+    if (!initTestEngine(argv[0], dataDir.cstr()))
+        return -1;
+
+    IoDriver* io = getBlockingIoDriver();
+    testRead(io, packedData, looseData);
+    testStreams(io, packedData, looseData);
+
+    delete [] packedData;
+    delete [] looseData;
+    return finishTest("test_io");
+}
@@ -0,0 +1,206 @@
+#include "test_common.h"
+
+#include "termite/job_dispatcher.h"
+#include "bx/thread.h"
+#include "bx/cpu.h"
+
+using namespace tee;
+
+// Small fiber pool, so dispatching more jobs than fibers goes through the pending queue
+static const uint16_t kMaxSmallFibers = 32;
+
+static volatile int32_t gJobCount = 0;
+
+static void countJobCallback(int jobIndex, void* userParam)
+{
+    bx::atomicInc(&gJobCount);
+}
+
+// Many jobs in one dispatch: More than the fiber pool holds, and enough for the workers to steal from each other
+static void testManyJobs()
+{
+    const uint16_t numJobs = 2000;
+    JobDesc* jobs = new JobDesc[numJobs];
+    for (int i = 0; i < numJobs; i++)
+        jobs[i] = JobDesc(countJobCallback);
+
+    gJobCount = 0;
+    JobHandle handle = dispatchSmallJobs(jobs, numJobs);
+    TEST_CHECK(handle.isValid());
+    waitAndDeleteJob(handle);
+    TEST_CHECK(gJobCount == numJobs);
+
+    delete [] jobs;
+}
+
+static void nestedJobCallback(int jobIndex, void* userParam)
+{
+    JobDesc jobs[16];
+    for (uint16_t i = 0; i < BX_COUNTOF(jobs); i++)
+        jobs[i] = JobDesc(countJobCallback);
+    waitAndDeleteJob(dispatchSmallJobs(jobs, BX_COUNTOF(jobs)));
+}
+
+// Jobs that wait for their own sub-jobs, suspended fibers are resumed by the thread that owns them
+static void testNestedJobs()
+{
+    JobDesc jobs[8];
+    for (uint16_t i = 0; i < BX_COUNTOF(jobs); i++)
+        jobs[i] = JobDesc(nestedJobCallback);
+
+    gJobCount = 0;
+    waitAndDeleteJob(dispatchSmallJobs(jobs, BX_COUNTOF(jobs)));
+    TEST_CHECK(gJobCount == BX_COUNTOF(jobs)*16);
+}
+
+// Deleted handles are stale, a new job that reuses the counter slot is not affected by them
+static void testStaleHandles()
+{
+    JobDesc job(countJobCallback);
+
+    gJobCount = 0;
+    JobHandle first = dispatchSmallJobs(&job, 1);
+    waitAndDeleteJob(first);
+    TEST_CHECK(gJobCount == 1);
+
+    JobHandle second = dispatchSmallJobs(&job, 1);
+    TEST_CHECK(second.isValid());
+    TEST_CHECK(uint32_t(first) != uint32_t(second));
+
+    TEST_CHECK(isJobDone(first));
+    deleteJob(first);       // Warns and does nothing
+
+    waitAndDeleteJob(second);
+    TEST_CHECK(gJobCount == 2);
+    TEST_CHECK(isJobDone(second));
+}
+
+static volatile int32_t gOrderIdx = 0;
+static int gOrder[4];
+
+static void orderJobCallback(int jobIndex, void* userParam)
+{
+    int32_t idx = bx::atomicFetchAndAdd<int32_t>(&gOrderIdx, 1);
+    if (idx < (int32_t)BX_COUNTOF(gOrder))
+        gOrder[idx] = (int)(intptr_t)userParam;
+}
+
+static void whenAllJobCallback(int jobIndex, void* userParam)
+{
+    // All dependencies must be done at this point
+    *(int32_t*)userParam = gJobCount;
+}
+
+static void testContinuations()
+{
+    // Chain: A -> B -> C
+    gOrderIdx = 0;
+    JobDesc a(orderJobCallback, (void*)1);
+    JobDesc b(orderJobCallback, (void*)2);
+    JobDesc c(orderJobCallback, (void*)3);
+    JobHandle ha = dispatchSmallJobs(&a, 1);
+    JobHandle hb = dispatchSmallJobsAfter(ha, &b, 1);
+    JobHandle hc = dispatchBigJobsAfter(hb, &c, 1);
+    waitAndDeleteJob(hc);
+    TEST_CHECK(gOrderIdx == 3);
+    TEST_CHECK(gOrder[0] == 1 && gOrder[1] == 2 && gOrder[2] == 3);
+
+    // whenAll: continuation runs after all three dependencies
+    const uint16_t numDeps = 3;
+    JobDesc jobs[16];
+    for (uint16_t i = 0; i < BX_COUNTOF(jobs); i++)
+        jobs[i] = JobDesc(countJobCallback);
+
+    gJobCount = 0;
+    JobHandle deps[numDeps];
+    for (int i = 0; i < numDeps; i++)
+        deps[i] = dispatchSmallJobs(jobs, BX_COUNTOF(jobs));
+    int32_t countAtContinuation = -1;
+    JobDesc cont(whenAllJobCallback, &countAtContinuation);
+    waitAndDeleteJob(dispatchSmallJobsAfter(whenAll(deps, numDeps), &cont, 1));
+    TEST_CHECK(countAtContinuation == numDeps*BX_COUNTOF(jobs));
+
+    // Invalid dependency dispatches right away
+    gJobCount = 0;
+    waitAndDeleteJob(dispatchSmallJobsAfter(JobHandle(), jobs, 1));
+    TEST_CHECK(gJobCount == 1);
+}
+
+static bool checkParallelFor(int count, int grainSize)
+{
+    int* values = new int[count];
+    memset(values, 0x00, sizeof(int)*count);
+    parallelFor(0, count, grainSize, [values](int first, int last) {
+        for (int i = first; i < last; i++)
+            values[i] += i*2;
+    });
+
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++)
+        ok = values[i] == i*2;
+    delete [] values;
+    return ok;
+}
+
+static void parallelForJobCallback(int jobIndex, void* userParam)
+{
+    *(bool*)userParam = checkParallelFor(10000, 64);
+}
+
+static void testParallelFor()
+{
+    TEST_CHECK(checkParallelFor(100000, 0));
+    TEST_CHECK(checkParallelFor(1000, 1));
+    TEST_CHECK(checkParallelFor(1, 0));
+    TEST_CHECK(checkParallelFor(0, 0));
+
+    // Called within a running job
+    bool ok = false;
+    JobDesc job(parallelForJobCallback, &ok);
+    waitAndDeleteJob(dispatchSmallJobs(&job, 1));
+    TEST_CHECK(ok);
+
+    // Chunks are combined in order, so the result is deterministic
+    const int count = 100000;
+    int64_t sum = parallelReduce(0, count, 0, int64_t(0), [](int first, int last) {
+        int64_t s = 0;
+        for (int i = first; i < last; i++)
+            s += i;
+        return s;
+    }, [](const int64_t& a, const int64_t& b) { return a + b; });
+    TEST_CHECK(sum == int64_t(count)*(count - 1)/2);
+}
+
+static int32_t foreignThreadFunc(bx::Thread* self, void* userData)
+{
+    JobDesc jobs[64];
+    for (uint16_t i = 0; i < BX_COUNTOF(jobs); i++)
+        jobs[i] = JobDesc(countJobCallback, nullptr, JobPriority::High);
+    waitAndDeleteJob(dispatchSmallJobs(jobs, BX_COUNTOF(jobs)));
+    return 0;
+}
+
+// Threads that are not owned by the dispatcher push to the shared queues and wait on a semaphore
+static void testForeignThread()
+{
+    gJobCount = 0;
+    bx::Thread thread;
+    thread.init(foreignThreadFunc, nullptr, 0, "TestJobs");
+    thread.shutdown();
+    TEST_CHECK(gJobCount == 64);
+}
+
+int main(int argc, char* argv[])
+{
+    if (!initTestEngine(argv[0], nullptr, kMaxSmallFibers))
+        return -1;
+
+    testManyJobs();
+    testNestedJobs();
+    testStaleHandles();
+    testContinuations();
+    testParallelFor();
+    testForeignThread();
+
+    return finishTest("test_jobs");
+}